@@ -0,0 +1,861 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: micro benchmark application.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#include "clock_source.h"
+
+#include "esm.h"
+#include "esm_md.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/* ---------------------------------------------------------------------- */
+/* Type Aliases */
+/* ---------------------------------------------------------------------- */
+
+/** Benchmark function type. */
+using BENCH_FUNC = bool (*)(const unsigned long iterations);
+
+/** Clock source function type. */
+using CLOCK_FUNC = std::int64_t (*)();
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Default number of iterations. */
+const unsigned long DEFAULT_ITERATIONS = 1000000;
+
+/** Number of producer threads (for "mpsc", "batch" and "shard" benchmark). */
+const unsigned NUM_PRODUCERS = 4;
+
+/** Number of messages posted at once (for "batch" benchmark). */
+const std::size_t BATCH_SIZE = 8;
+
+/** Name of the message queue (for "mpsc", "batch" and "invoke" benchmark). */
+#if defined(ESM_CFG_USE_MPSC_QUEUE)
+#   define QUEUE_NAME " (mpsc queue)"
+#else
+#   define QUEUE_NAME " (mutex queue)"
+#endif
+
+/** Size of the message payload (for "payload" benchmark). */
+const std::size_t PAYLOAD_SIZE = 32;
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/** Consumer context type (for "mpsc" benchmark). */
+struct CONSUMER_CTX {
+    unsigned long received;
+    unsigned long expected;
+};
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Sink of the measured values (to keep the loops from being optimized away). */
+volatile std::int64_t sink;
+
+#if defined(CLOCK_SOURCE_HAS_TSC)
+/** TSC clock (calibrated in bench_tick()). */
+clock_source::TscClock tsc_clock;
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: etc. */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Print the result of the benchmark.
+ *
+ * @param[in] name        Name of the measured item.
+ * @param[in] elapsed     Elapsed time (in nanoseconds).
+ * @param[in] iterations  Number of iterations.
+ */
+/* ====================================================================== */
+void
+print_result(const std::string& name,
+             const std::chrono::nanoseconds elapsed,
+             const unsigned long iterations)
+{
+    auto ns = static_cast<double>(elapsed.count()) / static_cast<double>(iterations);
+
+    std::cout << std::left << std::setw(24) << name
+              << std::right << std::fixed << std::setprecision(1) << std::setw(10) << ns
+              << " ns/iter" << std::endl;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Print the mean and the percentiles of the latencies.
+ *
+ * @param[in]     name       Name of the measured item.
+ * @param[in,out] latencies  Latencies (sorted in this function).
+ */
+/* ====================================================================== */
+void
+print_latencies(const std::string& name,
+                std::vector<std::chrono::nanoseconds>& latencies)
+{
+    const auto n = latencies.size();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto total = std::accumulate(latencies.begin(), latencies.end(),
+                                 std::chrono::nanoseconds::zero());
+
+    print_result(name, total, n);
+    print_result("  p50", latencies[n / 2], 1);
+    print_result("  p99", latencies[n * 99 / 100], 1);
+    print_result("  max", latencies.back(), 1);
+}
+
+#if defined(CLOCK_SOURCE_HAS_TSC)
+/* ====================================================================== */
+/**
+ * @brief  TSC clock in microseconds.
+ *
+ * @return  Current time in microseconds.
+ */
+/* ====================================================================== */
+std::int64_t
+tsc_usec()
+{
+    return tsc_clock.usec();
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Measure the cost of the clock source.
+ *
+ * @param[in] name        Name of the clock source.
+ * @param[in] func        Clock source.
+ * @param[in] iterations  Number of iterations.
+ */
+/* ====================================================================== */
+void
+bench_clock(const std::string& name,
+            const CLOCK_FUNC func,
+            const unsigned long iterations)
+{
+    using std::chrono::steady_clock;
+
+    std::int64_t sum = 0;
+
+    auto start = steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        sum += func();
+    }
+    auto end = steady_clock::now();
+
+    sink = sum;
+    print_result(name, end - start, iterations);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: for event handler (tick benchmark) */
+/* ---------------------------------------------------------------------- */
+
+void
+on_init(void * const user_data)
+{
+    (void) user_data;
+
+    for (ESM_TIMER_ID id = 0; id < ESM_CFG_MAX_TIMER; id++) {
+        (void) esm_SetTimer(id, 0, false);
+    }
+}
+
+void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    (void) user_data;
+    (void) id;
+}
+
+void
+on_timer(void * const user_data, const ESM_TIMER_ID id)
+{
+    (void) user_data;
+
+    /* Re-arm from the handler: reads the system tick unless it is cached. */
+    (void) esm_SetTimer(id, 0, false);
+}
+
+void
+on_destroy(void * const user_data)
+{
+    (void) user_data;
+}
+
+void
+release_user_data(void * const user_data)
+{
+    (void) user_data;
+}
+
+/** Event handler (tick benchmark). */
+const ESM_EVENT_HANDLER tick_event_handler = {
+    on_init,
+    on_event,
+    on_timer,
+    on_destroy,
+    release_user_data,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+/** Event handler (do nothing). */
+const ESM_EVENT_HANDLER idle_event_handler = {
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: for message (mpsc benchmark) */
+/* ---------------------------------------------------------------------- */
+
+void
+on_message(void * const user_data)
+{
+    auto& ctx = *static_cast<CONSUMER_CTX *>(user_data);
+
+    ctx.received++;
+    if (ctx.received == ctx.expected) {
+        (void) esm_Stop();
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the messages (producer thread).
+ *
+ * @param[in,out] ctx      Consumer context.
+ * @param[in]     count    Number of messages to post.
+ * @param[in]     batch    Number of messages posted at once
+ *                         (1: esm_PostMessage(), 0: esm_PostProducerMessage()).
+ * @param[in,out] retries  Number of retries (the message pool was full).
+ */
+/* ====================================================================== */
+void
+produce(CONSUMER_CTX& ctx,
+        const unsigned long count,
+        const std::size_t batch,
+        std::atomic<unsigned long>& retries)
+{
+    const std::vector<ESM_MESSAGE> msgs(std::max<std::size_t>(batch, 1),
+                                        ESM_MESSAGE { on_message, nullptr, &ctx });
+    ESM_PRODUCER_ID producer = 0;
+    unsigned long n = 0;
+
+    if ((batch == 0) && (esm_CreateProducer(&producer) != ESM_E_OK)) {
+        std::cerr << "esm_CreateProducer() failed" << std::endl;
+        std::abort();
+    }
+
+    for (unsigned long i = 0; i < count; ) {
+        ESM_ERR err;
+        std::size_t posted;
+
+        if (batch == 0) {
+            err = esm_PostProducerMessage(producer, &msgs[0]);
+            posted = (err == ESM_E_OK) ? 1 : 0;
+        } else if (batch == 1) {
+            err = esm_PostMessage(&msgs[0]);
+            posted = (err == ESM_E_OK) ? 1 : 0;
+        } else {
+            auto rest = static_cast<std::size_t>(count - i);
+            err = esm_PostMessages(msgs.data(), std::min(batch, rest), &posted);
+        }
+
+        i += posted;
+        if (err == ESM_E_RES) {
+            n++;
+            std::this_thread::yield();
+        }
+    }
+
+    if (batch == 0) {
+        (void) esm_DestroyProducer(producer);
+    }
+
+    retries += n;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: for message (invoke benchmark) */
+/* ---------------------------------------------------------------------- */
+
+void
+on_invoke(void * const user_data)
+{
+    (void) user_data;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: for message (payload benchmark) */
+/* ---------------------------------------------------------------------- */
+
+void
+on_payload(void * const user_data)
+{
+    sink = static_cast<const unsigned char *>(user_data)[0];
+}
+
+void
+free_payload(void * const user_data)
+{
+    std::free(user_data);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the message with the heap-allocated payload.
+ *
+ * @param[in] payload  Payload (PAYLOAD_SIZE bytes).
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+post_heap_payload(const unsigned char * const payload)
+{
+    auto data = std::malloc(PAYLOAD_SIZE);
+    if (data == nullptr) {
+        return false;
+    }
+    (void) std::memcpy(data, payload, PAYLOAD_SIZE);
+
+    ESM_MESSAGE msg { on_payload, free_payload, data };
+
+    if (esm_PostMessage(&msg) != ESM_E_OK) {
+        std::free(data);
+        return false;
+    }
+
+    return true;
+}
+
+#if defined(ESM_CFG_MESSAGE_PAYLOAD_SIZE)
+/* ====================================================================== */
+/**
+ * @brief  Post the message with the inline payload.
+ *
+ * @param[in] payload  Payload (PAYLOAD_SIZE bytes).
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+post_inline_payload(const unsigned char * const payload)
+{
+    return esm_PostMessageData(on_payload, payload, PAYLOAD_SIZE) == ESM_E_OK;
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Measure the cost of posting and processing one message.
+ *
+ * @param[in] name        Name of the measured item.
+ * @param[in] post        Function to post the message.
+ * @param[in] iterations  Number of iterations.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_post(const std::string& name,
+           bool (* const post)(const unsigned char * const payload),
+           const unsigned long iterations)
+{
+    using std::chrono::steady_clock;
+
+    unsigned char payload[PAYLOAD_SIZE] {};
+
+    auto start = steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        payload[0] = static_cast<unsigned char>(i);
+        if (!post(payload)) {
+            return false;
+        }
+        (void) esm_ResumeAndYield();
+    }
+    auto end = steady_clock::now();
+
+    print_result(name, end - start, iterations);
+
+    return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: benchmarks */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Do "tick" benchmark.
+ *
+ * Measure the cost of the clock sources, and the cost of one
+ * esm_ResumeAndYield() call that expires and re-arms ESM_CFG_MAX_TIMER
+ * timers.
+ *
+ * @param[in] iterations  Number of iterations.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_tick(const unsigned long iterations)
+{
+    using std::chrono::steady_clock;
+
+    bench_clock("steady_clock", clock_source::steady_usec, iterations);
+#if defined(CLOCK_SOURCE_HAS_MONOTONIC)
+    bench_clock("CLOCK_MONOTONIC", clock_source::monotonic_usec, iterations);
+#endif
+#if defined(CLOCK_SOURCE_HAS_MONOTONIC_COARSE)
+    bench_clock("CLOCK_MONOTONIC_COARSE", clock_source::monotonic_coarse_usec, iterations);
+#endif
+#if defined(CLOCK_SOURCE_HAS_TSC)
+    tsc_clock.calibrate();
+    bench_clock("TSC", tsc_usec, iterations);
+#endif
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return false;
+    }
+
+    ESM_PREPARE_PARAMS params { &tick_event_handler };
+
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        esm_Finalize();
+        return false;
+    }
+
+    auto start = steady_clock::now();
+    for (unsigned long i = 0; i < iterations; i++) {
+        (void) esm_ResumeAndYield();
+    }
+    auto end = steady_clock::now();
+
+#if defined(ESM_CFG_USE_LOOP_TIME)
+    print_result("loop (loop time: on)", end - start, iterations);
+#else
+    print_result("loop (loop time: off)", end - start, iterations);
+#endif
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return true;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Measure the cost of one message, posted from NUM_PRODUCERS
+ *         threads and processed by esm_Run() in another thread.
+ *
+ * @param[in] name        Name of the measured item.
+ * @param[in] batch       Number of messages posted at once (see produce()).
+ * @param[in] iterations  Number of messages.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_producers(const std::string& name,
+                const std::size_t batch,
+                const unsigned long iterations)
+{
+    using std::chrono::steady_clock;
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return false;
+    }
+
+    ESM_PREPARE_PARAMS params { &idle_event_handler };
+
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        esm_Finalize();
+        return false;
+    }
+
+    const auto per_producer = (iterations + NUM_PRODUCERS - 1) / NUM_PRODUCERS;
+    CONSUMER_CTX ctx { 0, per_producer * NUM_PRODUCERS };
+    std::atomic<unsigned long> retries { 0 };
+
+    auto start = steady_clock::now();
+
+    std::thread consumer([] { (void) esm_Run(); });
+
+    std::vector<std::thread> producers;
+    for (unsigned i = 0; i < NUM_PRODUCERS; i++) {
+        producers.emplace_back(produce, std::ref(ctx), per_producer, batch, std::ref(retries));
+    }
+    for (auto& th : producers) {
+        th.join();
+    }
+    consumer.join();
+
+    auto end = steady_clock::now();
+
+    print_result(name, end - start, ctx.expected);
+    std::cout << "retries (pool full)     " << retries << std::endl;
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return true;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do "mpsc" benchmark.
+ *
+ * Measure the cost of one message, posted with esm_PostMessage() from
+ * NUM_PRODUCERS threads and processed by esm_Run() in another thread.
+ *
+ * @param[in] iterations  Number of messages.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_mpsc(const unsigned long iterations)
+{
+    return bench_producers("post" QUEUE_NAME, 1, iterations);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do "batch" benchmark.
+ *
+ * Same as "mpsc" benchmark, but post BATCH_SIZE messages at once with
+ * esm_PostMessages().
+ *
+ * @param[in] iterations  Number of messages.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_batch(const unsigned long iterations)
+{
+    return bench_producers("post x" + std::to_string(BATCH_SIZE) + QUEUE_NAME, BATCH_SIZE, iterations);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do "shard" benchmark.
+ *
+ * Same as "mpsc" benchmark, but each thread posts to its own queue with
+ * esm_PostProducerMessage() (requires ESM_CFG_MESSAGE_SHARDS).
+ *
+ * @param[in] iterations  Number of messages.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_shard(const unsigned long iterations)
+{
+#if defined(ESM_CFG_MESSAGE_SHARDS)
+    return bench_producers("post (producer queue)", 0, iterations);
+#else
+    (void) iterations;
+
+    std::cerr << "shard: ESM_CFG_MESSAGE_SHARDS is not defined" << std::endl;
+    return false;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do "invoke" benchmark.
+ *
+ * Measure the round-trip latency of esm_Invoke() to esm_Run() in another
+ * thread (requires ESM_CFG_USE_INVOKE).
+ *
+ * @param[in] iterations  Number of iterations.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_invoke(const unsigned long iterations)
+{
+#if defined(ESM_CFG_USE_INVOKE)
+    using std::chrono::steady_clock;
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return false;
+    }
+
+    ESM_PREPARE_PARAMS params { &idle_event_handler };
+
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        esm_Finalize();
+        return false;
+    }
+
+    const ESM_MESSAGE msg { on_invoke, nullptr, nullptr };
+    std::vector<std::chrono::nanoseconds> latencies;
+    latencies.reserve(iterations);
+
+    std::thread consumer([] { (void) esm_Run(); });
+
+    auto ok = true;
+    for (unsigned long i = 0; i < iterations; i++) {
+        auto start = steady_clock::now();
+        if (esm_Invoke(&msg, ESM_WAIT_FOREVER) != ESM_E_OK) {
+            ok = false;
+            break;
+        }
+        auto end = steady_clock::now();
+        latencies.push_back(end - start);
+    }
+
+    (void) esm_Stop();
+    consumer.join();
+
+    if (ok) {
+        print_latencies("invoke" QUEUE_NAME, latencies);
+    }
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return ok;
+#else
+    (void) iterations;
+
+    std::cerr << "invoke: ESM_CFG_USE_INVOKE is not defined" << std::endl;
+    return false;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do "payload" benchmark.
+ *
+ * Measure the cost of posting and processing one message with the
+ * PAYLOAD_SIZE bytes payload: heap-allocated user_data vs inline payload
+ * (esm_PostMessageData()).
+ *
+ * @param[in] iterations  Number of iterations.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ====================================================================== */
+bool
+bench_payload(const unsigned long iterations)
+{
+    if (esm_Initialize() != ESM_E_OK) {
+        return false;
+    }
+
+    ESM_PREPARE_PARAMS params { &idle_event_handler };
+
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        esm_Finalize();
+        return false;
+    }
+
+    auto ok = bench_post("post (heap payload)", post_heap_payload, iterations);
+#if defined(ESM_CFG_MESSAGE_PAYLOAD_SIZE)
+    if (ok) {
+        ok = bench_post("post (inline payload)", post_inline_payload, iterations);
+    }
+#endif
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return ok;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Constants: benchmarks */
+/* ---------------------------------------------------------------------- */
+
+/** Benchmark entry. */
+const std::map<std::string, BENCH_FUNC> BENCH_ENTRY {
+    { "batch", bench_batch },
+    { "invoke", bench_invoke },
+    { "mpsc", bench_mpsc },
+    { "payload", bench_payload },
+    { "shard", bench_shard },
+    { "tick", bench_tick },
+};
+
+/* ====================================================================== */
+/**
+ * @brief  Show usage message.
+ */
+/* ====================================================================== */
+void
+show_usage()
+{
+    std::cerr << "usage: bench benchmark [iterations]" << std::endl
+              << "benchmarks:";
+    for (const auto& entry : BENCH_ENTRY) {
+        std::cerr << " " << entry.first;
+    }
+    std::cerr << std::endl;
+}
+
+} // namespace
+
+/* ---------------------------------------------------------------------- */
+/* ESM: machdep implementation */
+/* ---------------------------------------------------------------------- */
+
+extern "C" {
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek event.
+ *
+ * @return  Event ID.
+ */
+/* ********************************************************************** */
+ESM_EVENT_ID
+esm_md_PeekEvent(void)
+{
+    return ESM_EVENT_ID_NONE;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if there is any event to peek.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ */
+/* ********************************************************************** */
+bool
+esm_md_HasEvent(void)
+{
+    return false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the event record.
+ *
+ * @param[out] record  Event record.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ */
+/* ********************************************************************** */
+bool
+esm_md_PeekEventRecord(ESM_EVENT_RECORD * const record)
+{
+    (void) record;
+
+    return false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the events at once.
+ *
+ * @param[out] ids  Event IDs output place.
+ * @param[in]  n    Maximum number of the events.
+ *
+ * @return  Number of the events (0: no event).
+ */
+/* ********************************************************************** */
+size_t
+esm_md_PeekEvents(ESM_EVENT_ID * const ids, const size_t n)
+{
+    (void) ids;
+    (void) n;
+
+    return 0;
+}
+
+} // extern "C"
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Application entry point.
+ *
+ * @param[in] argc  The number of arguments.
+ * @param[in] argv  Arguments.
+ *
+ * @retval EXIT_SUCCESS  Exit success.
+ * @retval EXIT_FAILURE  Exit failure.
+ */
+/* ********************************************************************** */
+int
+main(int argc, char *argv[])
+{
+    if ((argc < 2) || (argc > 3)) {
+        show_usage();
+        return EXIT_FAILURE;
+    }
+
+    auto p = BENCH_ENTRY.find(argv[1]);
+    if (p == BENCH_ENTRY.end()) {
+        show_usage();
+        return EXIT_FAILURE;
+    }
+
+    auto iterations = DEFAULT_ITERATIONS;
+    if (argc == 3) {
+        char *end;
+        iterations = std::strtoul(argv[2], &end, 10);
+        if ((*end != '\0') || (iterations == 0)) {
+            show_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    return p->second(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+# @brief   ESM: Makefile for benchmark application (Unix environment)
+# @author  eel3
+# @date    2026-10-17
+
+# ---------------------------------------------------------------------
+
+root-dir       := ../../..
+
+src-dir        := $(root-dir)/src
+include-dir    := $(src-dir)/include
+lib-dir        := $(src-dir)/lib
+machdep-dir    := $(src-dir)/machdep
+md-sample-dir  := $(machdep-dir)/sample
+
+app-dir        := ..
+console-dir    := ../../console
+
+#----------------------------------------------------------------------
+
+VPATH          := $(lib-dir) $(app-dir) $(console-dir)
+
+include-dirs   := $(addprefix -I , \
+                  $(include-dir) \
+                  $(md-sample-dir) \
+                  $(VPATH))
+
+object-files   := esm.o \
+                  esm_timer_wheel.o \
+                  esm_timer_soa.o \
+                  esm_mpsc_queue.o \
+                  esm_spsc_queue.o \
+                  esm_message_pool.o \
+                  esm_priority.o \
+                  esm_md.o \
+                  bench.o
+depend-files   := $(subst .o,.d,$(object-files))
+
+target-name        := bench
+
+#----------------------------------------------------------------------
+
+ifdef USE_ASSERT
+CCDEFS     += -DDEBUG
+else
+CCDEFS     += -DNDEBUG
+endif
+
+CCDEFS     +=
+OPTIM      ?= -O0
+WARN       ?= -Wall -pedantic \
+              -Wextra \
+              -Wunused-result \
+              -Wno-unused-function -Wcast-align \
+                  -Wmissing-include-dirs -Wundef \
+              # -Wno-long-long
+CWARN      ?= -std=c99 $(WARN) -Wbad-function-cast -Werror-implicit-function-declaration
+CXXWARN    ?= -std=c++11 $(WARN)
+
+CFLAGS     += $(OPTIM) $(CWARN) $(WARNADD)
+CXXFLAGS   += $(OPTIM) $(CXXWARN) $(WARNADD)
+CPPFLAGS   += $(CCDEFS) $(include-dirs)
+LDFLAGS    += $(OPTIM)
+
+#----------------------------------------------------------------------
+
+phony-targets  := all clean usage
+
+.PHONY: $(phony-targets)
+
+usage:
+	# $(MAKE) -f build-<target-arch>.mk $(patsubst %,[%],$(phony-targets))
+
+all: $(target-name)
+
+$(target-name): $(object-files)
+
+clean:
+	$(RM) $(target-name) $(object-files) $(depend-files)
+
+#----------------------------------------------------------------------
+
+ifneq "$(MAKECMDGOALS)" ""
+ifneq "$(MAKECMDGOALS)" "clean"
+ifneq "$(MAKECMDGOALS)" "usage"
+  -include $(depend-files)
+endif
+endif
+endif
+
+# $(call make-depend,source-file,object-file,depend-file,flags)
+make-depend = $(CC) -MM -MF $3 -MP -MT $2 $4 $(CPPFLAGS) $1
+
+%.o: %.c
+	$(call make-depend,$<,$@,$(subst .o,.d,$@),$(CFLAGS))
+	$(COMPILE.c) $(OUTPUT_OPTION) $<
+
+%.o: %.cpp
+	$(call make-depend,$<,$@,$(subst .o,.d,$@),$(CXXFLAGS))
+	$(COMPILE.cpp) $(OUTPUT_OPTION) $<
@@ -0,0 +1,72 @@
+# @brief   ESM: Makefile for benchmark application (NMAKE and Microsoft C/C++ Optimizing Compiler)
+# @author  eel3
+# @date    2026-10-17
+
+# ---------------------------------------------------------------------
+
+root_dir        = ..\..\..
+
+src_dir         = $(root_dir)\src
+include_dir     = $(src_dir)\include
+lib_dir         = $(src_dir)\lib
+machdep_dir     = $(src_dir)\machdep
+md_sample_dir   = $(machdep_dir)\sample
+
+app_dir         = ..
+console_dir     = ..\..\console
+
+#----------------------------------------------------------------------
+
+vpath           = $(lib_dir) $(app_dir) $(console_dir)
+
+include_dirs    = $(include_dir)\
+                  $(md_sample_dir)\
+                  $(vpath)
+
+object_files    = esm.obj\
+                  esm_timer_wheel.obj\
+                  esm_timer_soa.obj\
+                  esm_mpsc_queue.obj\
+                  esm_spsc_queue.obj\
+                  esm_message_pool.obj\
+                  esm_priority.obj\
+                  esm_md.obj\
+                  bench.obj
+
+target_name     = bench.exe
+
+# ----------------------------------------------------------
+
+#ccdefs = /MTd /Zi /D WIN32;_DEBUG;_CONSOLE;_MBCS;WINVER=0x0601;_WIN32_WINNT=0x0601;_CRT_SECURE_NO_WARNINGS;_WINDOWS;DEBUG
+ccdefs  = /MT /D WIN32;NDEBUG;_CONSOLE;_MBCS;WINVER=0x0601;_WIN32_WINNT=0x0601;_CRT_SECURE_NO_WARNINGS;_WINDOWS
+
+#----------------------------------------------------------------------
+
+CFLAGS      = /nologo /GL /GS /RTCs /RTCu /W4 $(ccdefs:;= /D ) /I $(include_dirs: = /I )
+CXXFLAGS    = /nologo /EHsc /GL /GS /RTCs /RTCu /W4 $(ccdefs:;= /D ) /I $(include_dirs: = /I )
+
+#----------------------------------------------------------------------
+
+phony_targets   = all clean usage
+
+usage: FORCE
+	:: $(MAKE) /f build-win-vc.mak [$(phony_targets: =] [)]
+
+all: $(target_name)
+
+$(target_name): $(object_files)
+	link.exe /LTCG /OUT:$(target_name) /SUBSYSTEM:CONSOLE $(object_files) user32.lib
+
+clean: FORCE
+	del /F $(target_name) $(object_files) 2>nul
+
+FORCE:
+
+# ----------------------------------------------------------
+
+{$(lib_dir)}.c.obj::
+	$(CC) $(CFLAGS) /c $<
+{$(app_dir)}.cpp.obj::
+	$(CXX) $(CXXFLAGS) /c $<
+{$(console_dir)}.cpp.obj::
+	$(CXX) $(CXXFLAGS) /c $<
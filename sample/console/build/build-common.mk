@@ -24,6 +24,12 @@ include-dirs   := $(addprefix -I , \
                   $(VPATH))
 
 object-files   := esm.o \
+                  esm_timer_wheel.o \
+                  esm_timer_soa.o \
+                  esm_mpsc_queue.o \
+                  esm_spsc_queue.o \
+                  esm_message_pool.o \
+                  esm_priority.o \
                   esm_md.o \
                   main.o \
                   handler_common.o \
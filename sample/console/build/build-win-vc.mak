@@ -23,6 +23,12 @@ include_dirs    = $(include_dir)\
                   $(vpath)
 
 object_files    = esm.obj\
+                  esm_timer_wheel.obj\
+                  esm_timer_soa.obj\
+                  esm_mpsc_queue.obj\
+                  esm_spsc_queue.obj\
+                  esm_message_pool.obj\
+                  esm_priority.obj\
                   esm_md.obj\
                   main.obj\
                   handler_common.obj\
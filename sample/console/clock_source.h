@@ -0,0 +1,122 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: Clock sources for the system tick (sample && test application).
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef CLOCK_SOURCE_H_INCLUDED
+#define CLOCK_SOURCE_H_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <time.h>
+#   if defined(CLOCK_MONOTONIC)
+#       define CLOCK_SOURCE_HAS_MONOTONIC
+#   endif
+#   if defined(CLOCK_MONOTONIC_COARSE)
+#       define CLOCK_SOURCE_HAS_MONOTONIC_COARSE
+#   endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#   define CLOCK_SOURCE_HAS_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#   include <intrin.h>
+#   define CLOCK_SOURCE_HAS_TSC
+#endif
+
+namespace clock_source {
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/** std::chrono::steady_clock in microseconds. */
+inline std::int64_t
+steady_usec()
+{
+    using std::chrono::steady_clock;
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+
+    auto tp = steady_clock::now();
+    auto us = duration_cast<microseconds>(tp.time_since_epoch());
+
+    return static_cast<std::int64_t>(us.count());
+}
+
+#if defined(CLOCK_SOURCE_HAS_MONOTONIC)
+/** clock_gettime(CLOCK_MONOTONIC) in microseconds. */
+inline std::int64_t
+monotonic_usec()
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+#if defined(CLOCK_SOURCE_HAS_MONOTONIC_COARSE)
+/** clock_gettime(CLOCK_MONOTONIC_COARSE) in microseconds. */
+inline std::int64_t
+monotonic_coarse_usec()
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Classes */
+/* ---------------------------------------------------------------------- */
+
+#if defined(CLOCK_SOURCE_HAS_TSC)
+/**
+ * TSC clock class (calibrated against steady_clock).
+ * The TSC must be invariant (constant rate and synchronized among CPUs).
+ */
+class TscClock {
+private:
+    std::uint64_t m_base_tsc;
+    std::int64_t m_base_usec;
+    double m_usec_per_tick;
+
+public:
+    TscClock() : m_base_tsc(0), m_base_usec(0), m_usec_per_tick(0.0) {}
+
+    void calibrate(const std::chrono::microseconds period = std::chrono::milliseconds(20)) {
+        auto start_usec = steady_usec();
+        auto start_tsc = __rdtsc();
+        std::int64_t end_usec;
+
+        do {
+            end_usec = steady_usec();
+        } while ((end_usec - start_usec) < period.count());
+        auto end_tsc = __rdtsc();
+
+        m_usec_per_tick = static_cast<double>(end_usec - start_usec)
+                        / static_cast<double>(end_tsc - start_tsc);
+        m_base_tsc = end_tsc;
+        m_base_usec = end_usec;
+    }
+
+    std::int64_t usec() const {
+        auto ticks = static_cast<double>(static_cast<std::int64_t>(__rdtsc() - m_base_tsc));
+        return m_base_usec + static_cast<std::int64_t>(ticks * m_usec_per_tick);
+    }
+};
+#endif
+
+} // namespace clock_source
+
+#endif /* ndef CLOCK_SOURCE_H_INCLUDED */
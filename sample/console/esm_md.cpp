@@ -7,25 +7,63 @@
 /* ********************************************************************** */
 
 #include "esm_md.h"
+#include "esm_message_pool.h"
+#include "clock_source.h"
 
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <mutex>
 
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+#   include <memory>
+#   include <new>
+#   include <vector>
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE) && !defined(ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC)
+/** Minimum interval of the release of the free slabs (see esm_config.h). */
+#define ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC 1000
+#endif
+
 namespace {
 
 /* ---------------------------------------------------------------------- */
 /* Data structures */
 /* ---------------------------------------------------------------------- */
 
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+/** Slab of the message cells. */
+using MESSAGE_SLAB = std::unique_ptr<ESM_MESSAGE_CELL[]>;
+#endif
+
 /** Module context type. */
 struct MODULE_CTX {
     bool initialized;
     bool prepared;
     ESM_MESSAGE_CELL messages[ESM_CFG_MAX_MESSAGE];
+    ESM_MESSAGE_POOL pool;
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+    std::vector<MESSAGE_SLAB> slabs;
+    std::int64_t shrink_time_usec;
+#endif
     std::mutex mutex_for_api;
+    std::condition_variable cond_for_space;
+    std::condition_variable cond_for_completion;
 
-    MODULE_CTX() : initialized(false), prepared(false) {}
+    std::mutex mutex_for_work;
+    std::condition_variable cond_for_work;
+    bool work_notified;
+
+#if defined(ESM_CFG_CLOCK_TSC)
+    clock_source::TscClock tsc;
+#endif
+
+    MODULE_CTX() : initialized(false), prepared(false), work_notified(false) {}
 };
 
 /* ---------------------------------------------------------------------- */
@@ -55,6 +93,148 @@ NELEMS(const T (&)[N])
     return N;
 }
 
+/* ====================================================================== */
+/**
+ * @brief  Atomically load the variable (acquire).
+ *
+ * @param[in] ptr  Pointer of the variable.
+ *
+ * @return  Value of the variable.
+ *
+ * @note  On MSVC, this relies on the volatile semantics of x86/x64.
+ */
+/* ====================================================================== */
+template <typename T>
+inline T
+load_acquire(T * const ptr)
+{
+#if defined(_MSC_VER)
+    T value = *static_cast<volatile T *>(ptr);
+    _ReadWriteBarrier();
+    return value;
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Atomically store the variable (release).
+ *
+ * @param[out] ptr    Pointer of the variable.
+ * @param[in]  value  Value to store.
+ *
+ * @note  On MSVC, this relies on the volatile semantics of x86/x64.
+ */
+/* ====================================================================== */
+template <typename T>
+inline void
+store_release(T * const ptr, const T value)
+{
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+    *static_cast<volatile T *>(ptr) = value;
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Get the current time from the selected clock source.
+ *
+ * @return  Current time in microseconds.
+ */
+/* ====================================================================== */
+inline std::int64_t
+now_usec()
+{
+#if defined(ESM_CFG_CLOCK_TSC)
+    return module_ctx.tsc.usec();
+#elif defined(ESM_CFG_CLOCK_MONOTONIC_COARSE)
+    return clock_source::monotonic_coarse_usec();
+#elif defined(ESM_CFG_CLOCK_MONOTONIC)
+    return clock_source::monotonic_usec();
+#else
+    return clock_source::steady_usec();
+#endif
+}
+
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+/* ====================================================================== */
+/**
+ * @brief  Add a slab to the message cell pool.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure (reached ESM_CFG_MAX_MESSAGE_SLAB, or no memory).
+ *
+ * @note  Call in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+bool
+grow_message_pool(MODULE_CTX& mc)
+{
+    /* Keep the slabs for a while after the burst. */
+    mc.shrink_time_usec = now_usec() + static_cast<std::int64_t>(ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC) * 1000;
+
+#if defined(ESM_CFG_MAX_MESSAGE_SLAB)
+    if (mc.slabs.size() >= ESM_CFG_MAX_MESSAGE_SLAB) {
+        return false;
+    }
+#endif
+
+    MESSAGE_SLAB slab { new (std::nothrow) ESM_MESSAGE_CELL[ESM_CFG_MESSAGE_SLAB_SIZE] };
+    if (!slab) {
+        return false;
+    }
+
+    try {
+        mc.slabs.push_back(std::move(slab));
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+
+    esm_mp_AddCells(&mc.pool, mc.slabs.back().get(), ESM_CFG_MESSAGE_SLAB_SIZE);
+
+    return true;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Release the free slabs (from the newest one) of the message cell
+ *         pool.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @note  Checking a slab walks the free list (O(capacity)) in the API lock,
+ *        so this is done at most once per ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC.
+ */
+/* ====================================================================== */
+void
+shrink_message_pool(MODULE_CTX& mc)
+{
+    std::lock_guard<std::mutex> lck(mc.mutex_for_api);
+
+    const auto now = now_usec();
+    if (mc.slabs.empty() || ((now - mc.shrink_time_usec) < 0)) {
+        return;
+    }
+    mc.shrink_time_usec = now + static_cast<std::int64_t>(ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC) * 1000;
+
+    while (!mc.slabs.empty()
+           && esm_mp_RemoveCells(&mc.pool, mc.slabs.back().get(), ESM_CFG_MESSAGE_SLAB_SIZE))
+    {
+        mc.slabs.pop_back();
+    }
+}
+#endif
+
 } // namespace
 
 /* ---------------------------------------------------------------------- */
@@ -86,6 +266,10 @@ esm_md_Initialize(void)
 
     mc.prepared = false;
 
+#if defined(ESM_CFG_CLOCK_TSC)
+    mc.tsc.calibrate();
+#endif
+
     mc.initialized = true;
 
     return ESM_E_OK;
@@ -131,9 +315,11 @@ esm_md_PrepareBeforeMainLoop(void)
         return ESM_E_STATUS;
     }
 
-    for (size_t i { 0 }; i < NELEMS(mc.messages); i++) {
-        mc.messages[i].empty = true;
-    }
+    esm_mp_Initialize(&mc.pool, mc.messages, NELEMS(mc.messages));
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+    mc.slabs.clear();
+    mc.shrink_time_usec = now_usec();
+#endif
 
     mc.prepared = true;
 
@@ -181,15 +367,13 @@ esm_md_AllocMessageCell(void)
 
     assert(mc.initialized);
 
-    for (size_t i { 0 }; i < NELEMS(mc.messages); i++) {
-        auto& cell = mc.messages[i];
-        if (cell.empty) {
-            cell.empty = false;
-            return &cell;
-        }
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+    if (esm_mp_NumFree(&mc.pool) == 0) {
+        (void) grow_message_pool(mc);
     }
+#endif
 
-    return nullptr;
+    return esm_mp_Alloc(&mc.pool);
 }
 
 /* ********************************************************************** */
@@ -202,9 +386,103 @@ esm_md_AllocMessageCell(void)
 void
 esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell)
 {
-    assert(module_ctx.initialized);
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+    esm_mp_Free(&mc.pool, cell);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the pointer of ESM_MESSAGE_CELL type (acquire).
+ *
+ * @param[in] ptr  Pointer variable.
+ *
+ * @return  Value of the pointer variable.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_md_LoadMessageCell(ESM_MESSAGE_CELL * const * const ptr)
+{
+    assert(ptr != nullptr);
+
+    return load_acquire(ptr);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the pointer of ESM_MESSAGE_CELL type (release).
+ *
+ * @param[out] ptr   Pointer variable.
+ * @param[in]  cell  Value to store.
+ */
+/* ********************************************************************** */
+void
+esm_md_StoreMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                        ESM_MESSAGE_CELL * const cell)
+{
+    assert(ptr != nullptr);
+
+    store_release(ptr, cell);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically exchange the pointer of ESM_MESSAGE_CELL type
+ *         (acquire and release).
+ *
+ * @param[in,out] ptr   Pointer variable.
+ * @param[in]     cell  Value to store.
+ *
+ * @return  Previous value of the pointer variable.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_md_ExchangeMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                           ESM_MESSAGE_CELL * const cell)
+{
+    assert(ptr != nullptr);
+
+#if defined(_MSC_VER)
+    return static_cast<ESM_MESSAGE_CELL *>(
+        _InterlockedExchangePointer(reinterpret_cast<void * volatile *>(ptr), cell));
+#else
+    return __atomic_exchange_n(ptr, cell, __ATOMIC_ACQ_REL);
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the variable of size_t type (acquire).
+ *
+ * @param[in] ptr  Pointer of the variable.
+ *
+ * @return  Value of the variable.
+ */
+/* ********************************************************************** */
+size_t
+esm_md_LoadSize(const size_t * const ptr)
+{
+    assert(ptr != nullptr);
+
+    return load_acquire(ptr);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the variable of size_t type (release).
+ *
+ * @param[out] ptr    Pointer of the variable.
+ * @param[in]  value  Value to store.
+ */
+/* ********************************************************************** */
+void
+esm_md_StoreSize(size_t * const ptr, const size_t value)
+{
+    assert(ptr != nullptr);
 
-    cell->empty = true;
+    store_release(ptr, value);
 }
 
 /* ********************************************************************** */
@@ -219,14 +497,159 @@ esm_md_GetTick(void)
 {
     assert(module_ctx.initialized);
 
-    using std::chrono::steady_clock;
-    using std::chrono::milliseconds;
-    using std::chrono::duration_cast;
+    return static_cast<ESM_SYS_TICK_MSEC>(now_usec() / 1000);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get high-resolution system tick value.
+ *
+ * @return  System tick in microseconds.
+ */
+/* ********************************************************************** */
+ESM_SYS_TICK_USEC
+esm_md_GetTickUsec(void)
+{
+    assert(module_ctx.initialized);
+
+    return static_cast<ESM_SYS_TICK_USEC>(now_usec());
+}
 
-    auto tp = steady_clock::now();
-    auto ms = duration_cast<milliseconds>(tp.time_since_epoch());
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the work (event, message, etc.).
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForWork(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+#if defined(ESM_CFG_MESSAGE_SLAB_SIZE)
+    /* The main loop is idle: give back the memory after the burst. */
+    shrink_message_pool(mc);
+#endif
+
+    std::unique_lock<std::mutex> lck(mc.mutex_for_work);
+    auto notified = [&mc] { return mc.work_notified; };
+
+    if (timeout_msec < 0) {
+        mc.cond_for_work.wait(lck, notified);
+    } else {
+        std::chrono::milliseconds timeout { timeout_msec };
+        (void) mc.cond_for_work.wait_for(lck, timeout, notified);
+    }
+    mc.work_notified = false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up esm_md_WaitForWork().
+ */
+/* ********************************************************************** */
+void
+esm_md_NotifyWork(void)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+    std::lock_guard<std::mutex> lck(mc.mutex_for_work);
+    mc.work_notified = true;
+    mc.cond_for_work.notify_one();
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for a space in the message queue.
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForSpace(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+    /* Already locked by esm_md_LockForAPI(): unlocked while waiting. */
+    std::unique_lock<std::mutex> lck(mc.mutex_for_api, std::adopt_lock);
+
+    if (timeout_msec < 0) {
+        mc.cond_for_space.wait(lck);
+    } else {
+        std::chrono::milliseconds timeout { timeout_msec };
+        (void) mc.cond_for_space.wait_for(lck, timeout);
+    }
+
+    /* Keep locked for esm_md_UnlockForAPI(). */
+    (void) lck.release();
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForSpace().
+ */
+/* ********************************************************************** */
+void
+esm_md_NotifySpace(void)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+    mc.cond_for_space.notify_all();
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the completion of the message posted by esm_Invoke().
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForCompletion(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
+
+    /* Already locked by esm_md_LockForAPI(): unlocked while waiting. */
+    std::unique_lock<std::mutex> lck(mc.mutex_for_api, std::adopt_lock);
+
+    if (timeout_msec < 0) {
+        mc.cond_for_completion.wait(lck);
+    } else {
+        std::chrono::milliseconds timeout { timeout_msec };
+        (void) mc.cond_for_completion.wait_for(lck, timeout);
+    }
+
+    /* Keep locked for esm_md_UnlockForAPI(). */
+    (void) lck.release();
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForCompletion().
+ */
+/* ********************************************************************** */
+void
+esm_md_NotifyCompletion(void)
+{
+    auto& mc = module_ctx;
+
+    assert(mc.initialized);
 
-    return static_cast<ESM_SYS_TICK_MSEC>(ms.count());
+    mc.cond_for_completion.notify_all();
 }
 
 /* ********************************************************************** */
@@ -36,4 +36,6 @@ const ESM_EVENT_HANDLER state_3_event_handler = {
     event_handler_on_destroy,
     event_handler_release_user_data,
     (void *) handler_name_prefix,
+    NULL,
+    NULL,
 };
@@ -11,6 +11,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <queue>
 
@@ -42,6 +43,21 @@ public:
         m_queue.pop();
         return true;
     }
+
+    std::size_t pop(T *vals, std::size_t n) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        std::size_t count = 0;
+        for (; (count < n) && !m_queue.empty(); ++count) {
+            vals[count] = m_queue.front();
+            m_queue.pop();
+        }
+        return count;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_queue.empty();
+    }
 };
 
 #endif /* ndef MAILBOX_H_INCLUDED */
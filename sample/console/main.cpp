@@ -377,11 +377,10 @@ const CE COMMAND_ENTRY {
  * @brief  Main loop.
  *
  * @param[in,out] pr_init  A promise object to notify initialization result.
- * @param[in]     fu_fin   A future object to receive application terminate.
  */
 /* ====================================================================== */
 void
-main_loop(std::promise<bool>& pr_init, std::future<void>& fu_fin)
+main_loop(std::promise<bool>& pr_init)
 {
     ESM_ERR err;
 
@@ -402,10 +401,7 @@ main_loop(std::promise<bool>& pr_init, std::future<void>& fu_fin)
 
     pr_init.set_value(true);
 
-    std::chrono::milliseconds timeout { 10 };
-    while (fu_fin.wait_for(timeout) == std::future_status::timeout) {
-        (void) esm_ResumeAndYield();
-    }
+    (void) esm_Run();
 
     (void) esm_CleanupAfterMainLoop();
     esm_Finalize();
@@ -487,6 +483,69 @@ esm_md_PeekEvent(void)
     return id;
 }
 
+/* ********************************************************************** */
+/**
+ * @brief  Return true if there is any event to peek.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ */
+/* ********************************************************************** */
+bool
+esm_md_HasEvent(void)
+{
+    auto& mc = module_ctx;
+
+    return !mc.mailbox.empty();
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the event record.
+ *
+ * @param[out] record  Event record.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ */
+/* ********************************************************************** */
+bool
+esm_md_PeekEventRecord(ESM_EVENT_RECORD * const record)
+{
+    auto& mc = module_ctx;
+    ESM_EVENT_ID id;
+
+    if (!mc.mailbox.pop(id)) {
+        return false;
+    }
+
+    /* The commands have no payload: all packed in the event ID. */
+    record->id = id;
+    record->size = 0;
+    record->data = nullptr;
+    record->release_data = nullptr;
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the events at once.
+ *
+ * @param[out] ids  Event IDs output place.
+ * @param[in]  n    Maximum number of the events.
+ *
+ * @return  Number of the events (0: no event).
+ */
+/* ********************************************************************** */
+size_t
+esm_md_PeekEvents(ESM_EVENT_ID * const ids, const size_t n)
+{
+    auto& mc = module_ctx;
+
+    return mc.mailbox.pop(ids, n);
+}
+
 } // extern "C"
 
 /* ---------------------------------------------------------------------- */
@@ -510,10 +569,7 @@ main()
     std::promise<bool> pr_init;
     auto fu_init = pr_init.get_future();
 
-    std::promise<void> pr_fin;
-    auto fu_fin = pr_fin.get_future();
-
-    std::thread th([&pr_init, &fu_fin] { main_loop(pr_init, fu_fin); });    // XXX Workaround !
+    std::thread th([&pr_init] { main_loop(pr_init); });    // XXX Workaround !
 
     const auto initialized = fu_init.get();
     if (!initialized) {
@@ -558,9 +614,10 @@ main()
         }
         auto& mc = module_ctx;
         mc.mailbox.push(event_id);
+        esm_md_NotifyWork();
     }
 
-    pr_fin.set_value();
+    (void) esm_Stop();
     th.join();
 
     return EXIT_SUCCESS;
@@ -9,6 +9,7 @@
 #ifndef ESM_H_INCLUDED
 #define ESM_H_INCLUDED
 
+#include <stddef.h>
 #include <stdint.h>
 #ifdef __cplusplus
 #   include <cstdbool>
@@ -32,6 +33,8 @@ typedef int32_t ESM_ERR;
 #define ESM_E_RES       (ESM_E_NG - 2)      /**< No system resources. */
 #define ESM_E_STATUS    (ESM_E_NG - 3)      /**< Internal status error. */
 #define ESM_E_SYS       (ESM_E_NG - 4)      /**< Error caused by underlying library routines. */
+#define ESM_E_NOENT     (ESM_E_NG - 5)      /**< No such entry. */
+#define ESM_E_TIMEOUT   (ESM_E_NG - 6)      /**< Timed out. */
 
 /* ---------------------------------------------------------------------- */
 /* Data types */
@@ -40,10 +43,61 @@ typedef int32_t ESM_ERR;
 /** Timer ID type (must be greater than or equal to 0). */
 typedef uint32_t ESM_TIMER_ID;
 
+/** Timer handle type. */
+typedef uint32_t ESM_TIMER_HANDLE;
+
+/** Message producer ID type (see esm_CreateProducer()). */
+typedef uint32_t ESM_PRODUCER_ID;
+
+/** Message/event priority type (0 is the highest, see esm_PostPriorityMessage()). */
+typedef uint32_t ESM_PRIORITY;
+
+/** Queue overflow policy type (see ESM_QUEUE_POLICY). */
+typedef uint32_t ESM_OVERFLOW_POLICY;
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Timeout value to wait forever (for esm_RunOnce()). */
+#define ESM_WAIT_FOREVER ((ESM_SYS_TICK_MSEC) -1)
+
+/** Invalid timer handle (esm_CreateTimer() never returns this value). */
+#define ESM_TIMER_HANDLE_INVALID ((ESM_TIMER_HANDLE) 0)
+
+/** Maximum timer slack (one minute, see esm_SetTimerSlack()). */
+#define ESM_TIMER_SLACK_MSEC_MAX ((ESM_SYS_TICK_MSEC) 60000)
+
+/** Size of the inline payload of the event record (see ESM_EVENT_RECORD). */
+#define ESM_EVENT_INLINE_SIZE 16
+
+/** Number of buckets of the timer lateness histogram. */
+#define ESM_TIMER_LATENESS_BUCKETS 32
+
+#define ESM_OVERFLOW_REJECT         ((ESM_OVERFLOW_POLICY) 0)   /**< Reject the new one. */
+#define ESM_OVERFLOW_DROP_OLDEST    ((ESM_OVERFLOW_POLICY) 1)   /**< Drop the oldest one to accept the new one. */
+#define ESM_OVERFLOW_BLOCK          ((ESM_OVERFLOW_POLICY) 2)   /**< Wait for a space (up to the timeout). */
+
 /* ---------------------------------------------------------------------- */
 /* Data structures */
 /* ---------------------------------------------------------------------- */
 
+/**
+ * Event record type (event ID with the payload, see ESM_CFG_USE_EVENT_RECORD).
+ * The payload is either pointed by data (passed as is, not copied), or
+ * stored in bytes if data is NULL. The library points data to bytes before
+ * calling the handler, and calls release_data after the handler returns.
+ */
+typedef struct ESM_EVENT_RECORD ESM_EVENT_RECORD;
+/** Event record type. */
+struct ESM_EVENT_RECORD {
+    ESM_EVENT_ID id;
+    size_t size;                                /**< Size of the payload. */
+    void *data;                                 /**< Payload (NULL: in bytes). */
+    void (*release_data)(void * const data);    /**< May be NULL. */
+    unsigned char bytes[ESM_EVENT_INLINE_SIZE]; /**< Inline payload. */
+};
+
 /** Event handler type. */
 typedef struct ESM_EVENT_HANDLER ESM_EVENT_HANDLER;
 /** Event handler type. */
@@ -54,6 +108,24 @@ struct ESM_EVENT_HANDLER {
     void (*on_destroy)(void * const user_data);
     void (*release_user_data)(void * const user_data);
     void *user_data;
+
+    /**
+     * Called instead of on_event if not NULL (and ESM_CFG_USE_EVENT_RECORD
+     * is defined). To keep the payload after the call, take it over by
+     * setting record->release_data to NULL.
+     */
+    void (*on_event_record)(void * const user_data,
+                            ESM_EVENT_RECORD * const record);
+
+    /**
+     * Called instead of on_event with a run of the events if not NULL (and
+     * ESM_CFG_USE_EVENT_BATCH is defined). Return the number of the
+     * processed events (1 to n). After requesting a transition, return at
+     * once: the rest of the events are passed to the next handler.
+     */
+    size_t (*on_events)(void * const user_data,
+                        const ESM_EVENT_ID * const ids,
+                        const size_t n);
 };
 
 /** Generic handler type. */
@@ -70,6 +142,59 @@ typedef ESM_GENERIC_HANDLER ESM_TIMER_HANDLER;
 /** Message type. */
 typedef ESM_GENERIC_HANDLER ESM_MESSAGE;
 
+/** Timer statistics type. */
+typedef struct ESM_TIMER_STATS ESM_TIMER_STATS;
+/** Timer statistics type. */
+struct ESM_TIMER_STATS {
+    uint32_t expirations;   /**< Number of expired timers. */
+    uint32_t dispatches;    /**< Number of esm_ResumeAndYield() calls that expired timers. */
+};
+
+/**
+ * Timer lateness histogram type.
+ * buckets[0] counts the timers fired on time, buckets[k] counts the timers
+ * fired [2^(k-1), 2^k) microseconds late, and the last bucket also counts
+ * the later ones.
+ */
+typedef struct ESM_TIMER_LATENESS ESM_TIMER_LATENESS;
+/** Timer lateness histogram type. */
+struct ESM_TIMER_LATENESS {
+    uint32_t buckets[ESM_TIMER_LATENESS_BUCKETS];
+    uint32_t count;                 /**< Number of the recorded timers. */
+    ESM_SYS_TICK_USEC total_usec;   /**< Sum of the lateness. */
+    ESM_SYS_TICK_USEC max_usec;     /**< Maximum lateness. */
+};
+
+/**
+ * Queue backpressure policy type (see esm_SetMessageQueuePolicy()).
+ * on_high_water is called once the queue depth reaches high_water, and then
+ * on_low_water is called once the depth falls to low_water. The callbacks
+ * are called in esm_md_LockForAPI(), so they must not call the APIs.
+ */
+typedef struct ESM_QUEUE_POLICY ESM_QUEUE_POLICY;
+/** Queue backpressure policy type. */
+struct ESM_QUEUE_POLICY {
+    size_t capacity;                /**< Maximum depth (0: limited by the resources only). */
+    size_t high_water;              /**< High water mark (0: no callbacks). */
+    size_t low_water;               /**< Low water mark (less than high_water). */
+    void (*on_high_water)(void * const user_data);  /**< May be NULL. */
+    void (*on_low_water)(void * const user_data);   /**< May be NULL. */
+    void *user_data;
+    ESM_OVERFLOW_POLICY overflow;   /**< Policy when the queue is full. */
+    ESM_SYS_TICK_MSEC timeout_msec; /**< Timeout of ESM_OVERFLOW_BLOCK (ESM_WAIT_FOREVER: no timeout). */
+};
+
+/** Queue statistics type. */
+typedef struct ESM_QUEUE_STATS ESM_QUEUE_STATS;
+/** Queue statistics type. */
+struct ESM_QUEUE_STATS {
+    size_t depth;           /**< Number of the queued ones. */
+    size_t max_depth;       /**< Maximum depth. */
+    uint32_t rejected;      /**< Number of the rejected ones. */
+    uint32_t dropped;       /**< Number of the dropped ones (ESM_OVERFLOW_DROP_OLDEST). */
+    uint32_t blocked;       /**< Number of the posts that waited (ESM_OVERFLOW_BLOCK). */
+};
+
 /** Preparation parameters. */
 typedef struct ESM_PREPARE_PARAMS ESM_PREPARE_PARAMS;
 /** Preparation parameters. */
@@ -131,6 +256,50 @@ esm_PrepareBeforeMainLoop(const ESM_PREPARE_PARAMS * const params);
 extern ESM_ERR
 esm_ResumeAndYield(void);
 
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the work and run the main loop once.
+ *
+ * Block until an event or a message arrives, or the nearest timer expires
+ * (but no longer than the timeout), and then call esm_ResumeAndYield().
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *                          0: no wait.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_RunOnce(const ESM_SYS_TICK_MSEC timeout_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Run the main loop until esm_Stop() is called.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_Run(void);
+
+/* ********************************************************************** */
+/**
+ * @brief  Request esm_Run() to return.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  This function can be called from other threads.
+ *        If esm_Run() is not running, the next esm_Run() returns
+ *        immediately.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_Stop(void);
+
 /* ********************************************************************** */
 /**
  * @brief  Cleanup the library after main loop.
@@ -156,6 +325,26 @@ esm_CleanupAfterMainLoop(void);
 extern ESM_ERR
 esm_SetNextEventHandler(const ESM_EVENT_HANDLER * const handler);
 
+/* ********************************************************************** */
+/**
+ * @brief  Defer the event being processed until the next transition.
+ *
+ * Call this function in ESM_EVENT_HANDLER::on_event (or on_event_record)
+ * to keep the event in the deferred ring instead of re-posting it. When
+ * the event handler is changed next time, the deferred events are recalled
+ * in their original order, and processed before the event queue. The
+ * payload of the event record is kept until then.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MAX_DEFERRED_EVENTS is not defined.
+ * @retval ESM_E_RES     No system resources (the deferred ring is full).
+ * @retval ESM_E_STATUS  Internal status error (not in the dispatch of the
+ *                       event, e.g. in on_events, or already deferred).
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_DeferEvent(void);
+
 /* ********************************************************************** */
 /**
  * @brief  Create and start the software timer.
@@ -174,6 +363,27 @@ esm_SetTimer(const ESM_TIMER_ID id,
              const ESM_SYS_TICK_MSEC timeout_msec,
              const bool repeat);
 
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the software timer (in microseconds).
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetTimerUsec(const ESM_TIMER_ID id,
+                 const ESM_SYS_TICK_USEC timeout_usec,
+                 const bool repeat);
+
 /* ********************************************************************** */
 /**
  * @brief  Stop and delete the software timer.
@@ -188,6 +398,28 @@ esm_SetTimer(const ESM_TIMER_ID id,
 extern ESM_ERR
 esm_KillTimer(const ESM_TIMER_ID id);
 
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the software timer.
+ *
+ * @param[in] id          Timer ID.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next start (or reschedule),
+ *        and kept until esm_CleanupAfterMainLoop() is called.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetTimerSlack(const ESM_TIMER_ID id,
+                  const ESM_SYS_TICK_MSEC slack_msec);
+
 /* ********************************************************************** */
 /**
  * @brief  Create and start the global software timer.
@@ -199,7 +431,11 @@ esm_KillTimer(const ESM_TIMER_ID id);
  *
  * @retval ESM_E_OK      Exit success.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
- * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_STATUS  Internal status error (the timer is running, or
+ *                       in its handler).
+ *
+ * @note  The timer cannot be restarted in its own handler: the user data
+ *        of a one-shot timer is released after the call.
  */
 /* ********************************************************************** */
 extern ESM_ERR
@@ -208,6 +444,29 @@ esm_SetGlobalTimer(const ESM_TIMER_ID id,
                    const bool repeat,
                    const ESM_TIMER_HANDLER * const handler);
 
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the global software timer (in microseconds).
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ * @param[in] handler       Timer handler.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetGlobalTimerUsec(const ESM_TIMER_ID id,
+                       const ESM_SYS_TICK_USEC timeout_usec,
+                       const bool repeat,
+                       const ESM_TIMER_HANDLER * const handler);
+
 /* ********************************************************************** */
 /**
  * @brief  Stop and delete the global software timer.
@@ -222,6 +481,143 @@ esm_SetGlobalTimer(const ESM_TIMER_ID id,
 extern ESM_ERR
 esm_KillGlobalTimer(const ESM_TIMER_ID id);
 
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the global software timer.
+ *
+ * @param[in] id          Timer ID.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next start (or reschedule),
+ *        and kept until esm_CleanupAfterMainLoop() is called.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetGlobalTimerSlack(const ESM_TIMER_ID id,
+                        const ESM_SYS_TICK_MSEC slack_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Create the timer handle.
+ *
+ * The timer handle is a global timer allocated from the pool
+ * (ESM_CFG_MAX_TIMER_HANDLE), so it is not stopped at the state transition.
+ * The handler is called every time the timer expires, and
+ * release_user_data is called in esm_DestroyTimer().
+ *
+ * @param[in]  handler  Timer handler (called when the timer expires).
+ * @param[out] handle   Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer is not started yet. Call esm_ArmTimer().
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_CreateTimer(const ESM_TIMER_HANDLER * const handler,
+                ESM_TIMER_HANDLE * const handle);
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or restart) the timer.
+ *
+ * @param[in] handle        Timer handle.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_ArmTimer(const ESM_TIMER_HANDLE handle,
+             const ESM_SYS_TICK_MSEC timeout_msec,
+             const bool repeat);
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or restart) the timer (in microseconds).
+ *
+ * @param[in] handle        Timer handle.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_ArmTimerUsec(const ESM_TIMER_HANDLE handle,
+                 const ESM_SYS_TICK_USEC timeout_usec,
+                 const bool repeat);
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer.
+ *
+ * @param[in] handle  Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer handle is still valid. It is OK to stop the stopped timer.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_CancelTimer(const ESM_TIMER_HANDLE handle);
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer and destroy the timer handle.
+ *
+ * @param[in] handle  Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_DestroyTimer(const ESM_TIMER_HANDLE handle);
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the timer handle.
+ *
+ * @param[in] handle      Timer handle.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next esm_ArmTimer() call (or
+ *        reschedule), and kept until the handle is destroyed.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetTimerHandleSlack(const ESM_TIMER_HANDLE handle,
+                        const ESM_SYS_TICK_MSEC slack_msec);
+
 /* ********************************************************************** */
 /**
  * @brief  Post the message to the mein loop.
@@ -237,6 +633,325 @@ esm_KillGlobalTimer(const ESM_TIMER_ID id);
 extern ESM_ERR
 esm_PostMessage(const ESM_MESSAGE * const msg);
 
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop with the priority.
+ *
+ * The main loop processes the messages of the higher priority (numerically
+ * lower) first, and the messages of the same priority in order.
+ * esm_PostMessage() and the other post functions use the lowest priority
+ * (ESM_CFG_PRIORITIES - 1).
+ *
+ * @param[in] msg       Message.
+ * @param[in] priority  Priority (0 to ESM_CFG_PRIORITIES - 1).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_PRIORITIES is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_PostPriorityMessage(const ESM_MESSAGE * const msg,
+                        const ESM_PRIORITY priority);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the messages to the mein loop at once.
+ *
+ * The messages are posted in order under one lock (or with one atomic
+ * splice if ESM_CFG_USE_MPSC_QUEUE is defined). If the message cells run
+ * out, the first *posted messages are posted and the rest are not
+ * (ESM_E_RES). If any message has no function, nothing is posted
+ * (ESM_E_PRM). With the backpressure policy (esm_SetMessageQueuePolicy()),
+ * the messages count against the capacity one by one, and the ones already
+ * posted are queued before the overflow policy drops or waits.
+ *
+ * @param[in]  msgs    Messages.
+ * @param[in]  n       Number of the messages.
+ * @param[out] posted  Number of the posted messages (may be NULL).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_PostMessages(const ESM_MESSAGE * const msgs,
+                 const size_t n,
+                 size_t * const posted);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message with the inline payload to the mein loop.
+ *
+ * The payload is copied into the message cell, and func is called with the
+ * pointer to the copy. The copy is valid only during the call of func, and
+ * needs no release.
+ *
+ * @param[in] func  Message function.
+ * @param[in] data  Payload (may be NULL if size is 0).
+ * @param[in] size  Size of the payload (ESM_CFG_MESSAGE_PAYLOAD_SIZE or less).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_PAYLOAD_SIZE is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_PostMessageData(void (* const func)(void * const data),
+                    const void * const data,
+                    const size_t size);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop, and wait until it is processed.
+ *
+ * The message is queued in the same order as esm_PostMessage(). The caller
+ * waits on the completion slot in the message cell, so nothing is
+ * allocated but the cell. If the timeout elapses, the message is still
+ * processed later (but nobody waits for it).
+ *
+ * @param[in] msg           Message.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *
+ * @retval ESM_E_OK       Exit success (the message is processed).
+ * @retval ESM_E_NG       ESM_CFG_USE_INVOKE is not defined.
+ * @retval ESM_E_PRM      Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES      No system resources (or the message is dropped by
+ *                        ESM_OVERFLOW_DROP_OLDEST).
+ * @retval ESM_E_STATUS   Internal status error.
+ * @retval ESM_E_TIMEOUT  Timed out.
+ *
+ * @note  Do not call this function from the main loop (e.g. in the message
+ *        functions and the event handlers): it waits for the main loop
+ *        itself, so it never succeeds.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_Invoke(const ESM_MESSAGE * const msg, const ESM_SYS_TICK_MSEC timeout_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Create the message producer (for the calling thread).
+ *
+ * The producer has its own single-producer/single-consumer message queue,
+ * so esm_PostProducerMessage() needs neither esm_md_LockForAPI() nor the
+ * message cells. The main loop drains the producers' queues in
+ * round-robin, ESM_CFG_MESSAGE_SHARD_BUDGET messages at a time.
+ *
+ * Ordering: the messages of one producer are processed in the posted
+ * order. There is no ordering among the producers, nor between the
+ * producer's messages and the messages of esm_PostMessage().
+ *
+ * @param[out] id  Producer ID.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources (all producers in use).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_CreateProducer(ESM_PRODUCER_ID * const id);
+
+/* ********************************************************************** */
+/**
+ * @brief  Destroy the message producer.
+ *
+ * @param[in] id  Producer ID.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The messages already posted are still processed.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_DestroyProducer(const ESM_PRODUCER_ID id);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop via the producer's queue.
+ *
+ * @param[in] id   Producer ID.
+ * @param[in] msg  Message.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources (the queue is full).
+ * @retval ESM_E_STATUS  Internal status error (the producer is destroyed).
+ *
+ * @note  Lock-free. Only one thread may post with the same producer at a
+ *        time, until esm_DestroyProducer() or esm_CleanupAfterMainLoop().
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_PostProducerMessage(const ESM_PRODUCER_ID id, const ESM_MESSAGE * const msg);
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the backpressure policy of the message queue.
+ *
+ * The policy applies to the messages posted by esm_PostMessage(),
+ * esm_PostPriorityMessage(), esm_PostMessages() and esm_PostMessageData().
+ * The queue is full if the depth reaches the capacity or no message cell
+ * is left. Then the post function rejects the message (ESM_E_RES), drops
+ * the oldest queued message (of the lowest priority, its func is not
+ * called but release_user_data is, without the API lock), or waits for a
+ * space. Do not use ESM_OVERFLOW_BLOCK from the main loop. The policy and
+ * the statistics are reset in esm_PrepareBeforeMainLoop().
+ *
+ * @param[in] policy  Backpressure policy.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_BACKPRESSURE is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  With ESM_CFG_USE_MPSC_QUEUE, ESM_OVERFLOW_DROP_OLDEST works as
+ *        ESM_OVERFLOW_REJECT (the queued messages belong to the consumer).
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_SetMessageQueuePolicy(const ESM_QUEUE_POLICY * const policy);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the message queue.
+ *
+ * @param[out] stats  Statistics.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_BACKPRESSURE is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetMessageQueueStats(ESM_QUEUE_STATS * const stats);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the time when esm_ResumeAndYield() should be called next.
+ *
+ * @param[out] deadline_msec  Deadline (system tick in milliseconds).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_NOENT   No timer, message and event to wait for.
+ *
+ * @note  If there are pending messages or events (or expired timers),
+ *        the deadline is the current system tick.
+ *        The main loop can sleep until the deadline (or until a new
+ *        message/event arrives).
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetNextDeadline(ESM_SYS_TICK_MSEC * const deadline_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the time when esm_ResumeAndYield() should be called next
+ *         (in microseconds).
+ *
+ * @param[out] deadline_usec  Deadline (system tick in microseconds).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_NOENT   No timer, message and event to wait for.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the deadline is the millisecond
+ *        system tick multiplied by 1000.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetNextDeadlineUsec(ESM_SYS_TICK_USEC * const deadline_usec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the timer statistics.
+ *
+ * @param[out] stats  Timer statistics.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The coalescing ratio is (stats->expirations / stats->dispatches).
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetTimerStats(ESM_TIMER_STATS * const stats);
+
+/* ********************************************************************** */
+/**
+ * @brief  Clear the timer statistics.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_ClearTimerStats(void);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the lateness histogram of the timers.
+ *
+ * @param[out] lateness  Lateness histogram.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The lateness is measured when the timer is found expired in
+ *        esm_ResumeAndYield(), so it includes the time spent by the
+ *        preceding handlers (i.e. the jitter under load).
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetTimerLateness(ESM_TIMER_LATENESS * const lateness);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the lateness histogram of the global timers and the timer handles.
+ *
+ * @param[out] lateness  Lateness histogram.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_GetGlobalTimerLateness(ESM_TIMER_LATENESS * const lateness);
+
+/* ********************************************************************** */
+/**
+ * @brief  Clear the lateness histograms.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+extern ESM_ERR
+esm_ClearTimerLateness(void);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* def __cplusplus */
@@ -8,8 +8,26 @@
 
 #include "esm.h"
 #include "esm_md.h"
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+#include "esm_timer_wheel.h"
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+#include "esm_timer_soa.h"
+#endif
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+#include "esm_mpsc_queue.h"
+#endif
+#ifdef ESM_CFG_MESSAGE_SHARDS
+#include "esm_spsc_queue.h"
+#endif
+#ifdef ESM_CFG_PRIORITIES
+#include "esm_priority.h"
+#endif
 
 #include <stddef.h>
+#ifdef ESM_CFG_MESSAGE_PAYLOAD_SIZE
+#include <string.h>
+#endif
 
 #ifdef ESM_CFG_USE_ASSERT_H
 #include <assert.h>
@@ -17,47 +35,242 @@
 #define assert(cond)
 #endif
 
+#if defined(ESM_CFG_USE_TIMER_WHEEL) && defined(ESM_CFG_USE_TIMER_SOA)
+#error "ESM_CFG_USE_TIMER_WHEEL and ESM_CFG_USE_TIMER_SOA are exclusive."
+#endif
+
+#if defined(ESM_CFG_USE_MPSC_QUEUE) && defined(ESM_CFG_PRIORITIES)
+#error "ESM_CFG_USE_MPSC_QUEUE and ESM_CFG_PRIORITIES are exclusive."
+#endif
+
+#ifdef ESM_CFG_USE_TIMER_SOA
+/** Number of blocks of the timer table. */
+#define TIMER_SOA_BLOCKS ESM_TS_NUM_BLOCKS(ESM_CFG_MAX_TIMER)
+
+/** Number of blocks of the global timer table. */
+#define GLOBAL_TIMER_SOA_BLOCKS \
+    ESM_TS_NUM_BLOCKS(ESM_CFG_MAX_GLOBAL_TIMER + ESM_CFG_MAX_TIMER_HANDLE)
+#endif
+
+#if !defined(ESM_CFG_EVENT_BUDGET) && defined(ESM_CFG_EVENT_TIME_BUDGET_USEC)
+/** Unlimited: the time budget limits the events (see esm_config.h). */
+#define ESM_CFG_EVENT_BUDGET UINT32_MAX
+#elif !defined(ESM_CFG_EVENT_BUDGET)
+/** Maximum number of events processed per iteration (see esm_config.h). */
+#define ESM_CFG_EVENT_BUDGET 1
+#endif
+
+#if ESM_CFG_EVENT_BUDGET < 1
+#error "ESM_CFG_EVENT_BUDGET must be 1 or more."
+#endif
+
+#if defined(ESM_CFG_USE_EVENT_BATCH) && !defined(ESM_CFG_EVENT_BATCH_SIZE)
+/** Maximum number of events peeked at once (see esm_config.h). */
+#define ESM_CFG_EVENT_BATCH_SIZE 16
+#endif
+
+#if defined(ESM_CFG_USE_EVENT_BATCH) && defined(ESM_CFG_USE_EVENT_RECORD)
+#error "ESM_CFG_USE_EVENT_BATCH and ESM_CFG_USE_EVENT_RECORD are exclusive."
+#endif
+
+#if defined(ESM_CFG_MAX_DEFERRED_EVENTS) && (ESM_CFG_MAX_DEFERRED_EVENTS < 1)
+#error "ESM_CFG_MAX_DEFERRED_EVENTS must be 1 or more."
+#endif
+
+#if defined(ESM_CFG_MESSAGE_SHARDS) && !defined(ESM_CFG_MESSAGE_SHARD_BUDGET)
+/** Number of messages processed from one producer in a row (see esm_config.h). */
+#define ESM_CFG_MESSAGE_SHARD_BUDGET 8
+#endif
+
 /* ---------------------------------------------------------------------- */
 /* Data structures */
 /* ---------------------------------------------------------------------- */
 
 /** Timer cell type. */
 typedef struct {
-    ESM_SYS_TICK_MSEC timeout_msec;
-    ESM_SYS_TICK_MSEC expire_time_msec;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    ESM_TW_NODE node;
+#endif
+    ESM_SYS_TICK timeout;
+    ESM_SYS_TICK due_time;
+    ESM_SYS_TICK expire_time;
+    ESM_SYS_TICK slack_mask;
     bool expired;
     bool repeat;
+    uint32_t epoch;
 } ESM_TIMER_CELL;
 
 /** Timer handler cell type. */
 typedef struct {
-    ESM_SYS_TICK_MSEC timeout_msec;
-    ESM_SYS_TICK_MSEC expire_time_msec;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    ESM_TW_NODE node;
+#endif
+    ESM_SYS_TICK timeout;
+    ESM_SYS_TICK due_time;
+    ESM_SYS_TICK expire_time;
+    ESM_SYS_TICK slack_mask;
     bool expired;
     bool repeat;
+    bool dispatching;       /* One-shot global timer in its handler. */
     ESM_TIMER_HANDLER handler;
+
+    /* For timer handles only. */
+    bool allocated;
+    uint16_t generation;
+    uint32_t next_free;
 } ESM_TIMER_HANDLER_CELL;
 
+#ifdef ESM_CFG_MESSAGE_SHARDS
+/** Message shard type (message queue of a producer). */
+typedef struct {
+    bool created;
+    ESM_SPSC_QUEUE queue;
+} ESM_MESSAGE_SHARD;
+#endif
+
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+/** Deferred event type (see esm_DeferEvent()). */
+#ifdef ESM_CFG_USE_EVENT_RECORD
+typedef ESM_EVENT_RECORD ESM_DEFERRED_EVENT;
+#else
+typedef ESM_EVENT_ID ESM_DEFERRED_EVENT;
+#endif
+#endif
+
 /** Module context type. */
 typedef struct {
     bool initialized;
     bool prepared;
+    bool stop_requested;
 
     /* Message queue. */
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    ESM_MPSC_QUEUE message_queue;
+#elif defined(ESM_CFG_PRIORITIES)
+    ESM_MESSAGE_CELL *first_message_cells[ESM_CFG_PRIORITIES];
+    ESM_MESSAGE_CELL *last_message_cells[ESM_CFG_PRIORITIES];
+    ESM_PRIORITY_SET message_lanes;
+    size_t num_messages;
+#else
     ESM_MESSAGE_CELL *first_message_cell;
     ESM_MESSAGE_CELL *last_message_cell;
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    /* Backpressure of the message queue (see esm_SetMessageQueuePolicy()). */
+    ESM_QUEUE_POLICY message_policy;
+    ESM_QUEUE_STATS message_stats;
+    bool above_high_water;
+    uint32_t blocked_producers;
+#endif
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    /* Per-producer message queues (see esm_CreateProducer()). */
+    ESM_MESSAGE_SHARD message_shards[ESM_CFG_MESSAGE_SHARDS];
+    uint32_t next_message_shard;
+#endif
 
     /* Event handlers. */
     ESM_EVENT_HANDLER event_handler;
     ESM_EVENT_HANDLER next_event_handler;
 
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    /* Deferred events (ring). The first num_recalled ones are recalled. */
+    ESM_DEFERRED_EVENT deferred_events[ESM_CFG_MAX_DEFERRED_EVENTS];
+    uint32_t first_deferred_event;
+    uint32_t num_deferred_events;
+    uint32_t num_recalled_events;
+
+#ifdef ESM_CFG_USE_EVENT_BATCH
+    /* Rest of the batch held over behind the recalled events (ring). */
+    ESM_EVENT_ID held_events[ESM_CFG_EVENT_BATCH_SIZE];
+    uint32_t first_held_event;
+    uint32_t num_held_events;
+#endif
+
+    /* Event in the dispatch (NULL: none, or not deferrable). */
+    ESM_DEFERRED_EVENT *current_event;
+#endif
+
     /* Timer handlers */
     ESM_TIMER_CELL timers[ESM_CFG_MAX_TIMER];
+    uint32_t timer_epoch;
+    ESM_TIMER_STATS timer_stats;
+
+    /* Global timer's handlers (and timer handles) */
+    ESM_TIMER_HANDLER_CELL global_timers[ESM_CFG_MAX_GLOBAL_TIMER + ESM_CFG_MAX_TIMER_HANDLE];
+    uint32_t free_timer_handle;
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    /* Timing wheels (for timers and global timers) */
+    ESM_TIMER_WHEEL timer_wheel;
+    ESM_TIMER_WHEEL global_timer_wheel;
+#endif
 
-    /* Global timer's handlers */
-    ESM_TIMER_HANDLER_CELL global_timers[ESM_CFG_MAX_GLOBAL_TIMER];
+#ifdef ESM_CFG_USE_LOOP_TIME
+    /* System tick cached at the beginning of esm_ResumeAndYield(). */
+    ESM_SYS_TICK loop_time;
+    bool loop_time_valid;
+#endif
+
+#ifdef ESM_CFG_USE_TIMER_LATENESS
+    /* Lateness histograms (for timers and global timers) */
+    ESM_TIMER_LATENESS timer_lateness;
+    ESM_TIMER_LATENESS global_timer_lateness;
+#endif
+
+#ifdef ESM_CFG_USE_TIMER_SOA
+    /* Structure-of-arrays timer tables (for timers and global timers) */
+    ESM_TIMER_SOA timer_soa;
+    ESM_SYS_TICK timer_expire_times[TIMER_SOA_BLOCKS * ESM_TS_BLOCK_SIZE];
+    uint32_t timer_active[TIMER_SOA_BLOCKS];
+
+    ESM_TIMER_SOA global_timer_soa;
+    ESM_SYS_TICK global_timer_expire_times[GLOBAL_TIMER_SOA_BLOCKS * ESM_TS_BLOCK_SIZE];
+    uint32_t global_timer_active[GLOBAL_TIMER_SOA_BLOCKS];
+#endif
 } MODULE_CTX;
 
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of bits of the cell index in the timer handle. */
+#define TIMER_HANDLE_INDEX_BITS 20
+
+/** Bit mask of the cell index in the timer handle. */
+#define TIMER_HANDLE_INDEX_MASK ((((ESM_TIMER_HANDLE) 1) << TIMER_HANDLE_INDEX_BITS) - 1)
+
+/** Bit mask of the generation in the timer handle. */
+#define TIMER_HANDLE_GENERATION_MASK (0xFFFFFFFFUL >> TIMER_HANDLE_INDEX_BITS)
+
+/** End of the free list. */
+#define FREE_LIST_END UINT32_MAX
+
+/** Maximum value of ESM_SYS_TICK_MSEC type (signed integer). */
+#define MSEC_MAX \
+    ((((ESM_SYS_TICK_MSEC) 1 << (sizeof(ESM_SYS_TICK_MSEC) * 8 - 2)) - 1) \
+     * 2 + 1)
+
+#if (ESM_CFG_MAX_GLOBAL_TIMER + ESM_CFG_MAX_TIMER_HANDLE) > (1UL << TIMER_HANDLE_INDEX_BITS)
+#error "ESM_CFG_MAX_GLOBAL_TIMER + ESM_CFG_MAX_TIMER_HANDLE is too large."
+#endif
+
+/** Priority of the messages posted without priority (the lowest). */
+#ifdef ESM_CFG_PRIORITIES
+#define LOWEST_PRIORITY ((ESM_PRIORITY) (ESM_CFG_PRIORITIES - 1))
+#else
+#define LOWEST_PRIORITY ((ESM_PRIORITY) 0)
+#endif
+
+#ifdef ESM_CFG_USE_INVOKE
+/* States of the completion slot of esm_Invoke(). */
+#define INVOKE_PENDING      0   /**< Waited by esm_Invoke(). */
+#define INVOKE_DONE         1   /**< Processed (esm_Invoke() deletes the cell). */
+#define INVOKE_DROPPED      2   /**< Dropped (esm_Invoke() deletes the cell). */
+#define INVOKE_ABANDONED    3   /**< Not waited (the main loop deletes the cell). */
+#endif
+
 /* ---------------------------------------------------------------------- */
 /* File scope variables */
 /* ---------------------------------------------------------------------- */
@@ -80,6 +293,340 @@ static MODULE_CTX module_ctx;
 /* ====================================================================== */
 #define NELEMS(array) (sizeof(array) / sizeof((array)[0]))
 
+/* ====================================================================== */
+/**
+ * @brief  Convert milliseconds to system ticks.
+ *
+ * @param[in] msec  Time in milliseconds.
+ *
+ * @return  Time in system ticks.
+ */
+/* ====================================================================== */
+#ifdef ESM_CFG_USE_TICK_USEC
+#define TICK_FROM_MSEC(msec) ((ESM_SYS_TICK) (msec) * 1000)
+#else
+#define TICK_FROM_MSEC(msec) ((ESM_SYS_TICK) (msec))
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Convert system ticks to microseconds.
+ *
+ * @param[in] tick  Time in system ticks.
+ *
+ * @return  Time in microseconds.
+ */
+/* ====================================================================== */
+#ifdef ESM_CFG_USE_TICK_USEC
+#define TICK_TO_USEC(tick) ((ESM_SYS_TICK_USEC) (tick))
+#else
+#define TICK_TO_USEC(tick) ((ESM_SYS_TICK_USEC) (tick) * 1000)
+#endif
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+/* ====================================================================== */
+/**
+ * @brief  Return the pointer of the structure from the member's pointer.
+ *
+ * @param[in] ptr     Pointer of the member.
+ * @param[in] type    Structure type.
+ * @param[in] member  Member name.
+ *
+ * @return  Pointer of the structure.
+ */
+/* ====================================================================== */
+#define CONTAINER_OF(ptr, type, member) \
+    ((type *) (void *) ((char *) (ptr) - offsetof(type, member)))
+#endif /* def ESM_CFG_USE_TIMER_WHEEL */
+
+/* ====================================================================== */
+/**
+ * @brief  Record the lateness of the expired timer.
+ *
+ * @param[in,out] lateness      Lateness histogram.
+ * @param[in]     current_time  Current system tick.
+ * @param[in]     expire_time   Expiration time of the timer.
+ *
+ * @note  Expands to nothing without ESM_CFG_USE_TIMER_LATENESS.
+ */
+/* ====================================================================== */
+#ifdef ESM_CFG_USE_TIMER_LATENESS
+#define RECORD_LATENESS(lateness, current_time, expire_time) \
+    record_lateness((lateness), (current_time) - (expire_time))
+#else
+#define RECORD_LATENESS(lateness, current_time, expire_time)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: system tick */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Get system tick value.
+ *
+ * @return  System tick (in milliseconds or microseconds).
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+get_tick(void)
+{
+#ifdef ESM_CFG_USE_TICK_USEC
+    return esm_md_GetTickUsec();
+#else
+    return esm_md_GetTick();
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Get the current time for the timers.
+ *
+ * @param[in] mc  Module context.
+ *
+ * @return  System tick (cached in esm_ResumeAndYield() if
+ *          ESM_CFG_USE_LOOP_TIME is defined).
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+get_loop_time(const MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_USE_LOOP_TIME
+    if (mc->loop_time_valid) {
+        return mc->loop_time;
+    }
+#else
+    (void) mc;
+#endif
+
+    return get_tick();
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Convert microseconds to system ticks (round up).
+ *
+ * @param[in] usec  Time in microseconds.
+ *
+ * @return  Time in system ticks.
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+usec_to_tick_ceil(const ESM_SYS_TICK_USEC usec)
+{
+#ifdef ESM_CFG_USE_TICK_USEC
+    return usec;
+#else
+    ESM_SYS_TICK_USEC msec;
+
+    msec = usec / 1000;
+    if ((usec % 1000) > 0) {
+        msec++;
+    }
+
+    return (ESM_SYS_TICK) msec;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Convert system ticks to milliseconds (round up).
+ *
+ * @param[in] tick  Time in system ticks.
+ *
+ * @return  Time in milliseconds.
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+tick_to_msec_ceil(const ESM_SYS_TICK tick)
+{
+#ifdef ESM_CFG_USE_TICK_USEC
+    ESM_SYS_TICK msec;
+
+    msec = tick / 1000;
+    if ((tick % 1000) > 0) {
+        msec++;
+    }
+
+    return msec;
+#else
+    return tick;
+#endif
+}
+
+#if defined(ESM_CFG_USE_BACKPRESSURE) || defined(ESM_CFG_USE_INVOKE)
+/* ====================================================================== */
+/**
+ * @brief  Return the time to wait until the deadline.
+ *
+ * @param[in] timeout_msec  Timeout value of the wait (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ * @param[in] deadline      Deadline of the wait (ignored if no timeout).
+ *
+ * @return  Time to wait in milliseconds (0: timed out, ESM_WAIT_FOREVER: no
+ *          timeout).
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK_MSEC
+get_wait_msec(const ESM_SYS_TICK_MSEC timeout_msec, const ESM_SYS_TICK deadline)
+{
+    ESM_SYS_TICK remain;
+
+    if (timeout_msec <= 0) {
+        return timeout_msec;
+    }
+
+    remain = deadline - get_tick();
+    if (remain <= 0) {
+        return 0;
+    }
+    remain = tick_to_msec_ceil(remain);
+
+    return (remain > MSEC_MAX) ? MSEC_MAX : (ESM_SYS_TICK_MSEC) remain;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: timer slack */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Convert the timer slack to the bit mask of the expiration time.
+ *
+ * @param[in] slack  Timer slack (in system ticks,
+ *                   0 to TICK_FROM_MSEC(ESM_TIMER_SLACK_MSEC_MAX)).
+ *
+ * @return  Bit mask (the granularity of the expiration time minus 1).
+ *
+ * @note  The granularity is the largest power of 2 that is less than or
+ *        equal to (slack + 1), so the rounded expiration time never exceeds
+ *        the tolerance. The upper limit keeps the granularity far below
+ *        the half range of the system tick, so neither the granularity nor
+ *        the wrap-around comparison of the expiration time overflows.
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+slack_to_mask(const ESM_SYS_TICK slack)
+{
+    ESM_SYS_TICK granularity;
+
+    assert((slack >= 0) && (slack <= TICK_FROM_MSEC(ESM_TIMER_SLACK_MSEC_MAX)));
+
+    granularity = 1;
+    while (granularity <= (slack - granularity + 1)) {
+        granularity *= 2;
+    }
+
+    return granularity - 1;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Round up the due time within the timer slack.
+ *
+ * @param[in] due_time    Due time (in system ticks).
+ * @param[in] slack_mask  Bit mask from slack_to_mask().
+ *
+ * @return  Expiration time.
+ *
+ * @note  Timers with the same granularity that are due in the same aligned
+ *        window expire at the same time, so they are dispatched together.
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK
+apply_slack(const ESM_SYS_TICK due_time, const ESM_SYS_TICK slack_mask)
+{
+    uintmax_t remainder;
+
+    remainder = (uintmax_t) due_time & (uintmax_t) slack_mask;
+    if (remainder == 0) {
+        return due_time;
+    }
+
+    return due_time + (ESM_SYS_TICK) ((uintmax_t) slack_mask + 1 - remainder);
+}
+
+#ifdef ESM_CFG_USE_TIMER_LATENESS
+/* ---------------------------------------------------------------------- */
+/* Private functions: timer lateness */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Record the lateness of the expired timer.
+ *
+ * @param[in,out] lateness  Lateness histogram.
+ * @param[in]     late      Lateness (in system ticks).
+ */
+/* ====================================================================== */
+static void
+record_lateness(ESM_TIMER_LATENESS * const lateness, const ESM_SYS_TICK late)
+{
+    ESM_SYS_TICK_USEC usec, rest;
+    size_t bucket;
+
+    assert(lateness != NULL);
+
+    usec = (late > 0) ? TICK_TO_USEC(late) : 0;
+
+    /* bucket = floor(log2(usec)) + 1 (0 if usec == 0) */
+    bucket = 0;
+    rest = usec;
+    while ((rest > 0) && (bucket < (NELEMS(lateness->buckets) - 1))) {
+        bucket++;
+        rest /= 2;
+    }
+
+    lateness->buckets[bucket]++;
+    lateness->count++;
+    lateness->total_usec += usec;
+    if (usec > lateness->max_usec) {
+        lateness->max_usec = usec;
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Clear the lateness histogram.
+ *
+ * @param[out] lateness  Lateness histogram.
+ */
+/* ====================================================================== */
+static void
+clear_lateness(ESM_TIMER_LATENESS * const lateness)
+{
+    size_t i;
+
+    assert(lateness != NULL);
+
+    for (i = 0; i < NELEMS(lateness->buckets); i++) {
+        lateness->buckets[i] = 0;
+    }
+    lateness->count = 0;
+    lateness->total_usec = 0;
+    lateness->max_usec = 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Clear the lateness histograms.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+clear_timer_lateness(MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+    clear_lateness(&mc->timer_lateness);
+    clear_lateness(&mc->global_timer_lateness);
+}
+#endif /* def ESM_CFG_USE_TIMER_LATENESS */
+
 /* ---------------------------------------------------------------------- */
 /* Private functions: dummy callback functions */
 /* ---------------------------------------------------------------------- */
@@ -160,6 +707,8 @@ eeh_Cleanup(ESM_EVENT_HANDLER * const handler)
     handler->on_destroy = NULL;
     handler->release_user_data = NULL;
     handler->user_data = NULL;
+    handler->on_event_record = NULL;
+    handler->on_events = NULL;
 }
 
 /* ====================================================================== */
@@ -247,10 +796,16 @@ etc_Initialize(ESM_TIMER_CELL * const cell)
 {
     assert(cell != NULL);
 
-    cell->timeout_msec = 0;
-    cell->expire_time_msec = 0;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_InitializeNode(&cell->node);
+#endif
+    cell->timeout = 0;
+    cell->due_time = 0;
+    cell->expire_time = 0;
+    cell->slack_mask = 0;
     cell->expired = true;
     cell->repeat = false;
+    cell->epoch = 0;
 }
 
 /* ====================================================================== */
@@ -265,11 +820,19 @@ ethc_Initialize(ESM_TIMER_HANDLER_CELL * const cell)
 {
     assert(cell != NULL);
 
-    cell->timeout_msec = 0;
-    cell->expire_time_msec = 0;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_InitializeNode(&cell->node);
+#endif
+    cell->timeout = 0;
+    cell->due_time = 0;
+    cell->expire_time = 0;
+    cell->slack_mask = 0;
     cell->expired = true;
     cell->repeat = false;
+    cell->dispatching = false;
     eth_Cleanup(&cell->handler);
+    cell->allocated = false;
+    cell->next_free = FREE_LIST_END;
 }
 
 /* ====================================================================== */
@@ -297,6 +860,9 @@ emc_Create(const ESM_MESSAGE * const msg)
     cell->next = NULL;
     cell->message = *msg;
     em_Sanitize(&cell->message);
+#ifdef ESM_CFG_USE_INVOKE
+    cell->invoked = false;
+#endif
 
     return cell;
 }
@@ -319,16 +885,244 @@ emc_Delete(ESM_MESSAGE_CELL * const cell)
     esm_md_DeallocMessageCell(cell);
 }
 
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
 /* ---------------------------------------------------------------------- */
-/* Private functions: process event handler */
+/* Private functions: deferred events */
 /* ---------------------------------------------------------------------- */
 
-static void
-force_stop_timers(MODULE_CTX * const mc);
-
 /* ====================================================================== */
 /**
- * @brief  Set the default event handler.
+ * @brief  Set the event in the dispatch (the target of esm_DeferEvent()).
+ *
+ * @param[in,out] mc     Module context.
+ * @param[in]     event  Event in the dispatch (NULL: none).
+ */
+/* ====================================================================== */
+#define set_current_event(mc, event) ((mc)->current_event = (event))
+
+/* ====================================================================== */
+/**
+ * @brief  Clear the deferred events.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_deferred_events(MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+    mc->first_deferred_event = 0;
+    mc->num_deferred_events = 0;
+    mc->num_recalled_events = 0;
+#ifdef ESM_CFG_USE_EVENT_BATCH
+    mc->first_held_event = 0;
+    mc->num_held_events = 0;
+#endif
+    mc->current_event = NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Defer the event in the dispatch.
+ *
+ * If ESM_CFG_USE_EVENT_RECORD is defined, the payload is taken over (not
+ * released after the dispatch).
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_RES     No system resources (the ring is full).
+ * @retval ESM_E_STATUS  No event to defer.
+ */
+/* ====================================================================== */
+static ESM_ERR
+defer_current_event(MODULE_CTX * const mc)
+{
+    ESM_DEFERRED_EVENT *event;
+    uint32_t i;
+
+    assert(mc != NULL);
+
+    if (mc->current_event == NULL) {
+        return ESM_E_STATUS;
+    }
+    if (mc->num_deferred_events >= ESM_CFG_MAX_DEFERRED_EVENTS) {
+        return ESM_E_RES;
+    }
+
+    i = (mc->first_deferred_event + mc->num_deferred_events) % ESM_CFG_MAX_DEFERRED_EVENTS;
+    event = &mc->deferred_events[i];
+    *event = *mc->current_event;
+    mc->num_deferred_events++;
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    /* The inline payload is copied: point it again when recalled. */
+    if (event->data == mc->current_event->bytes) {
+        event->data = NULL;
+    }
+    mc->current_event->release_data = NULL;
+#endif
+
+    /* Deferred at most once per dispatch. */
+    mc->current_event = NULL;
+
+    return ESM_E_OK;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Recall all the deferred events (on the transition).
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+recall_deferred_events(MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+    mc->num_recalled_events = mc->num_deferred_events;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take the oldest recalled event.
+ *
+ * @param[in,out] mc     Module context.
+ * @param[out]    event  Event output place.
+ *
+ * @retval true   Exit success.
+ * @retval false  No recalled event.
+ */
+/* ====================================================================== */
+static bool
+take_recalled_event(MODULE_CTX * const mc, ESM_DEFERRED_EVENT * const event)
+{
+    assert((mc != NULL) && (event != NULL));
+
+    if (mc->num_recalled_events == 0) {
+        return false;
+    }
+
+    *event = mc->deferred_events[mc->first_deferred_event];
+    mc->first_deferred_event = (mc->first_deferred_event + 1) % ESM_CFG_MAX_DEFERRED_EVENTS;
+    mc->num_deferred_events--;
+    mc->num_recalled_events--;
+
+    return true;
+}
+
+#ifdef ESM_CFG_USE_EVENT_BATCH
+/* ====================================================================== */
+/**
+ * @brief  Hold over the rest of the batch (in front of the held events).
+ *
+ * @param[in,out] mc   Module context.
+ * @param[in]     ids  Event IDs.
+ * @param[in]     n    Number of the events.
+ *
+ * @note  The rest of the batch taken from the held events (or peeked while
+ *        no event is held) always fits in the ring.
+ */
+/* ====================================================================== */
+static void
+hold_events(MODULE_CTX * const mc,
+            const ESM_EVENT_ID * const ids,
+            const size_t n)
+{
+    size_t i;
+
+    assert((mc != NULL) && (ids != NULL));
+    assert((mc->num_held_events + n) <= ESM_CFG_EVENT_BATCH_SIZE);
+
+    for (i = n; i > 0; i--) {
+        mc->first_held_event = (mc->first_held_event + ESM_CFG_EVENT_BATCH_SIZE - 1) % ESM_CFG_EVENT_BATCH_SIZE;
+        mc->held_events[mc->first_held_event] = ids[i - 1];
+    }
+    mc->num_held_events += (uint32_t) n;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take the oldest held events.
+ *
+ * @param[in,out] mc   Module context.
+ * @param[out]    ids  Event IDs output place.
+ * @param[in]     n    Maximum number of the events.
+ *
+ * @return  Number of the events (0: no held event).
+ */
+/* ====================================================================== */
+static size_t
+take_held_events(MODULE_CTX * const mc,
+                 ESM_EVENT_ID * const ids,
+                 const size_t n)
+{
+    size_t count;
+
+    assert((mc != NULL) && (ids != NULL));
+
+    for (count = 0; (count < n) && (mc->num_held_events > 0); count++) {
+        ids[count] = mc->held_events[mc->first_held_event];
+        mc->first_held_event = (mc->first_held_event + 1) % ESM_CFG_EVENT_BATCH_SIZE;
+        mc->num_held_events--;
+    }
+
+    return count;
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Discard all the deferred events (and release their payloads).
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+discard_deferred_events(MODULE_CTX * const mc)
+{
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    ESM_EVENT_RECORD *record;
+    uint32_t i;
+#endif
+
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    for (i = 0; i < mc->num_deferred_events; i++) {
+        record = &mc->deferred_events[(mc->first_deferred_event + i) % ESM_CFG_MAX_DEFERRED_EVENTS];
+        if (record->release_data != NULL) {
+            record->release_data((record->data != NULL) ? record->data : record->bytes);
+        }
+    }
+#endif
+
+    initialize_deferred_events(mc);
+}
+#else
+/* ====================================================================== */
+/**
+ * @brief  Set the event in the dispatch (no-op: deferral is disabled).
+ *
+ * @param[in,out] mc     Module context.
+ * @param[in]     event  Event in the dispatch (NULL: none).
+ */
+/* ====================================================================== */
+#define set_current_event(mc, event) ((void) 0)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: process event handler */
+/* ---------------------------------------------------------------------- */
+
+static void
+force_stop_timers(MODULE_CTX * const mc);
+
+/* ====================================================================== */
+/**
+ * @brief  Set the default event handler.
  *
  * @param[in,out] mc               Module context.
  * @param[in]     default_handler  Event handler.
@@ -364,7 +1158,7 @@ set_next_event_handler(MODULE_CTX * const mc,
 {
     ESM_EVENT_HANDLER *handler;
 
-    assert((mc != NULL) && (handler != NULL));
+    assert((mc != NULL) && (next_handler != NULL));
 
     handler = &mc->next_event_handler;
     *handler = *next_handler;
@@ -401,6 +1195,10 @@ update_event_handler(MODULE_CTX * const mc)
     eeh_Cleanup(next_handler);
 
     handler->on_init(handler->user_data);
+
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    recall_deferred_events(mc);
+#endif
 }
 
 /* ====================================================================== */
@@ -433,193 +1231,324 @@ remove_event_handler(MODULE_CTX * const mc)
 /* Private functions: process event */
 /* ---------------------------------------------------------------------- */
 
+#ifdef ESM_CFG_USE_EVENT_RECORD
 /* ====================================================================== */
 /**
- * @brief  Process a event.
+ * @brief  Peek the event record (the recalled one first).
  *
- * @param[in,out] mc  Module context.
+ * @param[in,out] mc      Module context.
+ * @param[out]    record  Event record.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
  */
 /* ====================================================================== */
-static void
-process_event(MODULE_CTX * const mc)
+static bool
+peek_event_record(MODULE_CTX * const mc, ESM_EVENT_RECORD * const record)
 {
-    ESM_EVENT_ID id;
-    ESM_EVENT_HANDLER *handler;
+    assert((mc != NULL) && (record != NULL));
 
-    assert(mc != NULL);
-
-    id = esm_md_PeekEvent();
-    if (id == ESM_EVENT_ID_NONE) {
-        return;
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    if (take_recalled_event(mc, record)) {
+        return true;
     }
+#else
+    (void) mc;
+#endif
 
-    handler = &mc->event_handler;
-    handler->on_event(handler->user_data, id);
-
-    update_event_handler(mc);
+    return esm_md_PeekEventRecord(record);
 }
-
-/* ---------------------------------------------------------------------- */
-/* Private functions: process timer */
-/* ---------------------------------------------------------------------- */
-
+#elif defined(ESM_CFG_USE_EVENT_BATCH)
 /* ====================================================================== */
 /**
- * @brief  Validate timer id.
+ * @brief  Peek the events at once (the recalled ones first, and then the
+ *         held over ones).
  *
- * @param[in] mc  Module context.
- * @param[in] id  Timer ID.
+ * @param[in,out] mc   Module context.
+ * @param[out]    ids  Event IDs output place.
+ * @param[in]     n    Maximum number of the events (1 or more).
  *
- * @retval true   Valid.
- * @retval false  Invalid.
+ * @return  Number of the events (0: no event).
  */
 /* ====================================================================== */
-static bool
-valid_timer_id(const MODULE_CTX * const mc, const ESM_TIMER_ID id)
+static size_t
+peek_events(MODULE_CTX * const mc, ESM_EVENT_ID * const ids, const size_t n)
 {
-    assert(mc != NULL);
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    size_t count;
+#endif
 
-    return (size_t) id < NELEMS(mc->timers);
-}
+    assert((mc != NULL) && (ids != NULL) && (n > 0));
+
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    for (count = 0; count < n; count++) {
+        if (!take_recalled_event(mc, &ids[count])) {
+            break;
+        }
+    }
+    if (count > 0) {
+        return count;
+    }
+
+    count = take_held_events(mc, ids, n);
+    if (count > 0) {
+        return count;
+    }
+#else
+    (void) mc;
+#endif
 
+    return esm_md_PeekEvents(ids, n);
+}
+#else
 /* ====================================================================== */
 /**
- * @brief  Initialize global software timers.
+ * @brief  Peek the event (the recalled one first).
  *
  * @param[in,out] mc  Module context.
+ *
+ * @return  Event ID (ESM_EVENT_ID_NONE: no event).
  */
 /* ====================================================================== */
-static void
-initialize_timers(MODULE_CTX * const mc)
+static ESM_EVENT_ID
+peek_event(MODULE_CTX * const mc)
 {
-    size_t i;
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    ESM_EVENT_ID id;
+#endif
 
     assert(mc != NULL);
 
-    for (i = 0; i < NELEMS(mc->timers); i++) {
-        etc_Initialize(&mc->timers[i]);
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    if (take_recalled_event(mc, &id)) {
+        return id;
     }
+#else
+    (void) mc;
+#endif
+
+    return esm_md_PeekEvent();
 }
+#endif
 
 /* ====================================================================== */
 /**
- * @brief  Create and start the software timer.
+ * @brief  Process a event.
  *
- * @param[in,out] mc            Module context.
- * @param[in]     id            Timer ID.
- * @param[in]     timeout_msec  Timeout value (in milliseconds).
- * @param[in]     repeat        Repeatedly reschedule or not.
+ * @param[in,out] mc  Module context.
  *
- * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_STATUS  Internal status error.
+ * @retval true   Processed.
+ * @retval false  No event.
  */
 /* ====================================================================== */
-static ESM_ERR
-set_timer(MODULE_CTX * const mc,
-          const ESM_TIMER_ID id,
-          const ESM_SYS_TICK_MSEC timeout_msec,
-          const bool repeat)
+#ifdef ESM_CFG_USE_EVENT_RECORD
+static bool
+process_event(MODULE_CTX * const mc)
 {
-    ESM_TIMER_CELL *cell;
+    ESM_EVENT_RECORD record;
+    ESM_EVENT_HANDLER *handler;
 
-    assert((mc != NULL) && valid_timer_id(mc, id));
+    assert(mc != NULL);
 
-    cell = &mc->timers[id];
-    if (!cell->expired) {
-        return ESM_E_STATUS;
+    if (!peek_event_record(mc, &record)) {
+        return false;
+    }
+    if (record.data == NULL) {
+        record.data = record.bytes;
     }
 
-    cell->timeout_msec = timeout_msec;
-    cell->expire_time_msec = esm_md_GetTick() + timeout_msec;
-    cell->expired = false;
-    cell->repeat = repeat;
+    handler = &mc->event_handler;
+    set_current_event(mc, &record);
+    if (handler->on_event_record != NULL) {
+        handler->on_event_record(handler->user_data, &record);
+    } else {
+        handler->on_event(handler->user_data, record.id);
+    }
+    set_current_event(mc, NULL);
 
-    return ESM_E_OK;
-}
+    /* NULL if the handler took over the payload. */
+    if (record.release_data != NULL) {
+        record.release_data(record.data);
+    }
 
-/* ====================================================================== */
-/**
- * @brief  Stop and delete the software timer.
- *
- * @param[in,out] mc  Module context.
- * @param[in]     id  Timer ID.
- */
-/* ====================================================================== */
-static void
-kill_timer(MODULE_CTX * const mc, const ESM_TIMER_ID id)
-{
-    assert((mc != NULL) && valid_timer_id(mc, id));
+    update_event_handler(mc);
 
-    mc->timers[id].expired = true;
+    return true;
 }
-
-/* ====================================================================== */
-/**
- * @brief  Process software timers.
- *
- * @param[in,out] mc  Module context.
- */
-/* ====================================================================== */
-static void
-process_timers(MODULE_CTX * const mc)
+#elif !defined(ESM_CFG_USE_EVENT_BATCH)
+static bool
+process_event(MODULE_CTX * const mc)
 {
-    ESM_SYS_TICK_MSEC current_time;
+    ESM_EVENT_ID id;
     ESM_EVENT_HANDLER *handler;
-    size_t i;
 
     assert(mc != NULL);
 
-    current_time = esm_md_GetTick();
+    id = peek_event(mc);
+    if (id == ESM_EVENT_ID_NONE) {
+        return false;
+    }
+
     handler = &mc->event_handler;
+    set_current_event(mc, &id);
+    handler->on_event(handler->user_data, id);
+    set_current_event(mc, NULL);
 
-    for (i = 0; i < NELEMS(mc->timers); i++) {
-        ESM_TIMER_CELL *cell;
+    update_event_handler(mc);
 
-        cell = &mc->timers[i];
-        if (cell->expired) {
-            continue;
-        }
-        if ((current_time - cell->expire_time_msec) < 0) {
-            continue;
-        }
-        if (cell->repeat) {
-            cell->expire_time_msec += cell->timeout_msec;
-        } else {
-            cell->expired = true;
-        }
+    return true;
+}
+#endif
 
-        handler->on_timer(handler->user_data, (ESM_TIMER_ID) i);
+#ifdef ESM_CFG_USE_EVENT_BATCH
+/* ====================================================================== */
+/**
+ * @brief  Pass the run of the events to the event handler.
+ *
+ * @param[in,out] mc   Module context.
+ * @param[in]     ids  Event IDs.
+ * @param[in]     n    Number of the events (1 or more).
+ *
+ * @return  Number of the processed events (1 to n).
+ */
+/* ====================================================================== */
+static size_t
+dispatch_events(MODULE_CTX * const mc,
+                ESM_EVENT_ID * const ids,
+                const size_t n)
+{
+    ESM_EVENT_HANDLER *handler;
+    size_t count;
+
+    assert((mc != NULL) && (ids != NULL) && (n > 0));
+
+    handler = &mc->event_handler;
+    if (handler->on_events == NULL) {
+        set_current_event(mc, &ids[0]);
+        handler->on_event(handler->user_data, ids[0]);
+        set_current_event(mc, NULL);
+        return 1;
+    }
+
+    count = handler->on_events(handler->user_data, ids, n);
+    assert((count > 0) && (count <= n));
+
+    /* Broken result: regard all events as processed (not to loop forever). */
+    if ((count == 0) || (count > n)) {
+        count = n;
+    }
+
+    return count;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Process a batch of the events.
+ *
+ * The event handler is updated after each call of the handler, so the rest
+ * of the batch goes to the new handler. If the transition recalls the
+ * deferred events, the rest of the batch is held over behind them (unless
+ * the batch itself is the older recalled events), so no more than max
+ * events are processed.
+ *
+ * @param[in,out] mc   Module context.
+ * @param[in]     max  Maximum number of the events (1 or more).
+ *
+ * @return  Number of the processed events (0: no event).
+ */
+/* ====================================================================== */
+static uint32_t
+process_event_batch(MODULE_CTX * const mc, const uint32_t max)
+{
+    ESM_EVENT_ID ids[ESM_CFG_EVENT_BATCH_SIZE];
+    size_t n, done;
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    bool recalled;
+#endif
+
+    assert((mc != NULL) && (max > 0));
+
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    recalled = (mc->num_recalled_events > 0);
+#endif
+
+    n = (max < NELEMS(ids)) ? max : NELEMS(ids);
+    n = peek_events(mc, ids, n);
 
+    done = 0;
+    while (done < n) {
+        done += dispatch_events(mc, &ids[done], n - done);
         update_event_handler(mc);
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+        /* The recalled events go before the rest of the batch. */
+        if (!recalled && (done < n) && (mc->num_recalled_events > 0)) {
+            hold_events(mc, &ids[done], n - done);
+            break;
+        }
+#endif
     }
+
+    return (uint32_t) done;
 }
+#endif
 
 /* ====================================================================== */
 /**
- * @brief  Force stop software timers.
+ * @brief  Process the events up to the budget.
+ *
+ * Process at most ESM_CFG_EVENT_BUDGET events, and if
+ * ESM_CFG_EVENT_TIME_BUDGET_USEC is defined, stop once the time budget is
+ * used up. In millisecond tick mode the time budget is rounded up to the
+ * tick, plus one tick because the current tick may be about to change, so
+ * the events may run up to one tick longer than the budget.
+ *
+ * The event handler is updated after each event (or each run of the events
+ * passed to ESM_EVENT_HANDLER::on_events), so the next event goes to the
+ * new handler.
  *
  * @param[in,out] mc  Module context.
  */
 /* ====================================================================== */
 static void
-force_stop_timers(MODULE_CTX * const mc)
+process_events(MODULE_CTX * const mc)
 {
-    size_t i;
+    uint32_t n, count;
+#ifdef ESM_CFG_EVENT_TIME_BUDGET_USEC
+    ESM_SYS_TICK deadline;
+#endif
 
     assert(mc != NULL);
 
-    for (i = 0; i < NELEMS(mc->timers); i++) {
-        mc->timers[i].expired = true;
+#if defined(ESM_CFG_EVENT_TIME_BUDGET_USEC) && defined(ESM_CFG_USE_TICK_USEC)
+    deadline = get_tick() + usec_to_tick_ceil(ESM_CFG_EVENT_TIME_BUDGET_USEC);
+#elif defined(ESM_CFG_EVENT_TIME_BUDGET_USEC)
+    deadline = get_tick() + usec_to_tick_ceil(ESM_CFG_EVENT_TIME_BUDGET_USEC) + 1;
+#endif
+
+    for (n = 0; n < ESM_CFG_EVENT_BUDGET; n += count) {
+#ifdef ESM_CFG_USE_EVENT_BATCH
+        count = process_event_batch(mc, ESM_CFG_EVENT_BUDGET - n);
+#else
+        count = process_event(mc) ? 1 : 0;
+#endif
+        if (count == 0) {
+            break;
+        }
+#ifdef ESM_CFG_EVENT_TIME_BUDGET_USEC
+        if ((get_tick() - deadline) >= 0) {
+            break;
+        }
+#endif
     }
 }
 
 /* ---------------------------------------------------------------------- */
-/* Private functions: process global timer */
+/* Private functions: process timer */
 /* ---------------------------------------------------------------------- */
 
 /* ====================================================================== */
 /**
- * @brief  Validate global timer id.
+ * @brief  Validate timer id.
  *
  * @param[in] mc  Module context.
  * @param[in] id  Timer ID.
@@ -629,11 +1558,30 @@ force_stop_timers(MODULE_CTX * const mc)
  */
 /* ====================================================================== */
 static bool
-valid_global_timer_id(const MODULE_CTX * const mc, const ESM_TIMER_ID id)
+valid_timer_id(const MODULE_CTX * const mc, const ESM_TIMER_ID id)
 {
     assert(mc != NULL);
 
-    return (size_t) id < NELEMS(mc->global_timers);
+    return (size_t) id < NELEMS(mc->timers);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the software timer is running.
+ *
+ * @param[in] mc    Module context.
+ * @param[in] cell  Timer cell.
+ *
+ * @retval true   Running.
+ * @retval false  Expired, killed or started by the previous event handler.
+ */
+/* ====================================================================== */
+static bool
+timer_is_running(const MODULE_CTX * const mc, const ESM_TIMER_CELL * const cell)
+{
+    assert((mc != NULL) && (cell != NULL));
+
+    return !cell->expired && (cell->epoch == mc->timer_epoch);
 }
 
 /* ====================================================================== */
@@ -644,421 +1592,3519 @@ valid_global_timer_id(const MODULE_CTX * const mc, const ESM_TIMER_ID id)
  */
 /* ====================================================================== */
 static void
-initialize_global_timers(MODULE_CTX * const mc)
+initialize_timers(MODULE_CTX * const mc)
 {
     size_t i;
 
     assert(mc != NULL);
 
-    for (i = 0; i < NELEMS(mc->global_timers); i++) {
-        ethc_Initialize(&mc->global_timers[i]);
+    for (i = 0; i < NELEMS(mc->timers); i++) {
+        etc_Initialize(&mc->timers[i]);
     }
+    mc->timer_epoch = 0;
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_Initialize(&mc->timer_wheel, get_tick());
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+    esm_ts_Initialize(&mc->timer_soa,
+                      mc->timer_expire_times,
+                      mc->timer_active,
+                      NELEMS(mc->timer_active));
+#endif
 }
 
 /* ====================================================================== */
 /**
- * @brief  Create and start the global software timer.
+ * @brief  Create and start the software timer.
  *
- * @param[in,out] mc            Module context.
- * @param[in]     id            Timer ID.
- * @param[in]     timeout_msec  Timeout value (in milliseconds).
- * @param[in]     repeat        Repeatedly reschedule or not.
- * @param[in]     handler       Timer handler.
+ * @param[in,out] mc       Module context.
+ * @param[in]     id       Timer ID.
+ * @param[in]     timeout  Timeout value (in system ticks).
+ * @param[in]     repeat   Repeatedly reschedule or not.
  *
  * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ====================================================================== */
 static ESM_ERR
-set_global_timer(MODULE_CTX * const mc,
-                 const ESM_TIMER_ID id,
-                 const ESM_SYS_TICK_MSEC timeout_msec,
-                 const bool repeat,
-                 const ESM_TIMER_HANDLER * const handler)
+set_timer(MODULE_CTX * const mc,
+          const ESM_TIMER_ID id,
+          const ESM_SYS_TICK timeout,
+          const bool repeat)
 {
-    ESM_TIMER_HANDLER_CELL *cell;
-
-    assert((mc != NULL) && valid_global_timer_id(mc, id) && (handler != NULL));
+    ESM_TIMER_CELL *cell;
 
-    if (handler->func == NULL) {
-        return ESM_E_PRM;
-    }
+    assert((mc != NULL) && valid_timer_id(mc, id));
 
-    cell = &mc->global_timers[id];
-    if (!cell->expired) {
+    cell = &mc->timers[id];
+    if (timer_is_running(mc, cell)) {
         return ESM_E_STATUS;
     }
 
-    cell->timeout_msec = timeout_msec;
-    cell->expire_time_msec = esm_md_GetTick() + timeout_msec;
+    cell->timeout = timeout;
+    cell->due_time = get_loop_time(mc) + timeout;
+    cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
     cell->expired = false;
     cell->repeat = repeat;
-    cell->handler = *handler;
-    eth_Sanitize(&cell->handler);
+    cell->epoch = mc->timer_epoch;
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    /* The stale timer may be still linked. */
+    esm_tw_Remove(&cell->node);
+    esm_tw_Insert(&mc->timer_wheel, &cell->node, cell->expire_time);
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+    esm_ts_Start(&mc->timer_soa, id, cell->expire_time);
+#endif
 
     return ESM_E_OK;
 }
 
 /* ====================================================================== */
 /**
- * @brief  Stop and delete the global software timer.
+ * @brief  Stop and delete the software timer.
  *
  * @param[in,out] mc  Module context.
  * @param[in]     id  Timer ID.
  */
 /* ====================================================================== */
 static void
-kill_global_timer(MODULE_CTX * const mc, const ESM_TIMER_ID id)
+kill_timer(MODULE_CTX * const mc, const ESM_TIMER_ID id)
 {
-    ESM_TIMER_HANDLER_CELL *cell;
-    ESM_TIMER_HANDLER *handler;
+    ESM_TIMER_CELL *cell;
 
-    assert((mc != NULL) && valid_global_timer_id(mc, id));
+    assert((mc != NULL) && valid_timer_id(mc, id));
 
-    cell = &mc->global_timers[id];
-    if (cell->expired) {
-        return;
-    }
+    cell = &mc->timers[id];
     cell->expired = true;
-    handler = &cell->handler;
-    handler->release_user_data(handler->user_data);
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_Remove(&cell->node);
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+    esm_ts_Stop(&mc->timer_soa, id);
+#endif
 }
 
 /* ====================================================================== */
 /**
- * @brief  Process global software timers.
+ * @brief  Set the timer slack of the software timer.
+ *
+ * @param[in,out] mc     Module context.
+ * @param[in]     id     Timer ID.
+ * @param[in]     slack  Timer slack (in system ticks).
+ *
+ * @note  The timer slack is applied from the next start (or reschedule).
+ */
+/* ====================================================================== */
+static void
+set_timer_slack(MODULE_CTX * const mc,
+                const ESM_TIMER_ID id,
+                const ESM_SYS_TICK slack)
+{
+    assert((mc != NULL) && valid_timer_id(mc, id));
+
+    mc->timers[id].slack_mask = slack_to_mask(slack);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Process software timers.
  *
  * @param[in,out] mc  Module context.
  */
 /* ====================================================================== */
 static void
-process_global_timers(MODULE_CTX * const mc)
+process_timers(MODULE_CTX * const mc)
 {
-    ESM_SYS_TICK_MSEC current_time;
+    ESM_SYS_TICK current_time;
+    ESM_EVENT_HANDLER *handler;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    ESM_TW_NODE *node;
+#else
     size_t i;
+#endif
 
     assert(mc != NULL);
 
-    current_time = esm_md_GetTick();
+    current_time = get_loop_time(mc);
+    handler = &mc->event_handler;
 
-    for (i = 0; i < NELEMS(mc->global_timers); i++) {
-        ESM_TIMER_HANDLER_CELL *cell;
-        ESM_TIMER_HANDLER *handler;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_Advance(&mc->timer_wheel, current_time);
 
-        cell = &mc->global_timers[i];
-        if (cell->expired) {
+    /* Expired timers are popped in ascending order of the timer ID. */
+    while ((node = esm_tw_PopExpired(&mc->timer_wheel)) != NULL) {
+        ESM_TIMER_CELL *cell;
+
+        cell = CONTAINER_OF(node, ESM_TIMER_CELL, node);
+        if (!timer_is_running(mc, cell)) {
+            /* Started by the previous event handler: discard it. */
+            cell->expired = true;
             continue;
         }
-        if ((current_time - cell->expire_time_msec) < 0) {
+        RECORD_LATENESS(&mc->timer_lateness, current_time, cell->expire_time);
+        if (cell->repeat) {
+            cell->due_time += cell->timeout;
+            cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
+            esm_tw_Insert(&mc->timer_wheel, node, cell->expire_time);
+        } else {
+            cell->expired = true;
+        }
+        mc->timer_stats.expirations++;
+
+        handler->on_timer(handler->user_data, (ESM_TIMER_ID) (cell - mc->timers));
+
+        update_event_handler(mc);
+    }
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    /* Expired timers are found in ascending order of the timer ID. */
+    for (i = 0; esm_ts_FindExpired(&mc->timer_soa, i, current_time, &i); i++) {
+        ESM_TIMER_CELL *cell;
+
+        cell = &mc->timers[i];
+        if (!timer_is_running(mc, cell)) {
+            /* Started by the previous event handler: discard it. */
+            cell->expired = true;
+            esm_ts_Stop(&mc->timer_soa, i);
             continue;
         }
+        RECORD_LATENESS(&mc->timer_lateness, current_time, cell->expire_time);
+        if (cell->repeat) {
+            cell->due_time += cell->timeout;
+            cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
+            esm_ts_Start(&mc->timer_soa, i, cell->expire_time);
+        } else {
+            cell->expired = true;
+            esm_ts_Stop(&mc->timer_soa, i);
+        }
+        mc->timer_stats.expirations++;
 
-        handler = &cell->handler;
-        handler->func(handler->user_data);
+        handler->on_timer(handler->user_data, (ESM_TIMER_ID) i);
+
+        update_event_handler(mc);
+    }
+#else
+    for (i = 0; i < NELEMS(mc->timers); i++) {
+        ESM_TIMER_CELL *cell;
 
+        cell = &mc->timers[i];
+        if (!timer_is_running(mc, cell)) {
+            continue;
+        }
+        if ((current_time - cell->expire_time) < 0) {
+            continue;
+        }
+        RECORD_LATENESS(&mc->timer_lateness, current_time, cell->expire_time);
         if (cell->repeat) {
-            cell->expire_time_msec += cell->timeout_msec;
+            cell->due_time += cell->timeout;
+            cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
         } else {
             cell->expired = true;
-            handler->release_user_data(handler->user_data);
         }
+        mc->timer_stats.expirations++;
+
+        handler->on_timer(handler->user_data, (ESM_TIMER_ID) i);
 
         update_event_handler(mc);
     }
+#endif
 }
 
 /* ====================================================================== */
 /**
- * @brief  Force stop global software timers.
+ * @brief  Get the earliest expiration time of software timers.
  *
- * @param[in,out] mc  Module context.
+ * @param[in,out] mc           Module context.
+ * @param[out]    expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No timer is running.
  */
 /* ====================================================================== */
-static void
-force_stop_global_timers(MODULE_CTX * const mc)
+static bool
+get_timers_expire_time(MODULE_CTX * const mc,
+                       ESM_SYS_TICK * const expire_time)
 {
-    size_t i;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    assert((mc != NULL) && (expire_time != NULL));
 
-    assert(mc != NULL);
+    return esm_tw_GetNextExpireTime(&mc->timer_wheel, expire_time);
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    assert((mc != NULL) && (expire_time != NULL));
 
-    for (i = 0; i < NELEMS(mc->global_timers); i++) {
-        ESM_TIMER_HANDLER_CELL *cell;
+    return esm_ts_GetNextExpireTime(&mc->timer_soa, expire_time);
+#else
+    bool found;
+    size_t i;
 
-        cell = &mc->global_timers[i];
-        if (!cell->expired) {
-            ESM_TIMER_HANDLER *handler;
+    assert((mc != NULL) && (expire_time != NULL));
 
-            handler = &cell->handler;
-            handler->release_user_data(handler->user_data);
+    found = false;
+    for (i = 0; i < NELEMS(mc->timers); i++) {
+        const ESM_TIMER_CELL *cell;
+
+        cell = &mc->timers[i];
+        if (!timer_is_running(mc, cell)) {
+            continue;
+        }
+        if (!found || ((cell->expire_time - *expire_time) < 0)) {
+            *expire_time = cell->expire_time;
+            found = true;
         }
-        ethc_Initialize(cell);
     }
-}
 
-/* ---------------------------------------------------------------------- */
-/* Private functions: process message */
-/* ---------------------------------------------------------------------- */
+    return found;
+#endif
+}
 
 /* ====================================================================== */
 /**
- * @brief  Post the message to the mein loop.
+ * @brief  Force stop software timers.
  *
- * @param[in,out] mc   Module context.
- * @param[in]     msg  Message.
+ * @param[in,out] mc  Module context.
  *
- * @retval ESM_E_OK   Exit success.
- * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
- * @retval ESM_E_RES  No system resources.
+ * @note  O(1) (except when the epoch wraps around). Timers started by the
+ *        previous event handler become stale, and they are discarded
+ *        lazily.
  */
 /* ====================================================================== */
-static ESM_ERR
-post_message(MODULE_CTX * const mc, const ESM_MESSAGE * const msg)
+static void
+force_stop_timers(MODULE_CTX * const mc)
 {
-    ESM_MESSAGE_CELL *cell;
-
-    assert((mc != NULL) && (msg != NULL));
+    size_t i;
 
-    if (msg->func == NULL) {
-        return ESM_E_PRM;
-    }
+    assert(mc != NULL);
 
-    cell = emc_Create(msg);
-    if (cell == NULL) {
-        return ESM_E_RES;
+    mc->timer_epoch++;
+    if (mc->timer_epoch != 0) {
+        return;
     }
 
-    if (mc->first_message_cell == NULL) {
-        mc->first_message_cell = cell;
-        mc->last_message_cell = cell;
-    } else {
-        mc->last_message_cell->next = cell;
-        mc->last_message_cell = cell;
+    /* Epoch wrapped around: stop all timers so that no stale timer revives. */
+    for (i = 0; i < NELEMS(mc->timers); i++) {
+        mc->timers[i].expired = true;
+        mc->timers[i].epoch = 0;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+        esm_tw_Remove(&mc->timers[i].node);
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+        esm_ts_Stop(&mc->timer_soa, i);
+#endif
     }
-
-    return ESM_E_OK;
 }
 
+/* ---------------------------------------------------------------------- */
+/* Private functions: process global timer */
+/* ---------------------------------------------------------------------- */
+
 /* ====================================================================== */
 /**
- * @brief  Process all messages.
+ * @brief  Validate global timer id.
+ *
+ * @param[in] mc  Module context.
+ * @param[in] id  Timer ID.
+ *
+ * @retval true   Valid.
+ * @retval false  Invalid.
+ */
+/* ====================================================================== */
+static bool
+valid_global_timer_id(const MODULE_CTX * const mc, const ESM_TIMER_ID id)
+{
+    assert(mc != NULL);
+    (void) mc;
+
+    return (size_t) id < ESM_CFG_MAX_GLOBAL_TIMER;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the cell is owned by the timer handle.
+ *
+ * @param[in] mc    Module context.
+ * @param[in] cell  Timer handler cell.
+ *
+ * @retval true   Timer handle's cell.
+ * @retval false  Global timer's cell (reserved for the timer ID).
+ */
+/* ====================================================================== */
+static bool
+is_timer_handle_cell(const MODULE_CTX * const mc,
+                     const ESM_TIMER_HANDLER_CELL * const cell)
+{
+    assert((mc != NULL) && (cell != NULL));
+
+    return (size_t) (cell - mc->global_timers) >= ESM_CFG_MAX_GLOBAL_TIMER;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Initialize global software timers.
  *
  * @param[in,out] mc  Module context.
  */
 /* ====================================================================== */
 static void
-process_messages(MODULE_CTX * const mc)
+initialize_global_timers(MODULE_CTX * const mc)
 {
-    ESM_MESSAGE_CELL *cell, *next_cell;
-    ESM_MESSAGE *msg;
+    size_t i;
 
     assert(mc != NULL);
 
-    esm_md_LockForAPI();
-    cell = mc->first_message_cell;
-    mc->first_message_cell = NULL;
-    mc->last_message_cell = NULL;
-    esm_md_UnlockForAPI();
+    for (i = 0; i < NELEMS(mc->global_timers); i++) {
+        ethc_Initialize(&mc->global_timers[i]);
+    }
 
-    for (; cell != NULL; cell = next_cell) {
-        next_cell = cell->next;
-        msg = &cell->message;
-        msg->func(msg->user_data);
-        msg->release_user_data(msg->user_data);
+    /* Free list of the timer handles (in ascending order of the address). */
+    mc->free_timer_handle = FREE_LIST_END;
+    for (i = NELEMS(mc->global_timers); i > ESM_CFG_MAX_GLOBAL_TIMER; i--) {
+        mc->global_timers[i - 1].next_free = mc->free_timer_handle;
+        mc->free_timer_handle = (uint32_t) (i - 1);
+    }
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_Initialize(&mc->global_timer_wheel, get_tick());
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+    esm_ts_Initialize(&mc->global_timer_soa,
+                      mc->global_timer_expire_times,
+                      mc->global_timer_active,
+                      NELEMS(mc->global_timer_active));
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Start the timer of the cell.
+ *
+ * @param[in,out] mc       Module context.
+ * @param[in,out] cell     Timer handler cell (must be stopped).
+ * @param[in]     timeout  Timeout value (in system ticks).
+ * @param[in]     repeat   Repeatedly reschedule or not.
+ */
+/* ====================================================================== */
+static void
+start_global_timer_cell(MODULE_CTX * const mc,
+                        ESM_TIMER_HANDLER_CELL * const cell,
+                        const ESM_SYS_TICK timeout,
+                        const bool repeat)
+{
+    assert((mc != NULL) && (cell != NULL) && cell->expired);
+
+    cell->timeout = timeout;
+    cell->due_time = get_loop_time(mc) + timeout;
+    cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
+    cell->expired = false;
+    cell->repeat = repeat;
+
+#if defined(ESM_CFG_USE_TIMER_WHEEL)
+    esm_tw_Insert(&mc->global_timer_wheel, &cell->node, cell->expire_time);
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    esm_ts_Start(&mc->global_timer_soa,
+                 (size_t) (cell - mc->global_timers),
+                 cell->expire_time);
+#else
+    (void) mc;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Stop the timer of the cell.
+ *
+ * @param[in,out] mc    Module context.
+ * @param[in,out] cell  Timer handler cell.
+ *
+ * @note  O(1).
+ */
+/* ====================================================================== */
+static void
+stop_global_timer_cell(MODULE_CTX * const mc,
+                       ESM_TIMER_HANDLER_CELL * const cell)
+{
+    assert((mc != NULL) && (cell != NULL));
+
+    cell->expired = true;
+#if defined(ESM_CFG_USE_TIMER_WHEEL)
+    esm_tw_Remove(&cell->node);
+    (void) mc;
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    esm_ts_Stop(&mc->global_timer_soa, (size_t) (cell - mc->global_timers));
+#else
+    (void) mc;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Create and start the global software timer.
+ *
+ * @param[in,out] mc       Module context.
+ * @param[in]     id       Timer ID.
+ * @param[in]     timeout  Timeout value (in system ticks).
+ * @param[in]     repeat   Repeatedly reschedule or not.
+ * @param[in]     handler  Timer handler.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ====================================================================== */
+static ESM_ERR
+set_global_timer(MODULE_CTX * const mc,
+                 const ESM_TIMER_ID id,
+                 const ESM_SYS_TICK timeout,
+                 const bool repeat,
+                 const ESM_TIMER_HANDLER * const handler)
+{
+    ESM_TIMER_HANDLER_CELL *cell;
+
+    assert((mc != NULL) && valid_global_timer_id(mc, id) && (handler != NULL));
+
+    if (handler->func == NULL) {
+        return ESM_E_PRM;
+    }
+
+    /* Not restarted in its handler: the user data is released after it. */
+    cell = &mc->global_timers[id];
+    if (!cell->expired || cell->dispatching) {
+        return ESM_E_STATUS;
+    }
+
+    cell->handler = *handler;
+    eth_Sanitize(&cell->handler);
+    start_global_timer_cell(mc, cell, timeout, repeat);
+
+    return ESM_E_OK;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Stop and delete the global software timer.
+ *
+ * @param[in,out] mc  Module context.
+ * @param[in]     id  Timer ID.
+ */
+/* ====================================================================== */
+static void
+kill_global_timer(MODULE_CTX * const mc, const ESM_TIMER_ID id)
+{
+    ESM_TIMER_HANDLER_CELL *cell;
+    ESM_TIMER_HANDLER *handler;
+
+    assert((mc != NULL) && valid_global_timer_id(mc, id));
+
+    cell = &mc->global_timers[id];
+    if (cell->expired) {
+        return;
+    }
+    stop_global_timer_cell(mc, cell);
+    handler = &cell->handler;
+    handler->release_user_data(handler->user_data);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Set the timer slack of the timer handler cell.
+ *
+ * @param[in,out] cell   Timer handler cell.
+ * @param[in]     slack  Timer slack (in system ticks).
+ *
+ * @note  The timer slack is applied from the next start (or reschedule).
+ */
+/* ====================================================================== */
+static void
+set_global_timer_cell_slack(ESM_TIMER_HANDLER_CELL * const cell,
+                            const ESM_SYS_TICK slack)
+{
+    assert(cell != NULL);
+
+    cell->slack_mask = slack_to_mask(slack);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Find the cell of the timer handle.
+ *
+ * @param[in,out] mc      Module context.
+ * @param[in]     handle  Timer handle.
+ *
+ * @retval !=NULL  Timer handler cell.
+ * @retval   NULL  Invalid (or already destroyed) handle.
+ */
+/* ====================================================================== */
+static ESM_TIMER_HANDLER_CELL *
+find_timer_handle_cell(MODULE_CTX * const mc, const ESM_TIMER_HANDLE handle)
+{
+    ESM_TIMER_HANDLER_CELL *cell;
+    size_t index;
+
+    assert(mc != NULL);
+
+    index = (size_t) (handle & TIMER_HANDLE_INDEX_MASK);
+    if ((index < ESM_CFG_MAX_GLOBAL_TIMER) || (index >= NELEMS(mc->global_timers))) {
+        return NULL;
+    }
+
+    cell = &mc->global_timers[index];
+    if (!cell->allocated) {
+        return NULL;
+    }
+    if (cell->generation != (handle >> TIMER_HANDLE_INDEX_BITS)) {
+        return NULL;
+    }
+
+    return cell;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Create the timer handle.
+ *
+ * @param[in,out] mc       Module context.
+ * @param[in]     handler  Timer handler.
+ * @param[out]    handle   Timer handle.
+ *
+ * @retval ESM_E_OK   Exit success.
+ * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES  No system resources.
+ *
+ * @note  O(1).
+ */
+/* ====================================================================== */
+static ESM_ERR
+create_timer(MODULE_CTX * const mc,
+             const ESM_TIMER_HANDLER * const handler,
+             ESM_TIMER_HANDLE * const handle)
+{
+    ESM_TIMER_HANDLER_CELL *cell;
+    uint32_t index;
+
+    assert((mc != NULL) && (handler != NULL) && (handle != NULL));
+
+    if (handler->func == NULL) {
+        return ESM_E_PRM;
+    }
+
+    index = mc->free_timer_handle;
+    if (index == FREE_LIST_END) {
+        return ESM_E_RES;
+    }
+
+    cell = &mc->global_timers[index];
+    mc->free_timer_handle = cell->next_free;
+
+    /* Generation 0 is not used, so the handle is never 0. */
+    cell->generation = (uint16_t) ((cell->generation + 1) & TIMER_HANDLE_GENERATION_MASK);
+    if (cell->generation == 0) {
+        cell->generation = 1;
+    }
+    cell->allocated = true;
+    cell->slack_mask = 0;
+    cell->handler = *handler;
+    eth_Sanitize(&cell->handler);
+
+    *handle = ((ESM_TIMER_HANDLE) cell->generation << TIMER_HANDLE_INDEX_BITS) | index;
+
+    return ESM_E_OK;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Destroy the timer handle.
+ *
+ * @param[in,out] mc    Module context.
+ * @param[in,out] cell  Timer handle's cell.
+ *
+ * @note  O(1).
+ */
+/* ====================================================================== */
+static void
+destroy_timer(MODULE_CTX * const mc, ESM_TIMER_HANDLER_CELL * const cell)
+{
+    ESM_TIMER_HANDLER handler;
+
+    assert((mc != NULL) && (cell != NULL) && cell->allocated);
+    assert(is_timer_handle_cell(mc, cell));
+
+    stop_global_timer_cell(mc, cell);
+
+    handler = cell->handler;
+    eth_Cleanup(&cell->handler);
+    cell->allocated = false;
+    cell->next_free = mc->free_timer_handle;
+    mc->free_timer_handle = (uint32_t) (cell - mc->global_timers);
+
+    handler.release_user_data(handler.user_data);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Call the handler of the expired timer.
+ *
+ * The timer is rescheduled (or stopped) before the call, so the handler can
+ * kill or destroy it in the same way with any timer storage. A one-shot
+ * global timer stays in the dispatch until its user data is released after
+ * the call, so it cannot be restarted in the handler (as a repeating one).
+ *
+ * @param[in,out] mc    Module context.
+ * @param[in,out] cell  Timer handler cell (expired).
+ */
+/* ====================================================================== */
+static void
+dispatch_global_timer(MODULE_CTX * const mc, ESM_TIMER_HANDLER_CELL * const cell)
+{
+    ESM_TIMER_HANDLER handler;
+    bool one_shot;
+
+    assert((mc != NULL) && (cell != NULL));
+
+    /* The handler may destroy the timer handle (and clean up the cell). */
+    handler = cell->handler;
+    one_shot = !cell->repeat;
+    mc->timer_stats.expirations++;
+
+    if (cell->repeat) {
+        cell->due_time += cell->timeout;
+        cell->expire_time = apply_slack(cell->due_time, cell->slack_mask);
+#if defined(ESM_CFG_USE_TIMER_WHEEL)
+        esm_tw_Insert(&mc->global_timer_wheel, &cell->node, cell->expire_time);
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+        esm_ts_Start(&mc->global_timer_soa,
+                     (size_t) (cell - mc->global_timers),
+                     cell->expire_time);
+#endif
+    } else {
+        stop_global_timer_cell(mc, cell);
+    }
+
+    /* The user data of the timer handle is released by esm_DestroyTimer(). */
+    if (one_shot && !is_timer_handle_cell(mc, cell)) {
+        cell->dispatching = true;
+        handler.func(handler.user_data);
+        cell->dispatching = false;
+        handler.release_user_data(handler.user_data);
+    } else {
+        handler.func(handler.user_data);
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Process global software timers.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+process_global_timers(MODULE_CTX * const mc)
+{
+    ESM_SYS_TICK current_time;
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    ESM_TW_NODE *node;
+#else
+    size_t i;
+#endif
+
+    assert(mc != NULL);
+
+    current_time = get_loop_time(mc);
+
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    esm_tw_Advance(&mc->global_timer_wheel, current_time);
+
+    /* Expired timers are popped in ascending order of the timer ID. */
+    while ((node = esm_tw_PopExpired(&mc->global_timer_wheel)) != NULL) {
+        ESM_TIMER_HANDLER_CELL *cell;
+
+        cell = CONTAINER_OF(node, ESM_TIMER_HANDLER_CELL, node);
+        RECORD_LATENESS(&mc->global_timer_lateness, current_time, cell->expire_time);
+        dispatch_global_timer(mc, cell);
+
+        update_event_handler(mc);
+    }
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    /* Expired timers are found in ascending order of the timer ID. */
+    for (i = 0; esm_ts_FindExpired(&mc->global_timer_soa, i, current_time, &i); i++) {
+        RECORD_LATENESS(&mc->global_timer_lateness,
+                        current_time,
+                        mc->global_timers[i].expire_time);
+        dispatch_global_timer(mc, &mc->global_timers[i]);
+
+        update_event_handler(mc);
+    }
+#else
+    for (i = 0; i < NELEMS(mc->global_timers); i++) {
+        ESM_TIMER_HANDLER_CELL *cell;
+
+        cell = &mc->global_timers[i];
+        if (cell->expired) {
+            continue;
+        }
+        if ((current_time - cell->expire_time) < 0) {
+            continue;
+        }
+
+        RECORD_LATENESS(&mc->global_timer_lateness, current_time, cell->expire_time);
+        dispatch_global_timer(mc, cell);
+
+        update_event_handler(mc);
+    }
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Get the earliest expiration time of global software timers.
+ *
+ * @param[in,out] mc           Module context.
+ * @param[out]    expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No timer is running.
+ */
+/* ====================================================================== */
+static bool
+get_global_timers_expire_time(MODULE_CTX * const mc,
+                              ESM_SYS_TICK * const expire_time)
+{
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+    assert((mc != NULL) && (expire_time != NULL));
+
+    return esm_tw_GetNextExpireTime(&mc->global_timer_wheel, expire_time);
+#elif defined(ESM_CFG_USE_TIMER_SOA)
+    assert((mc != NULL) && (expire_time != NULL));
+
+    return esm_ts_GetNextExpireTime(&mc->global_timer_soa, expire_time);
+#else
+    bool found;
+    size_t i;
+
+    assert((mc != NULL) && (expire_time != NULL));
+
+    found = false;
+    for (i = 0; i < NELEMS(mc->global_timers); i++) {
+        const ESM_TIMER_HANDLER_CELL *cell;
+
+        cell = &mc->global_timers[i];
+        if (cell->expired) {
+            continue;
+        }
+        if (!found || ((cell->expire_time - *expire_time) < 0)) {
+            *expire_time = cell->expire_time;
+            found = true;
+        }
+    }
+
+    return found;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Force stop global software timers (and destroy timer handles).
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+force_stop_global_timers(MODULE_CTX * const mc)
+{
+    size_t i;
+
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->global_timers); i++) {
+        ESM_TIMER_HANDLER_CELL *cell;
+
+        cell = &mc->global_timers[i];
+        if (cell->allocated || !cell->expired) {
+            ESM_TIMER_HANDLER *handler;
+
+            handler = &cell->handler;
+            handler->release_user_data(handler->user_data);
+        }
+#ifdef ESM_CFG_USE_TIMER_WHEEL
+        esm_tw_Remove(&cell->node);
+#endif
+#ifdef ESM_CFG_USE_TIMER_SOA
+        esm_ts_Stop(&mc->global_timer_soa, i);
+#endif
+        ethc_Initialize(cell);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: message queue */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Release the message cell processed (or dropped) by the main loop.
+ *
+ * If the message is posted by esm_Invoke() and still waited, complete the
+ * invocation instead: esm_Invoke() deletes the cell.
+ *
+ * @param[in,out] cell       Message cell.
+ * @param[in]     processed  true if the message function is called.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static void
+release_message_cell(ESM_MESSAGE_CELL * const cell, const bool processed)
+{
+    assert(cell != NULL);
+
+#ifdef ESM_CFG_USE_INVOKE
+    if (cell->invoked && (cell->invoke_state == INVOKE_PENDING)) {
+        cell->invoke_state = processed ? INVOKE_DONE : INVOKE_DROPPED;
+        esm_md_NotifyCompletion();
+        return;
+    }
+#else
+    (void) processed;
+#endif
+
+    emc_Delete(cell);
+}
+
+#ifdef ESM_CFG_PRIORITIES
+/* ====================================================================== */
+/**
+ * @brief  Initialize the message queues of all priorities.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_message_lanes(MODULE_CTX * const mc)
+{
+    size_t i;
+
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->first_message_cells); i++) {
+        mc->first_message_cells[i] = NULL;
+        mc->last_message_cells[i] = NULL;
+    }
+    esm_pr_Initialize(&mc->message_lanes);
+    mc->num_messages = 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Remove the first message cell of the priority.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     priority  Priority (its queue must not be empty).
+ *
+ * @return  Message cell.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static ESM_MESSAGE_CELL *
+remove_first_message_cell(MODULE_CTX * const mc, const ESM_PRIORITY priority)
+{
+    ESM_MESSAGE_CELL *cell;
+
+    assert((mc != NULL) && (priority < ESM_CFG_PRIORITIES));
+
+    cell = mc->first_message_cells[priority];
+    assert(cell != NULL);
+
+    mc->first_message_cells[priority] = cell->next;
+    if (cell->next == NULL) {
+        mc->last_message_cells[priority] = NULL;
+        esm_pr_Unmark(&mc->message_lanes, priority);
+    }
+    mc->num_messages--;
+
+    return cell;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Dequeue the message cell of the highest priority.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  No message.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static ESM_MESSAGE_CELL *
+dequeue_message_cell(MODULE_CTX * const mc)
+{
+    ESM_PRIORITY priority;
+
+    assert(mc != NULL);
+
+    if (esm_pr_IsEmpty(&mc->message_lanes)) {
+        return NULL;
+    }
+
+    priority = esm_pr_Select(&mc->message_lanes);
+
+    return remove_first_message_cell(mc, priority);
+}
+#endif
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/* ====================================================================== */
+/**
+ * @brief  Reset the backpressure policy and statistics of the message queue.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_message_backpressure(MODULE_CTX * const mc)
+{
+    ESM_QUEUE_POLICY * const policy = &mc->message_policy;
+    ESM_QUEUE_STATS * const stats = &mc->message_stats;
+
+    assert(mc != NULL);
+
+    policy->capacity = 0;
+    policy->high_water = 0;
+    policy->low_water = 0;
+    policy->on_high_water = NULL;
+    policy->on_low_water = NULL;
+    policy->user_data = NULL;
+    policy->overflow = ESM_OVERFLOW_REJECT;
+    policy->timeout_msec = 0;
+
+    stats->depth = 0;
+    stats->max_depth = 0;
+    stats->rejected = 0;
+    stats->dropped = 0;
+    stats->blocked = 0;
+
+    mc->above_high_water = false;
+    mc->blocked_producers = 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Count the queued messages (and signal the high water mark).
+ *
+ * @param[in,out] mc  Module context.
+ * @param[in]     n   Number of the queued messages.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static void
+count_queued_messages(MODULE_CTX * const mc, const size_t n)
+{
+    const ESM_QUEUE_POLICY * const policy = &mc->message_policy;
+    ESM_QUEUE_STATS * const stats = &mc->message_stats;
+
+    assert(mc != NULL);
+
+    stats->depth += n;
+    if (stats->max_depth < stats->depth) {
+        stats->max_depth = stats->depth;
+    }
+
+    if (mc->above_high_water || (policy->high_water == 0)) {
+        return;
+    }
+    if (stats->depth >= policy->high_water) {
+        mc->above_high_water = true;
+        if (policy->on_high_water != NULL) {
+            policy->on_high_water(policy->user_data);
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Uncount the processed message (and signal the low water mark).
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static void
+uncount_processed_message(MODULE_CTX * const mc)
+{
+    const ESM_QUEUE_POLICY * const policy = &mc->message_policy;
+    ESM_QUEUE_STATS * const stats = &mc->message_stats;
+
+    assert((mc != NULL) && (stats->depth > 0));
+
+    stats->depth--;
+
+    if (mc->blocked_producers > 0) {
+        esm_md_NotifySpace();
+    }
+
+    if (mc->above_high_water && (stats->depth <= policy->low_water)) {
+        mc->above_high_water = false;
+        if (policy->on_low_water != NULL) {
+            policy->on_low_water(policy->user_data);
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Drop the oldest queued message (of the lowest priority).
+ *
+ * The release_user_data of the message is called without the lock, as the
+ * main loop does.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @retval true   Dropped.
+ * @retval false  No message to drop, or the main loop is cleaned up.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static bool
+drop_oldest_message(MODULE_CTX * const mc)
+{
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    /* The queued messages can be taken out by the main loop only. */
+    (void) mc;
+
+    return false;
+#else
+    ESM_MESSAGE_CELL *cell;
+    ESM_MESSAGE *msg;
+#ifdef ESM_CFG_PRIORITIES
+    ESM_PRIORITY priority;
+#endif
+
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_PRIORITIES
+    if (esm_pr_IsEmpty(&mc->message_lanes)) {
+        return false;
+    }
+
+    priority = LOWEST_PRIORITY;
+    while (mc->first_message_cells[priority] == NULL) {
+        priority--;
+    }
+    cell = remove_first_message_cell(mc, priority);
+#else
+    /* The messages taken by process_messages() are not in the queue. */
+    cell = mc->first_message_cell;
+    if (cell == NULL) {
+        return false;
+    }
+    mc->first_message_cell = cell->next;
+    if (mc->first_message_cell == NULL) {
+        mc->last_message_cell = NULL;
+    }
+#endif
+
+    mc->message_stats.depth--;
+    mc->message_stats.dropped++;
+
+    /* The cell is out of the queue: nobody else touches it. */
+    esm_md_UnlockForAPI();
+    msg = &cell->message;
+    msg->release_user_data(msg->user_data);
+    esm_md_LockForAPI();
+
+    release_message_cell(cell, false);
+
+    return mc->prepared;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Wait for a space in the message queue.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     deadline  Deadline of the wait (ignored if no timeout).
+ *
+ * @retval true   Woken up (the queue may have a space).
+ * @retval false  Timed out, or the main loop is cleaned up.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static bool
+wait_for_message_space(MODULE_CTX * const mc, const ESM_SYS_TICK deadline)
+{
+    ESM_SYS_TICK_MSEC wait_msec;
+
+    assert(mc != NULL);
+
+    wait_msec = get_wait_msec(mc->message_policy.timeout_msec, deadline);
+    if (wait_msec == 0) {
+        return false;
+    }
+
+    mc->blocked_producers++;
+    esm_md_WaitForSpace(wait_msec);
+    mc->blocked_producers--;
+
+    return mc->prepared;
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Create the message cell for the message queue.
+ *
+ * If ESM_CFG_USE_BACKPRESSURE is defined, apply the overflow policy when
+ * the message queue is full. The cells not enqueued yet (pending) count
+ * against the capacity. The policy is not applied while some cells are
+ * pending: enqueue them first, and then call this function again.
+ *
+ * @param[in,out] mc       Module context.
+ * @param[in]     msg      Message.
+ * @param[in]     pending  Number of the cells created but not enqueued.
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  The message queue is full.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static ESM_MESSAGE_CELL *
+create_message_cell(MODULE_CTX * const mc,
+                    const ESM_MESSAGE * const msg,
+                    const size_t pending)
+{
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    const ESM_QUEUE_POLICY * const policy = &mc->message_policy;
+    ESM_QUEUE_STATS * const stats = &mc->message_stats;
+    ESM_MESSAGE_CELL *cell;
+    ESM_SYS_TICK deadline;
+    bool blocked;
+
+    assert((mc != NULL) && (msg != NULL));
+
+    deadline = 0;
+    blocked = false;
+
+    for (;;) {
+        if ((policy->capacity == 0) || ((stats->depth + pending) < policy->capacity)) {
+            cell = emc_Create(msg);
+            if (cell != NULL) {
+                return cell;
+            }
+        }
+
+        /* Not to drop or wait for the cells held by the caller. */
+        if (pending > 0) {
+            return NULL;
+        }
+
+        if (policy->overflow == ESM_OVERFLOW_DROP_OLDEST) {
+            if (drop_oldest_message(mc)) {
+                continue;
+            }
+        } else if (policy->overflow == ESM_OVERFLOW_BLOCK) {
+            if (!blocked) {
+                blocked = true;
+                stats->blocked++;
+                deadline = get_tick() + TICK_FROM_MSEC(policy->timeout_msec);
+            }
+            if (wait_for_message_space(mc, deadline)) {
+                continue;
+            }
+        }
+
+        stats->rejected++;
+
+        return NULL;
+    }
+#else
+    assert((mc != NULL) && (msg != NULL));
+
+    (void) mc;
+    (void) pending;
+
+    return emc_Create(msg);
+#endif
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: process message */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Enqueue the chain of the message cells to the message queue.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in,out] first     First message cell of the chain.
+ * @param[in,out] last      Last message cell of the chain.
+ * @param[in]     n         Number of the message cells in the chain.
+ * @param[in]     priority  Priority of the messages.
+ */
+/* ====================================================================== */
+static void
+enqueue_message_cells(MODULE_CTX * const mc,
+                      ESM_MESSAGE_CELL * const first,
+                      ESM_MESSAGE_CELL * const last,
+                      const size_t n,
+                      const ESM_PRIORITY priority)
+{
+    assert((mc != NULL) && (first != NULL) && (last != NULL) && (n > 0));
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    count_queued_messages(mc, n);
+#endif
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    (void) n;
+    (void) priority;
+
+    esm_mq_PushChain(&mc->message_queue, first, last);
+#elif defined(ESM_CFG_PRIORITIES)
+    assert(priority < ESM_CFG_PRIORITIES);
+
+    if (mc->first_message_cells[priority] == NULL) {
+        mc->first_message_cells[priority] = first;
+        esm_pr_Mark(&mc->message_lanes, priority);
+    } else {
+        mc->last_message_cells[priority]->next = first;
+    }
+    mc->last_message_cells[priority] = last;
+    mc->num_messages += n;
+#else
+    (void) n;
+    (void) priority;
+
+    if (mc->first_message_cell == NULL) {
+        mc->first_message_cell = first;
+    } else {
+        mc->last_message_cell->next = first;
+    }
+    mc->last_message_cell = last;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the message to the mein loop.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     msg       Message.
+ * @param[in]     priority  Priority of the message.
+ *
+ * @retval ESM_E_OK   Exit success.
+ * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES  No system resources.
+ */
+/* ====================================================================== */
+static ESM_ERR
+post_message(MODULE_CTX * const mc,
+             const ESM_MESSAGE * const msg,
+             const ESM_PRIORITY priority)
+{
+    ESM_MESSAGE_CELL *cell;
+
+    assert((mc != NULL) && (msg != NULL));
+
+    if (msg->func == NULL) {
+        return ESM_E_PRM;
+    }
+
+    cell = create_message_cell(mc, msg, 0);
+    if (cell == NULL) {
+        return ESM_E_RES;
+    }
+
+    enqueue_message_cells(mc, cell, cell, 1, priority);
+
+    return ESM_E_OK;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the messages to the mein loop at once.
+ *
+ * @param[in,out] mc      Module context.
+ * @param[in]     msgs    Messages.
+ * @param[in]     n       Number of the messages.
+ * @param[out]    posted  Number of the posted messages.
+ *
+ * @retval ESM_E_OK   Exit success.
+ * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES  No system resources.
+ */
+/* ====================================================================== */
+static ESM_ERR
+post_messages(MODULE_CTX * const mc,
+              const ESM_MESSAGE * const msgs,
+              const size_t n,
+              size_t * const posted)
+{
+    ESM_MESSAGE_CELL *first, *last, *cell;
+    ESM_ERR err;
+    size_t i, pending;
+
+    assert((mc != NULL) && ((msgs != NULL) || (n == 0)) && (posted != NULL));
+
+    for (i = 0; i < n; i++) {
+        if (msgs[i].func == NULL) {
+            return ESM_E_PRM;
+        }
+    }
+
+    first = NULL;
+    last = NULL;
+    pending = 0;
+    err = ESM_E_OK;
+
+    for (i = 0; i < n; i++) {
+        cell = create_message_cell(mc, &msgs[i], pending);
+        if ((cell == NULL) && (pending > 0)) {
+            /* Enqueue the chain before the overflow policy is applied. */
+            enqueue_message_cells(mc, first, last, pending, LOWEST_PRIORITY);
+            first = NULL;
+            pending = 0;
+            cell = create_message_cell(mc, &msgs[i], 0);
+        }
+        if (cell == NULL) {
+            err = ESM_E_RES;
+            break;
+        }
+
+        if (first == NULL) {
+            first = cell;
+        } else {
+            last->next = cell;
+        }
+        last = cell;
+        pending++;
+    }
+
+    if (first != NULL) {
+        enqueue_message_cells(mc, first, last, pending, LOWEST_PRIORITY);
+    }
+    *posted = i;
+
+    return err;
+}
+
+#ifdef ESM_CFG_MESSAGE_PAYLOAD_SIZE
+/* ====================================================================== */
+/**
+ * @brief  Post the message with the inline payload to the mein loop.
+ *
+ * @param[in,out] mc    Module context.
+ * @param[in]     func  Message function.
+ * @param[in]     data  Payload.
+ * @param[in]     size  Size of the payload.
+ *
+ * @retval ESM_E_OK   Exit success.
+ * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES  No system resources.
+ */
+/* ====================================================================== */
+static ESM_ERR
+post_message_data(MODULE_CTX * const mc,
+                  void (* const func)(void * const data),
+                  const void * const data,
+                  const size_t size)
+{
+    ESM_MESSAGE_CELL *cell;
+    ESM_MESSAGE msg;
+
+    assert(mc != NULL);
+
+    if (func == NULL) {
+        return ESM_E_PRM;
+    }
+    if ((data == NULL) && (size > 0)) {
+        return ESM_E_PRM;
+    }
+    if (size > sizeof(cell->payload.bytes)) {
+        return ESM_E_PRM;
+    }
+
+    msg.func = func;
+    msg.release_user_data = NULL;
+    msg.user_data = NULL;
+
+    cell = create_message_cell(mc, &msg, 0);
+    if (cell == NULL) {
+        return ESM_E_RES;
+    }
+
+    /* process_messages() passes the payload as user_data. */
+    if (size > 0) {
+        (void) memcpy(cell->payload.bytes, data, size);
+    }
+    cell->message.user_data = cell->payload.bytes;
+
+    enqueue_message_cells(mc, cell, cell, 1, LOWEST_PRIORITY);
+
+    return ESM_E_OK;
+}
+#endif
+
+#ifdef ESM_CFG_USE_INVOKE
+/* ====================================================================== */
+/**
+ * @brief  Post the message to the mein loop for esm_Invoke().
+ *
+ * @param[in,out] mc    Module context.
+ * @param[in]     msg   Message.
+ * @param[out]    cell  Message cell (with the completion slot to wait for).
+ *
+ * @retval ESM_E_OK   Exit success.
+ * @retval ESM_E_PRM  Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES  No system resources.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static ESM_ERR
+post_invocation(MODULE_CTX * const mc,
+                const ESM_MESSAGE * const msg,
+                ESM_MESSAGE_CELL ** const cell)
+{
+    assert((mc != NULL) && (msg != NULL) && (cell != NULL));
+
+    if (msg->func == NULL) {
+        return ESM_E_PRM;
+    }
+
+    *cell = create_message_cell(mc, msg, 0);
+    if (*cell == NULL) {
+        return ESM_E_RES;
+    }
+
+    (*cell)->invoked = true;
+    (*cell)->invoke_state = INVOKE_PENDING;
+
+    enqueue_message_cells(mc, *cell, *cell, 1, LOWEST_PRIORITY);
+
+    return ESM_E_OK;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Wait until the main loop processes the message of esm_Invoke().
+ *
+ * @param[in,out] mc            Module context.
+ * @param[in,out] cell          Message cell (result of post_invocation()).
+ * @param[in]     timeout_msec  Timeout value (in milliseconds).
+ *                              ESM_WAIT_FOREVER: no timeout.
+ *
+ * @retval ESM_E_OK       The message is processed.
+ * @retval ESM_E_RES      The message is dropped.
+ * @retval ESM_E_STATUS   The main loop is cleaned up.
+ * @retval ESM_E_TIMEOUT  Timed out.
+ *
+ * @note  Call this function in esm_md_LockForAPI().
+ */
+/* ====================================================================== */
+static ESM_ERR
+wait_for_invocation(MODULE_CTX * const mc,
+                    ESM_MESSAGE_CELL * const cell,
+                    const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    ESM_SYS_TICK_MSEC wait_msec;
+    ESM_SYS_TICK deadline;
+    ESM_ERR err;
+
+    assert((mc != NULL) && (cell != NULL) && cell->invoked);
+
+    deadline = get_tick() + TICK_FROM_MSEC(timeout_msec);
+
+    while (cell->invoke_state == INVOKE_PENDING) {
+        if (!mc->prepared) {
+            cell->invoke_state = INVOKE_ABANDONED;
+            return ESM_E_STATUS;
+        }
+
+        wait_msec = get_wait_msec(timeout_msec, deadline);
+        if (wait_msec == 0) {
+            /* The main loop deletes the cell after the message is processed. */
+            cell->invoke_state = INVOKE_ABANDONED;
+            return ESM_E_TIMEOUT;
+        }
+
+        esm_md_WaitForCompletion(wait_msec);
+    }
+
+    err = (cell->invoke_state == INVOKE_DONE) ? ESM_E_OK : ESM_E_RES;
+    emc_Delete(cell);
+
+    return err;
+}
+#endif
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+/* ====================================================================== */
+/**
+ * @brief  Return true if any producer's message is pending.
+ *
+ * @param[in] mc  Module context.
+ *
+ * @retval true   Pending.
+ * @retval false  Not pending.
+ */
+/* ====================================================================== */
+static bool
+has_shard_messages(const MODULE_CTX * const mc)
+{
+    size_t i;
+
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->message_shards); i++) {
+        if (esm_sq_Count(&mc->message_shards[i].queue) > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Process the messages of the producers.
+ *
+ * Drain the producers' queues in round-robin, at most
+ * ESM_CFG_MESSAGE_SHARD_BUDGET messages from each queue per round, so that
+ * a busy producer does not delay the others. The messages posted from now
+ * on are processed in the next call, and the first queue of the round
+ * rotates on each call.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+process_shard_messages(MODULE_CTX * const mc)
+{
+    size_t remain[ESM_CFG_MESSAGE_SHARDS];
+    size_t total, i, k, n;
+    uint32_t start;
+    ESM_MESSAGE msg;
+
+    assert(mc != NULL);
+
+    total = 0;
+    for (i = 0; i < NELEMS(remain); i++) {
+        remain[i] = esm_sq_Count(&mc->message_shards[i].queue);
+        total += remain[i];
+    }
+
+    start = mc->next_message_shard;
+    mc->next_message_shard = (start + 1) % ESM_CFG_MESSAGE_SHARDS;
+
+    while (total > 0) {
+        for (k = 0; k < NELEMS(remain); k++) {
+            i = (start + k) % ESM_CFG_MESSAGE_SHARDS;
+
+            for (n = 0; (n < ESM_CFG_MESSAGE_SHARD_BUDGET) && (remain[i] > 0); n++) {
+                (void) esm_sq_Pop(&mc->message_shards[i].queue, &msg);
+                remain[i]--;
+                total--;
+
+                msg.func(msg.user_data);
+                msg.release_user_data(msg.user_data);
+
+                update_event_handler(mc);
+            }
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Reset the producers (and their queues).
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+reset_message_shards(MODULE_CTX * const mc)
+{
+    size_t i;
+
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->message_shards); i++) {
+        mc->message_shards[i].created = false;
+        esm_sq_Initialize(&mc->message_shards[i].queue);
+    }
+    mc->next_message_shard = 0;
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Process all messages.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+static void
+process_messages(MODULE_CTX * const mc)
+{
+    ESM_MESSAGE_CELL *cell, *last_cell;
+    ESM_MESSAGE *msg;
+    bool done;
+
+    assert(mc != NULL);
+
+    /* Messages posted from now on are processed in the next call. */
+    last_cell = esm_mq_Last(&mc->message_queue);
+
+    do {
+        cell = esm_mq_Pop(&mc->message_queue, last_cell);
+        if (cell == NULL) {
+            break;
+        }
+        done = (cell == last_cell);
+
+        msg = &cell->message;
+        msg->func(msg->user_data);
+        msg->release_user_data(msg->user_data);
+
+#if defined(ESM_CFG_USE_BACKPRESSURE) || defined(ESM_CFG_USE_INVOKE)
+        esm_md_LockForAPI();
+        release_message_cell(cell, true);
+#ifdef ESM_CFG_USE_BACKPRESSURE
+        uncount_processed_message(mc);
+#endif
+        esm_md_UnlockForAPI();
+#else
+        /* No lock: esm_md_DeallocMessageCell() must be thread-safe. */
+        emc_Delete(cell);
+#endif
+
+        update_event_handler(mc);
+    } while (!done);
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    process_shard_messages(mc);
+#endif
+}
+#elif defined(ESM_CFG_PRIORITIES)
+static void
+process_messages(MODULE_CTX * const mc)
+{
+    ESM_MESSAGE_CELL *cell;
+    ESM_MESSAGE *msg;
+    size_t remain;
+
+    assert(mc != NULL);
+
+    /*
+     * The messages are selected one by one, so the urgent messages posted
+     * in this call overtake the pending ones. But the number of the messages
+     * is limited to the pending ones, not to loop forever.
+     */
+    esm_md_LockForAPI();
+    remain = mc->num_messages;
+    cell = dequeue_message_cell(mc);
+    esm_md_UnlockForAPI();
+
+    while (cell != NULL) {
+        msg = &cell->message;
+        msg->func(msg->user_data);
+        msg->release_user_data(msg->user_data);
+        remain--;
+
+        esm_md_LockForAPI();
+        release_message_cell(cell, true);
+#ifdef ESM_CFG_USE_BACKPRESSURE
+        uncount_processed_message(mc);
+#endif
+        cell = (remain > 0) ? dequeue_message_cell(mc) : NULL;
+        esm_md_UnlockForAPI();
+
+        update_event_handler(mc);
+    }
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    process_shard_messages(mc);
+#endif
+}
+#else
+static void
+process_messages(MODULE_CTX * const mc)
+{
+    ESM_MESSAGE_CELL *cell, *next_cell;
+    ESM_MESSAGE *msg;
+
+    assert(mc != NULL);
+
+    esm_md_LockForAPI();
+    cell = mc->first_message_cell;
+    mc->first_message_cell = NULL;
+    mc->last_message_cell = NULL;
+    esm_md_UnlockForAPI();
+
+    for (; cell != NULL; cell = next_cell) {
+        next_cell = cell->next;
+        msg = &cell->message;
+        msg->func(msg->user_data);
+        msg->release_user_data(msg->user_data);
+
+        esm_md_LockForAPI();
+        release_message_cell(cell, true);
+#ifdef ESM_CFG_USE_BACKPRESSURE
+        uncount_processed_message(mc);
+#endif
+        esm_md_UnlockForAPI();
+
+        update_event_handler(mc);
+    }
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    process_shard_messages(mc);
+#endif
+}
+#endif /* def ESM_CFG_USE_MPSC_QUEUE */
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: timer statistics */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Clear the timer statistics.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+clear_timer_stats(MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+    mc->timer_stats.expirations = 0;
+    mc->timer_stats.dispatches = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: next deadline */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if there is any work to do immediately.
+ *
+ * @param[in] mc  Module context.
+ *
+ * @retval true   Next event handler, messages or events are pending.
+ * @retval false  Nothing to do.
+ */
+/* ====================================================================== */
+static bool
+has_pending_work(const MODULE_CTX * const mc)
+{
+    bool has_message;
+
+    assert(mc != NULL);
+
+    if (mc->next_event_handler.on_init != NULL) {
+        return true;
+    }
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    if (mc->num_recalled_events > 0) {
+        return true;
+    }
+#endif
+#if defined(ESM_CFG_MAX_DEFERRED_EVENTS) && defined(ESM_CFG_USE_EVENT_BATCH)
+    if (mc->num_held_events > 0) {
+        return true;
+    }
+#endif
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    has_message = !esm_mq_IsEmpty(&mc->message_queue);
+#elif defined(ESM_CFG_PRIORITIES)
+    esm_md_LockForAPI();
+    has_message = !esm_pr_IsEmpty(&mc->message_lanes);
+    esm_md_UnlockForAPI();
+#else
+    esm_md_LockForAPI();
+    has_message = (mc->first_message_cell != NULL);
+    esm_md_UnlockForAPI();
+#endif
+
+    if (has_message) {
+        return true;
+    }
+
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    if (has_shard_messages(mc)) {
+        return true;
+    }
+#endif
+
+    return esm_md_HasEvent();
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Get the time when esm_ResumeAndYield() should be called next.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[out]    deadline  Deadline (in system ticks).
+ *
+ * @retval ESM_E_OK     Exit success.
+ * @retval ESM_E_NOENT  No timer, message and event to wait for.
+ */
+/* ====================================================================== */
+static ESM_ERR
+get_next_deadline(MODULE_CTX * const mc, ESM_SYS_TICK * const deadline)
+{
+    ESM_SYS_TICK current_time;
+    ESM_SYS_TICK earliest = 0;
+    ESM_SYS_TICK expire_time = 0;
+    bool found;
+
+    assert((mc != NULL) && (deadline != NULL));
+
+    current_time = get_tick();
+
+    if (has_pending_work(mc)) {
+        *deadline = current_time;
+        return ESM_E_OK;
+    }
+
+    found = get_timers_expire_time(mc, &earliest);
+
+    if (get_global_timers_expire_time(mc, &expire_time)) {
+        if (!found || ((expire_time - earliest) < 0)) {
+            earliest = expire_time;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return ESM_E_NOENT;
+    }
+
+    /* Already expired. */
+    if ((earliest - current_time) < 0) {
+        earliest = current_time;
+    }
+
+    *deadline = earliest;
+
+    return ESM_E_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: main loop */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  A resume-yield function for the main loop.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+resume_and_yield(MODULE_CTX * const mc)
+{
+    uint32_t expirations;
+
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_USE_LOOP_TIME
+    /* One system tick read per iteration, shared by the timer APIs. */
+    mc->loop_time = get_tick();
+    mc->loop_time_valid = true;
+#endif
+
+    update_event_handler(mc);
+
+    process_events(mc);
+
+    expirations = mc->timer_stats.expirations;
+    process_timers(mc);
+    process_global_timers(mc);
+    if (mc->timer_stats.expirations != expirations) {
+        mc->timer_stats.dispatches++;
+    }
+
+    process_messages(mc);
+
+#ifdef ESM_CFG_USE_LOOP_TIME
+    mc->loop_time_valid = false;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Wait for the work (until the next deadline or the timeout).
+ *
+ * @param[in,out] mc            Module context.
+ * @param[in]     timeout_msec  Timeout value (in milliseconds).
+ */
+/* ====================================================================== */
+static void
+wait_for_work(MODULE_CTX * const mc, const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    ESM_SYS_TICK deadline;
+    ESM_SYS_TICK_MSEC wait_msec;
+
+    assert(mc != NULL);
+
+    if (timeout_msec == 0) {
+        return;
+    }
+
+    wait_msec = timeout_msec;
+
+    if (get_next_deadline(mc, &deadline) == ESM_E_OK) {
+        ESM_SYS_TICK remain;
+
+        remain = deadline - get_tick();
+        if (remain <= 0) {
+            return;
+        }
+        if ((wait_msec < 0) || (remain < TICK_FROM_MSEC(wait_msec))) {
+            /* Round up not to wake up before the deadline. */
+            remain = tick_to_msec_ceil(remain);
+            wait_msec = (remain > MSEC_MAX)
+                      ? MSEC_MAX
+                      : (ESM_SYS_TICK_MSEC) remain;
+        }
+    }
+
+    esm_md_WaitForWork(wait_msec);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test and clear the stop request.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @retval true   Stop requested.
+ * @retval false  Not requested.
+ */
+/* ====================================================================== */
+static bool
+test_and_clear_stop_request(MODULE_CTX * const mc)
+{
+    bool stop_requested;
+
+    assert(mc != NULL);
+
+    esm_md_LockForAPI();
+    stop_requested = mc->stop_requested;
+    mc->stop_requested = false;
+    esm_md_UnlockForAPI();
+
+    return stop_requested;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Public API functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the library.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_SYS     Error caused by underlying library routines.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_Initialize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (mc->initialized) {
+        return ESM_E_STATUS;
+    }
+
+    err = esm_md_Initialize();
+    if (err != ESM_E_OK) {
+        return err;
+    }
+
+    mc->prepared = false;
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    esm_mq_Initialize(&mc->message_queue);
+#elif defined(ESM_CFG_PRIORITIES)
+    initialize_message_lanes(mc);
+#else
+    mc->first_message_cell = NULL;
+    mc->last_message_cell = NULL;
+#endif
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    reset_message_shards(mc);
+#endif
+
+    mc->initialized = true;
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Finalize the library.
+ */
+/* ********************************************************************** */
+void
+esm_Finalize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return;
+    }
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_md_Finalize();
+
+    mc->initialized = false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Prepare the library before main loop.
+ *
+ * @param[in] params  Preparation parameters.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_PrepareBeforeMainLoop(const ESM_PREPARE_PARAMS * const params)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+    ESM_EVENT_HANDLER *handler;
+
+    if (params == NULL) {
+        return ESM_E_PRM;
+    }
+    if (params->default_handler == NULL) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    err = esm_md_PrepareBeforeMainLoop();
+    if (err != ESM_E_OK) {
+        return err;
+    }
+
+    set_default_event_handler(mc, params->default_handler);
+    initialize_timers(mc);
+    initialize_global_timers(mc);
+    clear_timer_stats(mc);
+#ifdef ESM_CFG_USE_TIMER_LATENESS
+    clear_timer_lateness(mc);
+#endif
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    initialize_message_backpressure(mc);
+#endif
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    initialize_deferred_events(mc);
+#endif
+    mc->stop_requested = false;
+
+    mc->prepared = true;
+
+    handler = &mc->event_handler;
+    handler->on_init(handler->user_data);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  A resume-yield function for the main loop.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_ResumeAndYield(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    resume_and_yield(mc);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the work and run the main loop once.
+ *
+ * Block until an event or a message arrives, or the nearest timer expires
+ * (but no longer than the timeout), and then call esm_ResumeAndYield().
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *                          0: no wait.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_RunOnce(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    wait_for_work(mc, timeout_msec);
+    resume_and_yield(mc);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Run the main loop until esm_Stop() is called.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_Run(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    while (!test_and_clear_stop_request(mc)) {
+        wait_for_work(mc, ESM_WAIT_FOREVER);
+        resume_and_yield(mc);
+    }
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Request esm_Run() to return.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  This function can be called from other threads.
+ *        If esm_Run() is not running, the next esm_Run() returns
+ *        immediately.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_Stop(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    mc->stop_requested = true;
+    err = ESM_E_OK;
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    if (err == ESM_E_OK) {
+        esm_md_NotifyWork();
+    }
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Cleanup the library after main loop.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_CleanupAfterMainLoop(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    process_messages(mc);
+    force_stop_global_timers(mc);
+    remove_event_handler(mc);
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    discard_deferred_events(mc);
+#endif
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    esm_md_LockForAPI();
+    reset_message_shards(mc);
+    esm_md_UnlockForAPI();
+#endif
+
+    (void) esm_md_CleanupAfterMainLoop();
+
+    mc->prepared = false;
+
+#if defined(ESM_CFG_USE_BACKPRESSURE) || defined(ESM_CFG_USE_INVOKE)
+    /* The blocked producers and the waiting invokers give up. */
+    esm_md_LockForAPI();
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    esm_md_NotifySpace();
+#endif
+#ifdef ESM_CFG_USE_INVOKE
+    esm_md_NotifyCompletion();
+#endif
+    esm_md_UnlockForAPI();
+#endif
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the next event handler.
+ *
+ * @param[in] handler  Event handler.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetNextEventHandler(const ESM_EVENT_HANDLER * const handler)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (handler == NULL) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    set_next_event_handler(mc, handler);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Defer the event being processed until the next transition.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MAX_DEFERRED_EVENTS is not defined.
+ * @retval ESM_E_RES     No system resources (the deferred ring is full).
+ * @retval ESM_E_STATUS  Internal status error (not in the dispatch of the
+ *                       event, or already deferred).
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_DeferEvent(void)
+{
+#ifdef ESM_CFG_MAX_DEFERRED_EVENTS
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    return defer_current_event(mc);
+#else
+    return ESM_E_NG;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the software timer.
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetTimer(const ESM_TIMER_ID id,
+                const ESM_SYS_TICK_MSEC timeout_msec,
+                const bool repeat)
+{
+    return esm_SetTimerUsec(id,
+                            (ESM_SYS_TICK_USEC) timeout_msec * 1000,
+                            repeat);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the software timer (in microseconds).
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetTimerUsec(const ESM_TIMER_ID id,
+                 const ESM_SYS_TICK_USEC timeout_usec,
+                 const bool repeat)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    err = set_timer(mc, id, usec_to_tick_ceil(timeout_usec), repeat);
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop and delete the software timer.
+ *
+ * @param[in] id  Timer ID.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_KillTimer(const ESM_TIMER_ID id)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    kill_timer(mc, id);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the software timer.
+ *
+ * @param[in] id          Timer ID.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next start (or reschedule),
+ *        and kept until esm_CleanupAfterMainLoop() is called.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetTimerSlack(const ESM_TIMER_ID id,
+                  const ESM_SYS_TICK_MSEC slack_msec)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if ((slack_msec < 0) || (slack_msec > ESM_TIMER_SLACK_MSEC_MAX)) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    set_timer_slack(mc, id, TICK_FROM_MSEC(slack_msec));
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the global software timer.
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ * @param[in] handler       Timer handler.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetGlobalTimer(const ESM_TIMER_ID id,
+                      const ESM_SYS_TICK_MSEC timeout_msec,
+                      const bool repeat,
+                      const ESM_TIMER_HANDLER * const handler)
+{
+    return esm_SetGlobalTimerUsec(id,
+                                  (ESM_SYS_TICK_USEC) timeout_msec * 1000,
+                                  repeat,
+                                  handler);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create and start the global software timer (in microseconds).
+ *
+ * @param[in] id            Timer ID.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ * @param[in] handler       Timer handler.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetGlobalTimerUsec(const ESM_TIMER_ID id,
+                       const ESM_SYS_TICK_USEC timeout_usec,
+                       const bool repeat,
+                       const ESM_TIMER_HANDLER * const handler)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (handler == NULL) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_global_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    err = set_global_timer(mc,
+                           id,
+                           usec_to_tick_ceil(timeout_usec),
+                           repeat,
+                           handler);
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop and delete the global software timer.
+ *
+ * @param[in] id  Timer ID.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_KillGlobalTimer(const ESM_TIMER_ID id)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_global_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    kill_global_timer(mc, id);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the global software timer.
+ *
+ * @param[in] id          Timer ID.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next start (or reschedule),
+ *        and kept until esm_CleanupAfterMainLoop() is called.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetGlobalTimerSlack(const ESM_TIMER_ID id,
+                        const ESM_SYS_TICK_MSEC slack_msec)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if ((slack_msec < 0) || (slack_msec > ESM_TIMER_SLACK_MSEC_MAX)) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    if (!valid_global_timer_id(mc, id)) {
+        return ESM_E_PRM;
+    }
+
+    set_global_timer_cell_slack(&mc->global_timers[id],
+                                TICK_FROM_MSEC(slack_msec));
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create the timer handle.
+ *
+ * @param[in]  handler  Timer handler (called when the timer expires).
+ * @param[out] handle   Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_CreateTimer(const ESM_TIMER_HANDLER * const handler,
+                ESM_TIMER_HANDLE * const handle)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if ((handler == NULL) || (handle == NULL)) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    err = create_timer(mc, handler, handle);
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or restart) the timer.
+ *
+ * @param[in] handle        Timer handle.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_ArmTimer(const ESM_TIMER_HANDLE handle,
+             const ESM_SYS_TICK_MSEC timeout_msec,
+             const bool repeat)
+{
+    return esm_ArmTimerUsec(handle,
+                            (ESM_SYS_TICK_USEC) timeout_msec * 1000,
+                            repeat);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or restart) the timer (in microseconds).
+ *
+ * @param[in] handle        Timer handle.
+ * @param[in] timeout_usec  Timeout value (in microseconds).
+ * @param[in] repeat        Repeatedly reschedule or not.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the timeout value is rounded up
+ *        to milliseconds.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_ArmTimerUsec(const ESM_TIMER_HANDLE handle,
+                 const ESM_SYS_TICK_USEC timeout_usec,
+                 const bool repeat)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_TIMER_HANDLER_CELL *cell;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    cell = find_timer_handle_cell(mc, handle);
+    if (cell == NULL) {
+        return ESM_E_PRM;
+    }
+
+    stop_global_timer_cell(mc, cell);
+    start_global_timer_cell(mc, cell, usec_to_tick_ceil(timeout_usec), repeat);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer.
+ *
+ * @param[in] handle  Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_CancelTimer(const ESM_TIMER_HANDLE handle)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_TIMER_HANDLER_CELL *cell;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    cell = find_timer_handle_cell(mc, handle);
+    if (cell == NULL) {
+        return ESM_E_PRM;
+    }
+
+    stop_global_timer_cell(mc, cell);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer and destroy the timer handle.
+ *
+ * @param[in] handle  Timer handle.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_DestroyTimer(const ESM_TIMER_HANDLE handle)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_TIMER_HANDLER_CELL *cell;
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    cell = find_timer_handle_cell(mc, handle);
+    if (cell == NULL) {
+        return ESM_E_PRM;
+    }
+
+    destroy_timer(mc, cell);
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the timer slack of the timer handle.
+ *
+ * @param[in] handle      Timer handle.
+ * @param[in] slack_msec  Timer slack (in milliseconds,
+ *                        0 to ESM_TIMER_SLACK_MSEC_MAX).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The timer may expire up to slack_msec later than the timeout, and
+ *        timers due at nearly the same time are dispatched together.
+ *        The timer slack is applied from the next esm_ArmTimer() call (or
+ *        reschedule), and kept until the handle is destroyed.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_SetTimerHandleSlack(const ESM_TIMER_HANDLE handle,
+                        const ESM_SYS_TICK_MSEC slack_msec)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_TIMER_HANDLER_CELL *cell;
+
+    if ((slack_msec < 0) || (slack_msec > ESM_TIMER_SLACK_MSEC_MAX)) {
+        return ESM_E_PRM;
+    }
+
+    if (!mc->initialized) {
+        return ESM_E_STATUS;
+    }
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    cell = find_timer_handle_cell(mc, handle);
+    if (cell == NULL) {
+        return ESM_E_PRM;
+    }
+
+    set_global_timer_cell_slack(cell, TICK_FROM_MSEC(slack_msec));
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop.
+ *
+ * @param[in] msg  Message.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_PostMessage(const ESM_MESSAGE * const msg)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (msg == NULL) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = post_message(mc, msg, LOWEST_PRIORITY);
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    if (err == ESM_E_OK) {
+        esm_md_NotifyWork();
+    }
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop with the priority.
+ *
+ * @param[in] msg       Message.
+ * @param[in] priority  Priority (0 to ESM_CFG_PRIORITIES - 1).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_PRIORITIES is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_PostPriorityMessage(const ESM_MESSAGE * const msg,
+                        const ESM_PRIORITY priority)
+{
+#ifdef ESM_CFG_PRIORITIES
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (msg == NULL) {
+        return ESM_E_PRM;
+    }
+    if (priority >= ESM_CFG_PRIORITIES) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = post_message(mc, msg, priority);
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    if (err == ESM_E_OK) {
+        esm_md_NotifyWork();
+    }
+
+    return err;
+#else
+    (void) msg;
+    (void) priority;
+
+    return ESM_E_NG;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the messages to the mein loop at once.
+ *
+ * @param[in]  msgs    Messages.
+ * @param[in]  n       Number of the messages.
+ * @param[out] posted  Number of the posted messages (may be NULL).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_PostMessages(const ESM_MESSAGE * const msgs,
+                 const size_t n,
+                 size_t * const posted)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+    size_t count;
+
+    if (posted != NULL) {
+        *posted = 0;
+    }
+
+    if ((msgs == NULL) && (n > 0)) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    count = 0;
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = post_messages(mc, msgs, n, &count);
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    if (count > 0) {
+        esm_md_NotifyWork();
+    }
+
+    if (posted != NULL) {
+        *posted = count;
+    }
+
+    return err;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message with the inline payload to the mein loop.
+ *
+ * @param[in] func  Message function.
+ * @param[in] data  Payload (may be NULL if size is 0).
+ * @param[in] size  Size of the payload (ESM_CFG_MESSAGE_PAYLOAD_SIZE or less).
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_PAYLOAD_SIZE is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_PostMessageData(void (* const func)(void * const data),
+                    const void * const data,
+                    const size_t size)
+{
+#ifdef ESM_CFG_MESSAGE_PAYLOAD_SIZE
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (func == NULL) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = post_message_data(mc, func, data, size);
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    if (err == ESM_E_OK) {
+        esm_md_NotifyWork();
+    }
+
+    return err;
+#else
+    (void) func;
+    (void) data;
+    (void) size;
+
+    return ESM_E_NG;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the message to the mein loop, and wait until it is processed.
+ *
+ * @param[in] msg           Message.
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *
+ * @retval ESM_E_OK       Exit success (the message is processed).
+ * @retval ESM_E_NG       ESM_CFG_USE_INVOKE is not defined.
+ * @retval ESM_E_PRM      Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES      No system resources (or the message is dropped).
+ * @retval ESM_E_STATUS   Internal status error.
+ * @retval ESM_E_TIMEOUT  Timed out.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_Invoke(const ESM_MESSAGE * const msg, const ESM_SYS_TICK_MSEC timeout_msec)
+{
+#ifdef ESM_CFG_USE_INVOKE
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_MESSAGE_CELL *cell;
+    ESM_ERR err;
+
+    if (msg == NULL) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = post_invocation(mc, msg, &cell);
+    if (err != ESM_E_OK) {
+        goto DONE;
+    }
+
+    /* Wake up the main loop without the lock (the slot is checked again). */
+    esm_md_UnlockForAPI();
+    esm_md_NotifyWork();
+    esm_md_LockForAPI();
+
+    err = wait_for_invocation(mc, cell, timeout_msec);
+
+DONE:
+    esm_md_UnlockForAPI();
+
+    return err;
+#else
+    (void) msg;
+    (void) timeout_msec;
+
+    return ESM_E_NG;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Create the message producer (for the calling thread).
+ *
+ * @param[out] id  Producer ID.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources (all producers in use).
+ * @retval ESM_E_STATUS  Internal status error.
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_CreateProducer(ESM_PRODUCER_ID * const id)
+{
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+    size_t i;
+
+    if (id == NULL) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
+    }
+
+    err = ESM_E_RES;
+
+    for (i = 0; i < NELEMS(mc->message_shards); i++) {
+        if (!mc->message_shards[i].created) {
+            mc->message_shards[i].created = true;
+            *id = (ESM_PRODUCER_ID) i;
+            err = ESM_E_OK;
+            break;
+        }
+    }
+
+DONE:
+    esm_md_UnlockForAPI();
 
-        esm_md_LockForAPI();
-        emc_Delete(cell);
-        esm_md_UnlockForAPI();
+    return err;
+#else
+    (void) id;
 
-        update_event_handler(mc);
-    }
+    return ESM_E_NG;
+#endif
 }
 
-/* ---------------------------------------------------------------------- */
-/* Public API functions */
-/* ---------------------------------------------------------------------- */
-
 /* ********************************************************************** */
 /**
- * @brief  Initialize the library.
+ * @brief  Destroy the message producer.
+ *
+ * @param[in] id  Producer ID.
  *
  * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
- * @retval ESM_E_SYS     Error caused by underlying library routines.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_Initialize(void)
+esm_DestroyProducer(const ESM_PRODUCER_ID id)
 {
+#ifdef ESM_CFG_MESSAGE_SHARDS
     MODULE_CTX * const mc = &module_ctx;
     ESM_ERR err;
 
-    if (mc->initialized) {
-        return ESM_E_STATUS;
+    if (id >= ESM_CFG_MESSAGE_SHARDS) {
+        return ESM_E_PRM;
     }
 
-    err = esm_md_Initialize();
-    if (err != ESM_E_OK) {
-        return err;
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
+    if (!mc->initialized) {
+        goto DONE;
+    }
+    if (!mc->prepared) {
+        goto DONE;
     }
 
-    mc->prepared = false;
-    mc->first_message_cell = NULL;
-    mc->last_message_cell = NULL;
+    err = ESM_E_PRM;
 
-    mc->initialized = true;
+    if (mc->message_shards[id].created) {
+        /* The posted messages are left in the queue. */
+        mc->message_shards[id].created = false;
+        err = ESM_E_OK;
+    }
 
-    return ESM_E_OK;
+DONE:
+    esm_md_UnlockForAPI();
+
+    return err;
+#else
+    (void) id;
+
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Finalize the library.
+ * @brief  Post the message to the mein loop via the producer's queue.
+ *
+ * @param[in] id   Producer ID.
+ * @param[in] msg  Message.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_MESSAGE_SHARDS is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
+ * @retval ESM_E_RES     No system resources (the queue is full).
+ * @retval ESM_E_STATUS  Internal status error (the producer is destroyed).
  */
 /* ********************************************************************** */
-void
-esm_Finalize(void)
+ESM_ERR
+esm_PostProducerMessage(const ESM_PRODUCER_ID id, const ESM_MESSAGE * const msg)
 {
+#ifdef ESM_CFG_MESSAGE_SHARDS
     MODULE_CTX * const mc = &module_ctx;
+    ESM_MESSAGE_SHARD *shard;
+    ESM_MESSAGE sanitized;
 
-    if (!mc->initialized) {
-        return;
+    if ((msg == NULL) || (msg->func == NULL)) {
+        return ESM_E_PRM;
+    }
+    if (id >= ESM_CFG_MESSAGE_SHARDS) {
+        return ESM_E_PRM;
     }
 
-    (void) esm_CleanupAfterMainLoop();
-    esm_md_Finalize();
+    /* No lock: the producer is owned by the calling thread. */
+    shard = &mc->message_shards[id];
+    if (!shard->created) {
+        return ESM_E_STATUS;
+    }
 
-    mc->initialized = false;
+    sanitized = *msg;
+    em_Sanitize(&sanitized);
+
+    if (!esm_sq_Push(&shard->queue, &sanitized)) {
+        return ESM_E_RES;
+    }
+
+    esm_md_NotifyWork();
+
+    return ESM_E_OK;
+#else
+    (void) id;
+    (void) msg;
+
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Prepare the library before main loop.
+ * @brief  Set the backpressure policy of the message queue.
  *
- * @param[in] params  Preparation parameters.
+ * @param[in] policy  Backpressure policy.
  *
  * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_BACKPRESSURE is not defined.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_PrepareBeforeMainLoop(const ESM_PREPARE_PARAMS * const params)
+esm_SetMessageQueuePolicy(const ESM_QUEUE_POLICY * const policy)
 {
+#ifdef ESM_CFG_USE_BACKPRESSURE
     MODULE_CTX * const mc = &module_ctx;
     ESM_ERR err;
-    ESM_EVENT_HANDLER *handler;
 
-    if (params == NULL) {
+    if (policy == NULL) {
         return ESM_E_PRM;
     }
-    if (params->default_handler == NULL) {
+    if ((policy->high_water > 0) && (policy->low_water >= policy->high_water)) {
+        return ESM_E_PRM;
+    }
+    if (policy->overflow > ESM_OVERFLOW_BLOCK) {
         return ESM_E_PRM;
     }
 
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
+
     if (!mc->initialized) {
-        return ESM_E_STATUS;
+        goto DONE;
     }
-    if (mc->prepared) {
-        return ESM_E_STATUS;
+    if (!mc->prepared) {
+        goto DONE;
     }
 
-    err = esm_md_PrepareBeforeMainLoop();
-    if (err != ESM_E_OK) {
-        return err;
+    mc->message_policy = *policy;
+    mc->above_high_water = false;
+
+    /* The blocked producers check the new capacity. */
+    if (mc->blocked_producers > 0) {
+        esm_md_NotifySpace();
     }
 
-    set_default_event_handler(mc, params->default_handler);
-    initialize_timers(mc);
-    initialize_global_timers(mc);
+    err = ESM_E_OK;
 
-    mc->prepared = true;
+DONE:
+    esm_md_UnlockForAPI();
 
-    handler = &mc->event_handler;
-    handler->on_init(handler->user_data);
+    return err;
+#else
+    (void) policy;
 
-    return ESM_E_OK;
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  A resume-yield function for the main loop.
+ * @brief  Get the statistics of the message queue.
+ *
+ * @param[out] stats  Statistics.
  *
  * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_BACKPRESSURE is not defined.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_ResumeAndYield(void)
+esm_GetMessageQueueStats(ESM_QUEUE_STATS * const stats)
 {
+#ifdef ESM_CFG_USE_BACKPRESSURE
     MODULE_CTX * const mc = &module_ctx;
+    ESM_ERR err;
+
+    if (stats == NULL) {
+        return ESM_E_PRM;
+    }
+
+    esm_md_LockForAPI();
+
+    err = ESM_E_STATUS;
 
     if (!mc->initialized) {
-        return ESM_E_STATUS;
+        goto DONE;
     }
     if (!mc->prepared) {
-        return ESM_E_STATUS;
+        goto DONE;
     }
 
-    update_event_handler(mc);
+    *stats = mc->message_stats;
 
-    process_event(mc);
-    process_timers(mc);
-    process_global_timers(mc);
-    process_messages(mc);
+    err = ESM_E_OK;
 
-    return ESM_E_OK;
+DONE:
+    esm_md_UnlockForAPI();
+
+    return err;
+#else
+    (void) stats;
+
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Cleanup the library after main loop.
+ * @brief  Get the time when esm_ResumeAndYield() should be called next.
+ *
+ * @param[out] deadline_msec  Deadline (system tick in milliseconds).
  *
  * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_NOENT   No timer, message and event to wait for.
+ *
+ * @note  If there are pending messages or events (or expired timers),
+ *        the deadline is the current system tick.
+ *        The main loop can sleep until the deadline (or until a new
+ *        message/event arrives).
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_CleanupAfterMainLoop(void)
+esm_GetNextDeadline(ESM_SYS_TICK_MSEC * const deadline_msec)
 {
-    MODULE_CTX * const mc = &module_ctx;
+    ESM_SYS_TICK_USEC deadline_usec;
+    ESM_SYS_TICK deadline;
+    ESM_ERR err;
 
-    if (!mc->initialized) {
-        return ESM_E_STATUS;
-    }
-    if (!mc->prepared) {
-        return ESM_E_STATUS;
+    if (deadline_msec == NULL) {
+        return ESM_E_PRM;
     }
 
-    process_messages(mc);
-    force_stop_global_timers(mc);
-    remove_event_handler(mc);
-
-    (void) esm_md_CleanupAfterMainLoop();
-
-    mc->prepared = false;
+    err = esm_GetNextDeadlineUsec(&deadline_usec);
+    if (err == ESM_E_OK) {
+        /* Round up not to wake up before the deadline. */
+        deadline = usec_to_tick_ceil(deadline_usec);
+        *deadline_msec = (ESM_SYS_TICK_MSEC) tick_to_msec_ceil(deadline);
+    }
 
-    return ESM_E_OK;
+    return err;
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Set the next event handler.
+ * @brief  Get the time when esm_ResumeAndYield() should be called next
+ *         (in microseconds).
  *
- * @param[in] handler  Event handler.
+ * @param[out] deadline_usec  Deadline (system tick in microseconds).
  *
  * @retval ESM_E_OK      Exit success.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_NOENT   No timer, message and event to wait for.
+ *
+ * @note  Without ESM_CFG_USE_TICK_USEC, the deadline is the millisecond
+ *        system tick multiplied by 1000.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_SetNextEventHandler(const ESM_EVENT_HANDLER * const handler)
+esm_GetNextDeadlineUsec(ESM_SYS_TICK_USEC * const deadline_usec)
 {
     MODULE_CTX * const mc = &module_ctx;
+    ESM_SYS_TICK deadline;
+    ESM_ERR err;
 
-    if (handler == NULL) {
+    if (deadline_usec == NULL) {
         return ESM_E_PRM;
     }
 
@@ -1069,31 +5115,35 @@ esm_SetNextEventHandler(const ESM_EVENT_HANDLER * const handler)
         return ESM_E_STATUS;
     }
 
-    set_next_event_handler(mc, handler);
+    err = get_next_deadline(mc, &deadline);
+    if (err == ESM_E_OK) {
+        *deadline_usec = TICK_TO_USEC(deadline);
+    }
 
-    return ESM_E_OK;
+    return err;
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Create and start the software timer.
+ * @brief  Get the timer statistics.
  *
- * @param[in] id            Timer ID.
- * @param[in] timeout_msec  Timeout value (in milliseconds).
- * @param[in] repeat        Repeatedly reschedule or not.
+ * @param[out] stats  Timer statistics.
  *
  * @retval ESM_E_OK      Exit success.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  The coalescing ratio is (stats->expirations / stats->dispatches).
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_SetTimer(const ESM_TIMER_ID id,
-                const ESM_SYS_TICK_MSEC timeout_msec,
-                const bool repeat)
+esm_GetTimerStats(ESM_TIMER_STATS * const stats)
 {
     MODULE_CTX * const mc = &module_ctx;
-    ESM_ERR err;
+
+    if (stats == NULL) {
+        return ESM_E_PRM;
+    }
 
     if (!mc->initialized) {
         return ESM_E_STATUS;
@@ -1102,28 +5152,21 @@ esm_SetTimer(const ESM_TIMER_ID id,
         return ESM_E_STATUS;
     }
 
-    if (!valid_timer_id(mc, id)) {
-        return ESM_E_PRM;
-    }
-
-    err = set_timer(mc, id, timeout_msec, repeat);
+    *stats = mc->timer_stats;
 
-    return err;
+    return ESM_E_OK;
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Stop and delete the software timer.
- *
- * @param[in] id  Timer ID.
+ * @brief  Clear the timer statistics.
  *
  * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_KillTimer(const ESM_TIMER_ID id)
+esm_ClearTimerStats(void)
 {
     MODULE_CTX * const mc = &module_ctx;
 
@@ -1134,39 +5177,30 @@ esm_KillTimer(const ESM_TIMER_ID id)
         return ESM_E_STATUS;
     }
 
-    if (!valid_timer_id(mc, id)) {
-        return ESM_E_PRM;
-    }
-
-    kill_timer(mc, id);
+    clear_timer_stats(mc);
 
     return ESM_E_OK;
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Create and start the global software timer.
+ * @brief  Get the lateness histogram of the timers.
  *
- * @param[in] id            Timer ID.
- * @param[in] timeout_msec  Timeout value (in milliseconds).
- * @param[in] repeat        Repeatedly reschedule or not.
- * @param[in] handler       Timer handler.
+ * @param[out] lateness  Lateness histogram.
  *
  * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_SetGlobalTimer(const ESM_TIMER_ID id,
-                      const ESM_SYS_TICK_MSEC timeout_msec,
-                      const bool repeat,
-                      const ESM_TIMER_HANDLER * const handler)
+esm_GetTimerLateness(ESM_TIMER_LATENESS * const lateness)
 {
+#ifdef ESM_CFG_USE_TIMER_LATENESS
     MODULE_CTX * const mc = &module_ctx;
-    ESM_ERR err;
 
-    if (handler == NULL) {
+    if (lateness == NULL) {
         return ESM_E_PRM;
     }
 
@@ -1177,31 +5211,38 @@ esm_SetGlobalTimer(const ESM_TIMER_ID id,
         return ESM_E_STATUS;
     }
 
-    if (!valid_global_timer_id(mc, id)) {
-        return ESM_E_PRM;
-    }
+    *lateness = mc->timer_lateness;
 
-    err = set_global_timer(mc, id, timeout_msec, repeat, handler);
+    return ESM_E_OK;
+#else
+    (void) lateness;
 
-    return err;
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Stop and delete the global software timer.
+ * @brief  Get the lateness histogram of the global timers and the timer handles.
  *
- * @param[in] id  Timer ID.
+ * @param[out] lateness  Lateness histogram.
  *
  * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
  * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_KillGlobalTimer(const ESM_TIMER_ID id)
+esm_GetGlobalTimerLateness(ESM_TIMER_LATENESS * const lateness)
 {
+#ifdef ESM_CFG_USE_TIMER_LATENESS
     MODULE_CTX * const mc = &module_ctx;
 
+    if (lateness == NULL) {
+        return ESM_E_PRM;
+    }
+
     if (!mc->initialized) {
         return ESM_E_STATUS;
     }
@@ -1209,52 +5250,42 @@ esm_KillGlobalTimer(const ESM_TIMER_ID id)
         return ESM_E_STATUS;
     }
 
-    if (!valid_global_timer_id(mc, id)) {
-        return ESM_E_PRM;
-    }
-
-    kill_global_timer(mc, id);
+    *lateness = mc->global_timer_lateness;
 
     return ESM_E_OK;
+#else
+    (void) lateness;
+
+    return ESM_E_NG;
+#endif
 }
 
 /* ********************************************************************** */
 /**
- * @brief  Post the message to the mein loop.
- *
- * @param[in] msg  Message.
+ * @brief  Clear the lateness histograms.
  *
  * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_PRM     Parameter error (perhaps arguments error).
- * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_NG      ESM_CFG_USE_TIMER_LATENESS is not defined.
  * @retval ESM_E_STATUS  Internal status error.
  */
 /* ********************************************************************** */
 ESM_ERR
-esm_PostMessage(const ESM_MESSAGE * const msg)
+esm_ClearTimerLateness(void)
 {
+#ifdef ESM_CFG_USE_TIMER_LATENESS
     MODULE_CTX * const mc = &module_ctx;
-    ESM_ERR err;
-
-    if (msg == NULL) {
-        return ESM_E_PRM;
-    }
-
-    esm_md_LockForAPI();
-
-    err = ESM_E_STATUS;
 
     if (!mc->initialized) {
-        goto DONE;
+        return ESM_E_STATUS;
     }
     if (!mc->prepared) {
-        goto DONE;
+        return ESM_E_STATUS;
     }
 
-    err = post_message(mc, msg);
-
-DONE:
-    esm_md_UnlockForAPI();
+    clear_timer_lateness(mc);
 
-    return err;
+    return ESM_E_OK;
+#else
+    return ESM_E_NG;
+#endif
 }
@@ -87,11 +87,92 @@ esm_md_AllocMessageCell(void);
  * @brief  Deallocate memory space for ESM_MESSAGE_CELL type.
  *
  * @param[in,out] cell  memory space to deallocate.
+ *
+ * @note  If ESM_CFG_USE_MPSC_QUEUE is defined, this function will be
+ *        called without esm_md_LockForAPI(), so it must be safe against
+ *        esm_md_AllocMessageCell() called from other threads.
  */
 /* ********************************************************************** */
 extern void
 esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell);
 
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the pointer of ESM_MESSAGE_CELL type (acquire).
+ *
+ * @param[in] ptr  Pointer variable.
+ *
+ * @return  Value of the pointer variable.
+ *
+ * @note  This function will be called only if ESM_CFG_USE_MPSC_QUEUE is
+ *        defined.
+ */
+/* ********************************************************************** */
+extern ESM_MESSAGE_CELL *
+esm_md_LoadMessageCell(ESM_MESSAGE_CELL * const * const ptr);
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the pointer of ESM_MESSAGE_CELL type (release).
+ *
+ * @param[out] ptr   Pointer variable.
+ * @param[in]  cell  Value to store.
+ *
+ * @note  This function will be called only if ESM_CFG_USE_MPSC_QUEUE is
+ *        defined.
+ */
+/* ********************************************************************** */
+extern void
+esm_md_StoreMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                        ESM_MESSAGE_CELL * const cell);
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically exchange the pointer of ESM_MESSAGE_CELL type
+ *         (acquire and release).
+ *
+ * @param[in,out] ptr   Pointer variable.
+ * @param[in]     cell  Value to store.
+ *
+ * @return  Previous value of the pointer variable.
+ *
+ * @note  This function will be called only if ESM_CFG_USE_MPSC_QUEUE is
+ *        defined.
+ */
+/* ********************************************************************** */
+extern ESM_MESSAGE_CELL *
+esm_md_ExchangeMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                           ESM_MESSAGE_CELL * const cell);
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the variable of size_t type (acquire).
+ *
+ * @param[in] ptr  Pointer of the variable.
+ *
+ * @return  Value of the variable.
+ *
+ * @note  This function will be called only if ESM_CFG_MESSAGE_SHARDS is
+ *        defined.
+ */
+/* ********************************************************************** */
+extern size_t
+esm_md_LoadSize(const size_t * const ptr);
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the variable of size_t type (release).
+ *
+ * @param[out] ptr    Pointer of the variable.
+ * @param[in]  value  Value to store.
+ *
+ * @note  This function will be called only if ESM_CFG_MESSAGE_SHARDS is
+ *        defined.
+ */
+/* ********************************************************************** */
+extern void
+esm_md_StoreSize(size_t * const ptr, const size_t value);
+
 /* ********************************************************************** */
 /**
  * @brief  Get system tick value.
@@ -102,6 +183,20 @@ esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell);
 extern ESM_SYS_TICK_MSEC
 esm_md_GetTick(void);
 
+/* ********************************************************************** */
+/**
+ * @brief  Get high-resolution system tick value.
+ *
+ * @return  System tick in microseconds.
+ *
+ * @note  This function will be called only if ESM_CFG_USE_TICK_USEC is
+ *        defined. It must be based on the same clock as esm_md_GetTick()
+ *        (i.e. esm_md_GetTick() == esm_md_GetTickUsec() / 1000).
+ */
+/* ********************************************************************** */
+extern ESM_SYS_TICK_USEC
+esm_md_GetTickUsec(void);
+
 /* ********************************************************************** */
 /**
  * @brief  Peek event.
@@ -112,6 +207,143 @@ esm_md_GetTick(void);
 extern ESM_EVENT_ID
 esm_md_PeekEvent(void);
 
+/* ********************************************************************** */
+/**
+ * @brief  Return true if there is any event to peek.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ *
+ * @note  This function will be called in esm_GetNextDeadline().
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_HasEvent(void);
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the event record.
+ *
+ * Pass the payload as is (e.g. the pointer given by the producer) without
+ * copying it. The library releases the payload with
+ * ESM_EVENT_RECORD::release_data after the event is processed.
+ *
+ * @param[out] record  Event record.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ *
+ * @note  This function will be called in esm_ResumeAndYield() instead of
+ *        esm_md_PeekEvent() (if ESM_CFG_USE_EVENT_RECORD is defined).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_PeekEventRecord(ESM_EVENT_RECORD * const record);
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the events at once.
+ *
+ * @param[out] ids  Event IDs output place.
+ * @param[in]  n    Maximum number of the events (1 or more).
+ *
+ * @return  Number of the events (0: no event). May be less than n even if
+ *          more events exist.
+ *
+ * @note  This function will be called in esm_ResumeAndYield() instead of
+ *        esm_md_PeekEvent() (if ESM_CFG_USE_EVENT_BATCH is defined).
+ */
+/* ********************************************************************** */
+extern size_t
+esm_md_PeekEvents(ESM_EVENT_ID * const ids, const size_t n);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the work (event, message, etc.).
+ *
+ * Block until esm_md_NotifyWork() is called or the timeout elapses.
+ * Spurious wakeup is allowed.
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *
+ * @note  This function will be called in esm_Run() and esm_RunOnce().
+ */
+/* ********************************************************************** */
+extern void
+esm_md_WaitForWork(const ESM_SYS_TICK_MSEC timeout_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up esm_md_WaitForWork().
+ *
+ * If no one is waiting, the next esm_md_WaitForWork() returns immediately.
+ *
+ * @note  This function will be called in esm_PostMessage() and esm_Stop().
+ *        Call this function also when the event is posted.
+ */
+/* ********************************************************************** */
+extern void
+esm_md_NotifyWork(void);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for a space in the message queue.
+ *
+ * Unlock esm_md_LockForAPI() and block until esm_md_NotifySpace() is called
+ * or the timeout elapses, and then lock it again. Spurious wakeups are
+ * allowed (the library checks the queue again).
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *
+ * @note  This function will be called in esm_md_LockForAPI() by the post
+ *        functions (if ESM_CFG_USE_BACKPRESSURE is defined).
+ */
+/* ********************************************************************** */
+extern void
+esm_md_WaitForSpace(const ESM_SYS_TICK_MSEC timeout_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForSpace().
+ *
+ * @note  This function will be called in esm_md_LockForAPI() by the main
+ *        loop (if ESM_CFG_USE_BACKPRESSURE is defined).
+ */
+/* ********************************************************************** */
+extern void
+esm_md_NotifySpace(void);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the completion of the message posted by esm_Invoke().
+ *
+ * Unlock esm_md_LockForAPI() and block until esm_md_NotifyCompletion() is
+ * called or the timeout elapses, and then lock it again. Spurious wakeups
+ * are allowed (the library checks the completion slot again).
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ *
+ * @note  This function will be called in esm_md_LockForAPI() by esm_Invoke()
+ *        (if ESM_CFG_USE_INVOKE is defined).
+ */
+/* ********************************************************************** */
+extern void
+esm_md_WaitForCompletion(const ESM_SYS_TICK_MSEC timeout_msec);
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForCompletion().
+ *
+ * @note  This function will be called in esm_md_LockForAPI() by the main
+ *        loop (if ESM_CFG_USE_INVOKE is defined).
+ */
+/* ********************************************************************** */
+extern void
+esm_md_NotifyCompletion(void);
+
 /* ********************************************************************** */
 /**
  * @brief  A lock function for the library.
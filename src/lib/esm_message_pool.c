@@ -0,0 +1,321 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: message cell pool implementation (for machdep library).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The free cells are kept in a LIFO list, so both allocation and free are
+ * O(1) and the most recently used (cache-warm) cell is reused first.
+ *
+ * If ESM_CFG_USE_MPSC_QUEUE is defined, the library frees the cells from
+ * the consumer side without the API lock. In that case esm_mp_Free() pushes
+ * the cell to a lock-free MPSC queue, and esm_mp_Alloc() moves the queued
+ * cells to the free list before allocation.
+ */
+/* ********************************************************************** */
+
+#include "esm_message_pool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Push the cell to the free list.
+ *
+ * @param[in,out] pool  Pool.
+ * @param[in,out] cell  Message cell.
+ */
+/* ====================================================================== */
+static void
+push_free_cell(ESM_MESSAGE_POOL * const pool, ESM_MESSAGE_CELL * const cell)
+{
+    cell->next = pool->free_cells;
+    pool->free_cells = cell;
+    pool->num_free++;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the cell is one of the cells.
+ *
+ * @param[in] cell       Message cell.
+ * @param[in] cells      Cells.
+ * @param[in] num_cells  Number of the cells.
+ *
+ * @retval true   The cell is one of the cells.
+ * @retval false  The cell is not.
+ */
+/* ====================================================================== */
+static bool
+is_one_of_cells(const ESM_MESSAGE_CELL * const cell,
+                const ESM_MESSAGE_CELL * const cells,
+                const size_t num_cells)
+{
+    /* Compared as integers: the cell may belong to another array. */
+    const uintptr_t addr = (uintptr_t) cell;
+    const uintptr_t begin = (uintptr_t) cells;
+    const uintptr_t end = (uintptr_t) (cells + num_cells);
+
+    return (begin <= addr) && (addr < end);
+}
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+/* ====================================================================== */
+/**
+ * @brief  Move the cells freed from the other threads to the free list.
+ *
+ * @param[in,out] pool  Pool.
+ */
+/* ====================================================================== */
+static void
+collect_returned_cells(ESM_MESSAGE_POOL * const pool)
+{
+    ESM_MESSAGE_CELL *last, *cell;
+
+    last = esm_mq_Last(&pool->returned);
+
+    while ((cell = esm_mq_Pop(&pool->returned, last)) != NULL) {
+        push_free_cell(pool, cell);
+        if (cell == last) {
+            break;
+        }
+    }
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the pool with the cells (and clear the statistics).
+ *
+ * @param[out]    pool       Pool.
+ * @param[in,out] cells      Cells to manage.
+ * @param[in]     num_cells  Number of the cells.
+ */
+/* ********************************************************************** */
+void
+esm_mp_Initialize(ESM_MESSAGE_POOL * const pool,
+                  ESM_MESSAGE_CELL * const cells,
+                  const size_t num_cells)
+{
+    assert((pool != NULL) && ((cells != NULL) || (num_cells == 0)));
+
+    pool->free_cells = NULL;
+    pool->num_free = 0;
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    esm_mq_Initialize(&pool->returned);
+#endif
+
+    pool->capacity = 0;
+    pool->high_water = 0;
+    pool->alloc_failures = 0;
+
+    esm_mp_AddCells(pool, cells, num_cells);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Allocate a cell from the pool in constant time.
+ *
+ * @param[in,out] pool  Pool.
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  No free cell.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_mp_Alloc(ESM_MESSAGE_POOL * const pool)
+{
+    ESM_MESSAGE_CELL *cell;
+    size_t in_use;
+
+    assert(pool != NULL);
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    collect_returned_cells(pool);
+#endif
+
+    cell = pool->free_cells;
+    if (cell == NULL) {
+        pool->alloc_failures++;
+        return NULL;
+    }
+
+    pool->free_cells = cell->next;
+    pool->num_free--;
+
+    in_use = pool->capacity - pool->num_free;
+    if (pool->high_water < in_use) {
+        pool->high_water = in_use;
+    }
+
+    assert(cell->empty);
+    cell->empty = false;
+    cell->next = NULL;
+
+    return cell;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Add the cells (e.g. a newly allocated slab) to the pool.
+ *
+ * @param[in,out] pool       Pool.
+ * @param[in,out] cells      Cells to add.
+ * @param[in]     num_cells  Number of the cells.
+ */
+/* ********************************************************************** */
+void
+esm_mp_AddCells(ESM_MESSAGE_POOL * const pool,
+                ESM_MESSAGE_CELL * const cells,
+                const size_t num_cells)
+{
+    size_t i;
+
+    assert((pool != NULL) && ((cells != NULL) || (num_cells == 0)));
+
+    /* In reverse order, to allocate the cells from the top. */
+    for (i = num_cells; i > 0; i--) {
+        cells[i - 1].empty = true;
+        push_free_cell(pool, &cells[i - 1]);
+    }
+
+    pool->capacity += num_cells;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Remove the cells (added by esm_mp_AddCells()) from the pool
+ *         if all of them are free.
+ *
+ * @param[in,out] pool       Pool.
+ * @param[in]     cells      Cells to remove.
+ * @param[in]     num_cells  Number of the cells.
+ *
+ * @retval true   Removed (the memory of the cells can be released).
+ * @retval false  Some of the cells are in use (nothing is removed).
+ */
+/* ********************************************************************** */
+bool
+esm_mp_RemoveCells(ESM_MESSAGE_POOL * const pool,
+                   const ESM_MESSAGE_CELL * const cells,
+                   const size_t num_cells)
+{
+    ESM_MESSAGE_CELL **link;
+    ESM_MESSAGE_CELL *cell;
+    size_t count;
+
+    assert((pool != NULL) && ((cells != NULL) || (num_cells == 0)));
+    assert(num_cells <= pool->capacity);
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    collect_returned_cells(pool);
+#endif
+
+    if (pool->num_free < num_cells) {
+        return false;
+    }
+
+    count = 0;
+    for (cell = pool->free_cells; cell != NULL; cell = cell->next) {
+        if (is_one_of_cells(cell, cells, num_cells)) {
+            count++;
+        }
+    }
+    if (count != num_cells) {
+        return false;
+    }
+
+    link = &pool->free_cells;
+    while (*link != NULL) {
+        if (is_one_of_cells(*link, cells, num_cells)) {
+            *link = (*link)->next;
+        } else {
+            link = &(*link)->next;
+        }
+    }
+
+    pool->num_free -= num_cells;
+    pool->capacity -= num_cells;
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the number of the free cells.
+ *
+ * @param[in,out] pool  Pool.
+ *
+ * @return  Number of the free cells.
+ */
+/* ********************************************************************** */
+size_t
+esm_mp_NumFree(ESM_MESSAGE_POOL * const pool)
+{
+    assert(pool != NULL);
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    collect_returned_cells(pool);
+#endif
+
+    return pool->num_free;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the cell to the pool in constant time.
+ *
+ * @param[in,out] pool  Pool.
+ * @param[in,out] cell  Message cell.
+ */
+/* ********************************************************************** */
+void
+esm_mp_Free(ESM_MESSAGE_POOL * const pool, ESM_MESSAGE_CELL * const cell)
+{
+    assert((pool != NULL) && (cell != NULL));
+    assert(!cell->empty);
+
+    cell->empty = true;
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    esm_mq_Push(&pool->returned, cell);
+#else
+    push_free_cell(pool, cell);
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the pool.
+ *
+ * @param[in]  pool   Pool.
+ * @param[out] stats  Statistics.
+ */
+/* ********************************************************************** */
+void
+esm_mp_GetStats(const ESM_MESSAGE_POOL * const pool,
+                ESM_MESSAGE_POOL_STATS * const stats)
+{
+    assert((pool != NULL) && (stats != NULL));
+
+    stats->capacity = pool->capacity;
+    stats->in_use = pool->capacity - pool->num_free;
+    stats->high_water = pool->high_water;
+    stats->alloc_failures = pool->alloc_failures;
+}
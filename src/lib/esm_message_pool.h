@@ -0,0 +1,176 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: message cell pool interfaces (for machdep library).
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_MESSAGE_POOL_H_INCLUDED
+#define ESM_MESSAGE_POOL_H_INCLUDED
+
+#include "esm_private.h"
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+#include "esm_mpsc_queue.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Message cell pool type (free list of ESM_MESSAGE_CELL).
+ * The free cells are linked with ESM_MESSAGE_CELL::next.
+ */
+typedef struct {
+    /* Free cells (owned by the allocator). */
+    ESM_MESSAGE_CELL *free_cells;
+    size_t num_free;
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    /* Cells freed from any thread (collected by the allocator). */
+    ESM_MPSC_QUEUE returned;
+#endif
+
+    /* Statistics. */
+    size_t capacity;
+    size_t high_water;
+    uint32_t alloc_failures;
+} ESM_MESSAGE_POOL;
+
+/** Message cell pool statistics type. */
+typedef struct {
+    size_t capacity;            /**< Number of cells. */
+    size_t in_use;              /**< Number of cells in use. */
+    size_t high_water;          /**< Maximum number of cells in use. */
+    uint32_t alloc_failures;    /**< Number of allocation failures. */
+} ESM_MESSAGE_POOL_STATS;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the pool with the cells (and clear the statistics).
+ *
+ * @param[out]    pool       Pool.
+ * @param[in,out] cells      Cells to manage.
+ * @param[in]     num_cells  Number of the cells.
+ */
+/* ********************************************************************** */
+extern void
+esm_mp_Initialize(ESM_MESSAGE_POOL * const pool,
+                  ESM_MESSAGE_CELL * const cells,
+                  const size_t num_cells);
+
+/* ********************************************************************** */
+/**
+ * @brief  Allocate a cell from the pool in constant time.
+ *
+ * @param[in,out] pool  Pool.
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  No free cell.
+ *
+ * @note  Not thread-safe. Serialize the calls (e.g. in esm_md_LockForAPI()).
+ */
+/* ********************************************************************** */
+extern ESM_MESSAGE_CELL *
+esm_mp_Alloc(ESM_MESSAGE_POOL * const pool);
+
+/* ********************************************************************** */
+/**
+ * @brief  Add the cells (e.g. a newly allocated slab) to the pool.
+ *
+ * @param[in,out] pool       Pool.
+ * @param[in,out] cells      Cells to add.
+ * @param[in]     num_cells  Number of the cells.
+ *
+ * @note  Not thread-safe. Serialize the calls with esm_mp_Alloc().
+ */
+/* ********************************************************************** */
+extern void
+esm_mp_AddCells(ESM_MESSAGE_POOL * const pool,
+                ESM_MESSAGE_CELL * const cells,
+                const size_t num_cells);
+
+/* ********************************************************************** */
+/**
+ * @brief  Remove the cells (added by esm_mp_AddCells()) from the pool
+ *         if all of them are free.
+ *
+ * @param[in,out] pool       Pool.
+ * @param[in]     cells      Cells to remove.
+ * @param[in]     num_cells  Number of the cells.
+ *
+ * @retval true   Removed (the memory of the cells can be released).
+ * @retval false  Some of the cells are in use (nothing is removed).
+ *
+ * @note  Not thread-safe. Serialize the calls with esm_mp_Alloc().
+ *        O(number of the free cells).
+ */
+/* ********************************************************************** */
+extern bool
+esm_mp_RemoveCells(ESM_MESSAGE_POOL * const pool,
+                   const ESM_MESSAGE_CELL * const cells,
+                   const size_t num_cells);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the number of the free cells.
+ *
+ * @param[in,out] pool  Pool.
+ *
+ * @return  Number of the free cells (esm_mp_Alloc() succeeds if not 0).
+ *
+ * @note  Not thread-safe. Serialize the calls with esm_mp_Alloc().
+ */
+/* ********************************************************************** */
+extern size_t
+esm_mp_NumFree(ESM_MESSAGE_POOL * const pool);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the cell to the pool in constant time.
+ *
+ * @param[in,out] pool  Pool.
+ * @param[in,out] cell  Message cell.
+ *
+ * @note  If ESM_CFG_USE_MPSC_QUEUE is defined, this function is lock-free
+ *        and can be called from any thread. Otherwise serialize the calls
+ *        with esm_mp_Alloc().
+ */
+/* ********************************************************************** */
+extern void
+esm_mp_Free(ESM_MESSAGE_POOL * const pool, ESM_MESSAGE_CELL * const cell);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the pool.
+ *
+ * @param[in]  pool   Pool.
+ * @param[out] stats  Statistics.
+ *
+ * @note  Serialize the calls with esm_mp_Alloc(). If ESM_CFG_USE_MPSC_QUEUE
+ *        is defined, ESM_MESSAGE_POOL_STATS::in_use also counts the cells
+ *        freed but not yet collected by esm_mp_Alloc().
+ */
+/* ********************************************************************** */
+extern void
+esm_mp_GetStats(const ESM_MESSAGE_POOL * const pool,
+                ESM_MESSAGE_POOL_STATS * const stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_MESSAGE_POOL_H_INCLUDED */
@@ -0,0 +1,183 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: lock-free MPSC message queue implementation.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * A producer swaps the head with its cell (one atomic exchange) and then
+ * links the previous head to it. A chain of cells is pushed in the same way
+ * (swaps with the last cell, and links to the first cell). The consumer walks from the tail, and
+ * re-pushes the stub cell to take out the last real cell. The atomic
+ * operations are provided by the machdep library.
+ */
+/* ********************************************************************** */
+
+#include "esm_mpsc_queue.h"
+#include "esm_md.h"
+
+#include <stddef.h>
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the queue.
+ *
+ * @param[out] queue  Queue.
+ */
+/* ********************************************************************** */
+void
+esm_mq_Initialize(ESM_MPSC_QUEUE * const queue)
+{
+    assert(queue != NULL);
+
+    queue->stub.empty = false;
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Push the cell to the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in,out] cell   Message cell.
+ *
+ * @note  Lock-free. This function can be called from any thread.
+ */
+/* ********************************************************************** */
+void
+esm_mq_Push(ESM_MPSC_QUEUE * const queue, ESM_MESSAGE_CELL * const cell)
+{
+    assert((queue != NULL) && (cell != NULL));
+
+    esm_mq_PushChain(queue, cell, cell);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Push the chain of the cells to the queue at once.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in,out] first  First cell of the chain.
+ * @param[in,out] last   Last cell of the chain.
+ *
+ * @note  Lock-free. This function can be called from any thread.
+ */
+/* ********************************************************************** */
+void
+esm_mq_PushChain(ESM_MPSC_QUEUE * const queue,
+                 ESM_MESSAGE_CELL * const first,
+                 ESM_MESSAGE_CELL * const last)
+{
+    ESM_MESSAGE_CELL *prev;
+
+    assert((queue != NULL) && (first != NULL) && (last != NULL));
+
+    /* Published (with the links in the chain) by the release of the exchange. */
+    last->next = NULL;
+
+    prev = esm_md_ExchangeMessageCell(&queue->head, last);
+
+    /* Until this store, the consumer sees the queue as "in the middle of the push". */
+    esm_md_StoreMessageCell(&prev->next, first);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the last pushed cell (the end of the current contents).
+ *
+ * @param[in] queue  Queue.
+ *
+ * @return  Last pushed cell (may be the internal stub).
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_mq_Last(const ESM_MPSC_QUEUE * const queue)
+{
+    assert(queue != NULL);
+
+    return esm_md_LoadMessageCell(&queue->head);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop the oldest cell pushed up to the last cell.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in]     last   Result of esm_mq_Last().
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  No cell pushed up to the last cell, or a producer is in
+ *                 the middle of the push (try again later).
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_mq_Pop(ESM_MPSC_QUEUE * const queue, const ESM_MESSAGE_CELL * const last)
+{
+    ESM_MESSAGE_CELL *tail, *next;
+
+    assert((queue != NULL) && (last != NULL));
+
+    tail = queue->tail;
+    next = esm_md_LoadMessageCell(&tail->next);
+
+    if (tail == &queue->stub) {
+        /* The cells behind the stub are newer than the last cell. */
+        if ((next == NULL) || (last == &queue->stub)) {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = esm_md_LoadMessageCell(&tail->next);
+    }
+
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+
+    if (tail != esm_md_LoadMessageCell(&queue->head)) {
+        /* A producer has swapped the head but not linked the cell yet. */
+        return NULL;
+    }
+
+    /* The tail is the only cell: put the stub behind it to take it out. */
+    esm_mq_Push(queue, &queue->stub);
+
+    next = esm_md_LoadMessageCell(&tail->next);
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if the queue is empty.
+ *
+ * @param[in] queue  Queue.
+ *
+ * @retval true   Empty.
+ * @retval false  Not empty (or a producer is in the middle of the push).
+ */
+/* ********************************************************************** */
+bool
+esm_mq_IsEmpty(const ESM_MPSC_QUEUE * const queue)
+{
+    assert(queue != NULL);
+
+    return (queue->tail == &queue->stub)
+        && (esm_md_LoadMessageCell(&queue->head) == &queue->stub);
+}
@@ -0,0 +1,140 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: lock-free MPSC message queue interfaces.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_MPSC_QUEUE_H_INCLUDED
+#define ESM_MPSC_QUEUE_H_INCLUDED
+
+#include "esm_private.h"
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Assumed cache line size (to keep the producer and consumer sides apart). */
+#define ESM_MQ_CACHE_LINE_SIZE 64
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Intrusive multi-producer/single-consumer queue type (Vyukov-style).
+ * The cells are linked with ESM_MESSAGE_CELL::next.
+ */
+typedef struct {
+    /* Last pushed cell (updated by the producers). */
+    ESM_MESSAGE_CELL *head;
+
+    char padding[ESM_MQ_CACHE_LINE_SIZE];
+
+    /* Next cell to pop (owned by the consumer). */
+    ESM_MESSAGE_CELL *tail;
+    ESM_MESSAGE_CELL stub;
+} ESM_MPSC_QUEUE;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the queue.
+ *
+ * @param[out] queue  Queue.
+ */
+/* ********************************************************************** */
+extern void
+esm_mq_Initialize(ESM_MPSC_QUEUE * const queue);
+
+/* ********************************************************************** */
+/**
+ * @brief  Push the cell to the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in,out] cell   Message cell.
+ *
+ * @note  Lock-free. This function can be called from any thread.
+ */
+/* ********************************************************************** */
+extern void
+esm_mq_Push(ESM_MPSC_QUEUE * const queue, ESM_MESSAGE_CELL * const cell);
+
+/* ********************************************************************** */
+/**
+ * @brief  Push the chain of the cells to the queue at once.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in,out] first  First cell of the chain.
+ * @param[in,out] last   Last cell of the chain.
+ *
+ * @note  Lock-free. This function can be called from any thread.
+ *        The cells from first to last must be linked with
+ *        ESM_MESSAGE_CELL::next.
+ */
+/* ********************************************************************** */
+extern void
+esm_mq_PushChain(ESM_MPSC_QUEUE * const queue,
+                 ESM_MESSAGE_CELL * const first,
+                 ESM_MESSAGE_CELL * const last);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the last pushed cell (the end of the current contents).
+ *
+ * @param[in] queue  Queue.
+ *
+ * @return  Last pushed cell (may be the internal stub).
+ *
+ * @note  For the consumer only. Pass the result to esm_mq_Pop().
+ */
+/* ********************************************************************** */
+extern ESM_MESSAGE_CELL *
+esm_mq_Last(const ESM_MPSC_QUEUE * const queue);
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop the oldest cell pushed up to the last cell.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in]     last   Result of esm_mq_Last().
+ *
+ * @retval !=NULL  Message cell.
+ * @retval   NULL  No cell pushed up to the last cell, or a producer is in
+ *                 the middle of the push (try again later).
+ *
+ * @note  For the consumer only. The cells pushed after esm_mq_Last() are
+ *        left in the queue, so stop popping once the last cell is returned.
+ */
+/* ********************************************************************** */
+extern ESM_MESSAGE_CELL *
+esm_mq_Pop(ESM_MPSC_QUEUE * const queue, const ESM_MESSAGE_CELL * const last);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if the queue is empty.
+ *
+ * @param[in] queue  Queue.
+ *
+ * @retval true   Empty.
+ * @retval false  Not empty (or a producer is in the middle of the push).
+ *
+ * @note  For the consumer only.
+ */
+/* ********************************************************************** */
+extern bool
+esm_mq_IsEmpty(const ESM_MPSC_QUEUE * const queue);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_MPSC_QUEUE_H_INCLUDED */
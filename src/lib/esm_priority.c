@@ -0,0 +1,219 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: priority lane selector implementation.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The non-empty lanes are kept in a bitmap, so the highest non-empty lane
+ * is found by counting the trailing zero bits (no scan of the lanes).
+ *
+ * Strict priority starves the low-priority lanes under a steady stream of
+ * high-priority work. If ESM_CFG_PRIORITY_AGING is defined, every
+ * ESM_CFG_PRIORITY_AGING-th selection takes the next non-empty lane in
+ * round-robin order, so each lane is served at least once per
+ * ESM_CFG_PRIORITY_AGING * ESM_CFG_PRIORITIES selections.
+ */
+/* ********************************************************************** */
+
+#include "esm_priority.h"
+
+#include <stdint.h>
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+#if defined(ESM_CFG_PRIORITY_AGING) && (ESM_CFG_PRIORITY_AGING < 1)
+#error "ESM_CFG_PRIORITY_AGING must be 1 or more."
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Function-like macros */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Return the bit of the lane.
+ *
+ * @param[in] priority  Priority of the lane.
+ *
+ * @return  Bit of the lane.
+ */
+/* ====================================================================== */
+#define LANE_BIT(priority) (((uint32_t) 1) << (priority))
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Count trailing zero bits.
+ *
+ * @param[in] bits  Bits (must not be 0).
+ *
+ * @return  Number of trailing zero bits.
+ */
+/* ====================================================================== */
+static unsigned
+count_trailing_zeros(uint32_t bits)
+{
+    unsigned n;
+
+    assert(bits != 0);
+
+    n = 0;
+    if ((bits & 0xFFFFU) == 0) {
+        n += 16;
+        bits >>= 16;
+    }
+    if ((bits & 0xFFU) == 0) {
+        n += 8;
+        bits >>= 8;
+    }
+    if ((bits & 0xFU) == 0) {
+        n += 4;
+        bits >>= 4;
+    }
+    if ((bits & 0x3U) == 0) {
+        n += 2;
+        bits >>= 2;
+    }
+    if ((bits & 0x1U) == 0) {
+        n += 1;
+    }
+
+    return n;
+}
+
+#ifdef ESM_CFG_PRIORITY_AGING
+/* ====================================================================== */
+/**
+ * @brief  Select the next non-empty lane in round-robin order.
+ *
+ * @param[in,out] set  Priority lane selector (must not be empty).
+ *
+ * @return  Priority of the lane.
+ */
+/* ====================================================================== */
+static ESM_PRIORITY
+select_aging_lane(ESM_PRIORITY_SET * const set)
+{
+    uint32_t lanes;
+    ESM_PRIORITY priority;
+
+    assert((set != NULL) && (set->lanes != 0));
+
+    /* The lanes from next_aging_lane, or wrap around. */
+    lanes = set->lanes & ~(LANE_BIT(set->next_aging_lane) - 1);
+    if (lanes == 0) {
+        lanes = set->lanes;
+    }
+
+    priority = (ESM_PRIORITY) count_trailing_zeros(lanes);
+    set->next_aging_lane = (priority + 1) % ESM_CFG_PRIORITIES;
+
+    return priority;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the selector (all lanes are empty).
+ *
+ * @param[out] set  Priority lane selector.
+ */
+/* ********************************************************************** */
+void
+esm_pr_Initialize(ESM_PRIORITY_SET * const set)
+{
+    assert(set != NULL);
+
+    set->lanes = 0;
+
+#ifdef ESM_CFG_PRIORITY_AGING
+    set->picks = 0;
+    set->next_aging_lane = 0;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Mark the lane as not empty.
+ *
+ * @param[in,out] set       Priority lane selector.
+ * @param[in]     priority  Priority of the lane.
+ */
+/* ********************************************************************** */
+void
+esm_pr_Mark(ESM_PRIORITY_SET * const set, const ESM_PRIORITY priority)
+{
+    assert((set != NULL) && (priority < ESM_CFG_PRIORITIES));
+
+    set->lanes |= LANE_BIT(priority);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Mark the lane as empty.
+ *
+ * @param[in,out] set       Priority lane selector.
+ * @param[in]     priority  Priority of the lane.
+ */
+/* ********************************************************************** */
+void
+esm_pr_Unmark(ESM_PRIORITY_SET * const set, const ESM_PRIORITY priority)
+{
+    assert((set != NULL) && (priority < ESM_CFG_PRIORITIES));
+
+    set->lanes &= ~LANE_BIT(priority);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if all lanes are empty.
+ *
+ * @param[in] set  Priority lane selector.
+ *
+ * @retval true   All lanes are empty.
+ * @retval false  Some lane is not empty.
+ */
+/* ********************************************************************** */
+bool
+esm_pr_IsEmpty(const ESM_PRIORITY_SET * const set)
+{
+    assert(set != NULL);
+
+    return set->lanes == 0;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Select the lane to serve next in constant time.
+ *
+ * @param[in,out] set  Priority lane selector (must not be empty).
+ *
+ * @return  Priority of the lane.
+ */
+/* ********************************************************************** */
+ESM_PRIORITY
+esm_pr_Select(ESM_PRIORITY_SET * const set)
+{
+    assert((set != NULL) && (set->lanes != 0));
+
+#ifdef ESM_CFG_PRIORITY_AGING
+    set->picks++;
+    if (set->picks >= ESM_CFG_PRIORITY_AGING) {
+        set->picks = 0;
+        return select_aging_lane(set);
+    }
+#endif
+
+    return (ESM_PRIORITY) count_trailing_zeros(set->lanes);
+}
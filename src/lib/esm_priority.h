@@ -0,0 +1,121 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: priority lane selector interfaces.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_PRIORITY_H_INCLUDED
+#define ESM_PRIORITY_H_INCLUDED
+
+#include "esm_private.h"
+
+#include <stdint.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+#ifndef ESM_CFG_PRIORITIES
+/** Number of priority levels (see esm_config.h). */
+#define ESM_CFG_PRIORITIES 4
+#endif
+
+#if (ESM_CFG_PRIORITIES < 1) || (ESM_CFG_PRIORITIES > 32)
+#error "ESM_CFG_PRIORITIES must be 1 to 32."
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Priority lane selector type.
+ * Bit N of the bitmap is set while the lane of priority N is not empty.
+ */
+typedef struct {
+    uint32_t lanes;
+
+#ifdef ESM_CFG_PRIORITY_AGING
+    /* Anti-starvation state. */
+    uint32_t picks;
+    ESM_PRIORITY next_aging_lane;
+#endif
+} ESM_PRIORITY_SET;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the selector (all lanes are empty).
+ *
+ * @param[out] set  Priority lane selector.
+ */
+/* ********************************************************************** */
+extern void
+esm_pr_Initialize(ESM_PRIORITY_SET * const set);
+
+/* ********************************************************************** */
+/**
+ * @brief  Mark the lane as not empty.
+ *
+ * @param[in,out] set       Priority lane selector.
+ * @param[in]     priority  Priority of the lane.
+ */
+/* ********************************************************************** */
+extern void
+esm_pr_Mark(ESM_PRIORITY_SET * const set, const ESM_PRIORITY priority);
+
+/* ********************************************************************** */
+/**
+ * @brief  Mark the lane as empty.
+ *
+ * @param[in,out] set       Priority lane selector.
+ * @param[in]     priority  Priority of the lane.
+ */
+/* ********************************************************************** */
+extern void
+esm_pr_Unmark(ESM_PRIORITY_SET * const set, const ESM_PRIORITY priority);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if all lanes are empty.
+ *
+ * @param[in] set  Priority lane selector.
+ *
+ * @retval true   All lanes are empty.
+ * @retval false  Some lane is not empty.
+ */
+/* ********************************************************************** */
+extern bool
+esm_pr_IsEmpty(const ESM_PRIORITY_SET * const set);
+
+/* ********************************************************************** */
+/**
+ * @brief  Select the lane to serve next in constant time.
+ *
+ * @param[in,out] set  Priority lane selector (must not be empty).
+ *
+ * @return  Priority of the lane.
+ *
+ * @note  Usually the highest (numerically lowest) non-empty lane is
+ *        selected. If ESM_CFG_PRIORITY_AGING is defined, every
+ *        ESM_CFG_PRIORITY_AGING-th selection serves the non-empty lanes in
+ *        round-robin instead, so the low-priority lanes still drain.
+ */
+/* ********************************************************************** */
+extern ESM_PRIORITY
+esm_pr_Select(ESM_PRIORITY_SET * const set);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_PRIORITY_H_INCLUDED */
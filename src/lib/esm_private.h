@@ -12,6 +12,30 @@
 #include "esm.h"
 #include "esm_config.h"
 
+/* ---------------------------------------------------------------------- */
+/* Data types */
+/* ---------------------------------------------------------------------- */
+
+/** Internal time base of the timers (see ESM_CFG_USE_TICK_USEC). */
+#ifdef ESM_CFG_USE_TICK_USEC
+typedef ESM_SYS_TICK_USEC ESM_SYS_TICK;
+#else
+typedef ESM_SYS_TICK_MSEC ESM_SYS_TICK;
+#endif
+
+#ifdef ESM_CFG_MESSAGE_PAYLOAD_SIZE
+/** Inline message payload type (see esm_PostMessageData()). */
+typedef union {
+    unsigned char bytes[ESM_CFG_MESSAGE_PAYLOAD_SIZE];
+
+    /* For alignment only. */
+    uint64_t align_u64;
+    double align_double;
+    void *align_ptr;
+    void (*align_func)(void);
+} ESM_MESSAGE_PAYLOAD;
+#endif
+
 /* ---------------------------------------------------------------------- */
 /* Data structures */
 /* ---------------------------------------------------------------------- */
@@ -24,6 +48,14 @@ struct  ESM_MESSAGE_CELL {
 
     ESM_MESSAGE_CELL *next;
     ESM_MESSAGE message;
+#ifdef ESM_CFG_MESSAGE_PAYLOAD_SIZE
+    ESM_MESSAGE_PAYLOAD payload;
+#endif
+#ifdef ESM_CFG_USE_INVOKE
+    /* Completion slot of esm_Invoke() (for library only). */
+    bool invoked;
+    uint8_t invoke_state;
+#endif
 };
 
 #endif /* ndef ESM_PRIVATE_H_INCLUDED */
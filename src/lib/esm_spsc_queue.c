@@ -0,0 +1,138 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: lock-free SPSC message queue implementation.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * A fixed ring of messages. The producer writes the slot and then
+ * publishes the tail (release), and the consumer reads the tail (acquire),
+ * copies the slot and then publishes the head (release). The atomic
+ * operations are provided by the machdep library.
+ */
+/* ********************************************************************** */
+
+#include "esm_spsc_queue.h"
+#include "esm_md.h"
+
+#include <stddef.h>
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Function-like macros */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Return the slot of the index.
+ *
+ * @param[in] q  Queue.
+ * @param[in] i  Free-running index.
+ *
+ * @return  Slot (ESM_MESSAGE).
+ */
+/* ====================================================================== */
+#define sq_Slot(q, i) ((q)->messages[(i) & (ESM_CFG_MESSAGE_SHARD_SIZE - 1)])
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the queue.
+ *
+ * @param[out] queue  Queue.
+ */
+/* ********************************************************************** */
+void
+esm_sq_Initialize(ESM_SPSC_QUEUE * const queue)
+{
+    assert(queue != NULL);
+
+    queue->tail = 0;
+    queue->head = 0;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Push (copy) the message to the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in]     msg    Message.
+ *
+ * @retval true   Exit success.
+ * @retval false  The queue is full.
+ */
+/* ********************************************************************** */
+bool
+esm_sq_Push(ESM_SPSC_QUEUE * const queue, const ESM_MESSAGE * const msg)
+{
+    size_t tail;
+
+    assert((queue != NULL) && (msg != NULL));
+
+    /* The tail is owned by the producer: no need to load atomically. */
+    tail = queue->tail;
+
+    if ((tail - esm_md_LoadSize(&queue->head)) >= ESM_CFG_MESSAGE_SHARD_SIZE) {
+        return false;
+    }
+
+    sq_Slot(queue, tail) = *msg;
+    esm_md_StoreSize(&queue->tail, tail + 1);
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop (copy) the oldest message from the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[out]    msg    Message.
+ *
+ * @retval true   Exit success.
+ * @retval false  The queue is empty.
+ */
+/* ********************************************************************** */
+bool
+esm_sq_Pop(ESM_SPSC_QUEUE * const queue, ESM_MESSAGE * const msg)
+{
+    size_t head;
+
+    assert((queue != NULL) && (msg != NULL));
+
+    /* The head is owned by the consumer: no need to load atomically. */
+    head = queue->head;
+
+    if (head == esm_md_LoadSize(&queue->tail)) {
+        return false;
+    }
+
+    *msg = sq_Slot(queue, head);
+    esm_md_StoreSize(&queue->head, head + 1);
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the number of the messages in the queue.
+ *
+ * @param[in] queue  Queue.
+ *
+ * @return  Number of the messages.
+ */
+/* ********************************************************************** */
+size_t
+esm_sq_Count(const ESM_SPSC_QUEUE * const queue)
+{
+    assert(queue != NULL);
+
+    return esm_md_LoadSize(&queue->tail) - queue->head;
+}
@@ -0,0 +1,122 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: lock-free SPSC message queue interfaces.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_SPSC_QUEUE_H_INCLUDED
+#define ESM_SPSC_QUEUE_H_INCLUDED
+
+#include "esm_private.h"
+
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Assumed cache line size (to keep the producer and consumer sides apart). */
+#define ESM_SQ_CACHE_LINE_SIZE 64
+
+#ifndef ESM_CFG_MESSAGE_SHARD_SIZE
+/** Number of messages per queue (see esm_config.h). */
+#define ESM_CFG_MESSAGE_SHARD_SIZE 64
+#endif
+
+#if (ESM_CFG_MESSAGE_SHARD_SIZE & (ESM_CFG_MESSAGE_SHARD_SIZE - 1)) != 0
+#error "ESM_CFG_MESSAGE_SHARD_SIZE must be a power of two."
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Single-producer/single-consumer message ring type.
+ * The indices run freely, and are masked by ESM_CFG_MESSAGE_SHARD_SIZE.
+ */
+typedef struct {
+    /* Next index to push (updated by the producer). */
+    size_t tail;
+
+    char padding[ESM_SQ_CACHE_LINE_SIZE];
+
+    /* Next index to pop (updated by the consumer). */
+    size_t head;
+
+    char padding2[ESM_SQ_CACHE_LINE_SIZE];
+
+    ESM_MESSAGE messages[ESM_CFG_MESSAGE_SHARD_SIZE];
+} ESM_SPSC_QUEUE;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the queue.
+ *
+ * @param[out] queue  Queue.
+ */
+/* ********************************************************************** */
+extern void
+esm_sq_Initialize(ESM_SPSC_QUEUE * const queue);
+
+/* ********************************************************************** */
+/**
+ * @brief  Push (copy) the message to the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[in]     msg    Message.
+ *
+ * @retval true   Exit success.
+ * @retval false  The queue is full.
+ *
+ * @note  Lock-free. For the producer only.
+ */
+/* ********************************************************************** */
+extern bool
+esm_sq_Push(ESM_SPSC_QUEUE * const queue, const ESM_MESSAGE * const msg);
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop (copy) the oldest message from the queue.
+ *
+ * @param[in,out] queue  Queue.
+ * @param[out]    msg    Message.
+ *
+ * @retval true   Exit success.
+ * @retval false  The queue is empty.
+ *
+ * @note  Lock-free. For the consumer only.
+ */
+/* ********************************************************************** */
+extern bool
+esm_sq_Pop(ESM_SPSC_QUEUE * const queue, ESM_MESSAGE * const msg);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the number of the messages in the queue.
+ *
+ * @param[in] queue  Queue.
+ *
+ * @return  Number of the messages.
+ *
+ * @note  For the consumer only.
+ */
+/* ********************************************************************** */
+extern size_t
+esm_sq_Count(const ESM_SPSC_QUEUE * const queue);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_SPSC_QUEUE_H_INCLUDED */
@@ -0,0 +1,365 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: structure-of-arrays timer table implementation.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The expiry check of a block is branch-free: a timer is expired when the
+ * sign bit of (current_time - expire_time) is clear, so the sign bits of
+ * the vector subtraction are gathered into a bit mask at once.
+ */
+/* ********************************************************************** */
+
+#include "esm_timer_soa.h"
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+#if defined(ESM_CFG_TIMER_SOA_NO_SIMD)
+/* Use the portable scalar kernel. */
+#elif defined(__AVX2__)
+#define USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Bit mask of the index in the block. */
+#define BLOCK_MASK ((size_t) ESM_TS_BLOCK_SIZE - 1)
+
+/** Number of bits to convert the index to the block number. */
+#define BLOCK_SHIFT 5
+
+#if (1 << BLOCK_SHIFT) != ESM_TS_BLOCK_SIZE
+#error "BLOCK_SHIFT does not match ESM_TS_BLOCK_SIZE."
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: expiry check kernels */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Count trailing zero bits.
+ *
+ * @param[in] bits  Bits (must not be 0).
+ *
+ * @return  Number of trailing zero bits.
+ */
+/* ====================================================================== */
+static unsigned
+count_trailing_zeros(uint32_t bits)
+{
+    unsigned n;
+
+    assert(bits != 0);
+
+    n = 0;
+    if ((bits & 0xFFFFU) == 0) {
+        n += 16;
+        bits >>= 16;
+    }
+    if ((bits & 0xFFU) == 0) {
+        n += 8;
+        bits >>= 8;
+    }
+    if ((bits & 0xFU) == 0) {
+        n += 4;
+        bits >>= 4;
+    }
+    if ((bits & 0x3U) == 0) {
+        n += 2;
+        bits >>= 2;
+    }
+    if ((bits & 0x1U) == 0) {
+        n += 1;
+    }
+
+    return n;
+}
+
+#if defined(USE_AVX2)
+/* ====================================================================== */
+/**
+ * @brief  Return the bit mask of the not-yet-expired timers in the block.
+ *
+ * @param[in] expire_times  Expiration times of the block.
+ * @param[in] current_time  Current system tick.
+ *
+ * @return  Bit mask (1: not expired yet).
+ */
+/* ====================================================================== */
+static uint32_t
+scan_block(const ESM_SYS_TICK * const expire_times,
+           const ESM_SYS_TICK current_time)
+{
+    uint32_t pending;
+    size_t i;
+
+    pending = 0;
+
+    if (sizeof(ESM_SYS_TICK) == sizeof(int32_t)) {
+        const __m256i now = _mm256_set1_epi32((int) current_time);
+
+        for (i = 0; i < ESM_TS_BLOCK_SIZE; i += 8) {
+            __m256i t, d;
+
+            t = _mm256_loadu_si256((const __m256i *) (const void *) &expire_times[i]);
+            d = _mm256_sub_epi32(now, t);
+            pending |= (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(d)) << i;
+        }
+    } else {
+        const __m256i now = _mm256_set1_epi64x((long long) current_time);
+
+        for (i = 0; i < ESM_TS_BLOCK_SIZE; i += 4) {
+            __m256i t, d;
+
+            t = _mm256_loadu_si256((const __m256i *) (const void *) &expire_times[i]);
+            d = _mm256_sub_epi64(now, t);
+            pending |= (uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(d)) << i;
+        }
+    }
+
+    return pending;
+}
+#elif defined(USE_SSE2)
+/* ====================================================================== */
+/**
+ * @brief  Return the bit mask of the not-yet-expired timers in the block.
+ *
+ * @param[in] expire_times  Expiration times of the block.
+ * @param[in] current_time  Current system tick.
+ *
+ * @return  Bit mask (1: not expired yet).
+ */
+/* ====================================================================== */
+static uint32_t
+scan_block(const ESM_SYS_TICK * const expire_times,
+           const ESM_SYS_TICK current_time)
+{
+    uint32_t pending;
+    size_t i;
+
+    pending = 0;
+
+    if (sizeof(ESM_SYS_TICK) == sizeof(int32_t)) {
+        const __m128i now = _mm_set1_epi32((int) current_time);
+
+        for (i = 0; i < ESM_TS_BLOCK_SIZE; i += 4) {
+            __m128i t, d;
+
+            t = _mm_loadu_si128((const __m128i *) (const void *) &expire_times[i]);
+            d = _mm_sub_epi32(now, t);
+            pending |= (uint32_t) _mm_movemask_ps(_mm_castsi128_ps(d)) << i;
+        }
+    } else {
+        const __m128i now = _mm_set1_epi64x((long long) current_time);
+
+        for (i = 0; i < ESM_TS_BLOCK_SIZE; i += 2) {
+            __m128i t, d;
+
+            t = _mm_loadu_si128((const __m128i *) (const void *) &expire_times[i]);
+            d = _mm_sub_epi64(now, t);
+            pending |= (uint32_t) _mm_movemask_pd(_mm_castsi128_pd(d)) << i;
+        }
+    }
+
+    return pending;
+}
+#else
+/* ====================================================================== */
+/**
+ * @brief  Return the bit mask of the not-yet-expired timers in the block.
+ *
+ * @param[in] expire_times  Expiration times of the block.
+ * @param[in] current_time  Current system tick.
+ *
+ * @return  Bit mask (1: not expired yet).
+ */
+/* ====================================================================== */
+static uint32_t
+scan_block(const ESM_SYS_TICK * const expire_times,
+           const ESM_SYS_TICK current_time)
+{
+    uint32_t pending;
+    size_t i;
+
+    pending = 0;
+    for (i = 0; i < ESM_TS_BLOCK_SIZE; i++) {
+        if ((current_time - expire_times[i]) < 0) {
+            pending |= (uint32_t) 1 << i;
+        }
+    }
+
+    return pending;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timer table.
+ *
+ * @param[out] soa           Timer table.
+ * @param[out] expire_times  Storage of the expiration times.
+ * @param[out] active        Storage of the active bitmap.
+ * @param[in]  num_blocks    Number of blocks (see ESM_TS_NUM_BLOCKS()).
+ */
+/* ********************************************************************** */
+void
+esm_ts_Initialize(ESM_TIMER_SOA * const soa,
+                  ESM_SYS_TICK * const expire_times,
+                  uint32_t * const active,
+                  const size_t num_blocks)
+{
+    size_t i;
+
+    assert((soa != NULL) && (expire_times != NULL) && (active != NULL));
+
+    soa->expire_times = expire_times;
+    soa->active = active;
+    soa->num_blocks = num_blocks;
+
+    for (i = 0; i < num_blocks * ESM_TS_BLOCK_SIZE; i++) {
+        expire_times[i] = 0;
+    }
+    for (i = 0; i < num_blocks; i++) {
+        active[i] = 0;
+    }
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or reschedule) the timer.
+ *
+ * @param[in,out] soa          Timer table.
+ * @param[in]     index        Timer index.
+ * @param[in]     expire_time  Expiration time.
+ *
+ * @note  O(1).
+ */
+/* ********************************************************************** */
+void
+esm_ts_Start(ESM_TIMER_SOA * const soa,
+             const size_t index,
+             const ESM_SYS_TICK expire_time)
+{
+    assert((soa != NULL) && ((index >> BLOCK_SHIFT) < soa->num_blocks));
+
+    soa->expire_times[index] = expire_time;
+    soa->active[index >> BLOCK_SHIFT] |= (uint32_t) 1 << (index & BLOCK_MASK);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer.
+ *
+ * @param[in,out] soa    Timer table.
+ * @param[in]     index  Timer index.
+ *
+ * @note  O(1). It is safe to call this function for the stopped timer.
+ */
+/* ********************************************************************** */
+void
+esm_ts_Stop(ESM_TIMER_SOA * const soa, const size_t index)
+{
+    assert((soa != NULL) && ((index >> BLOCK_SHIFT) < soa->num_blocks));
+
+    soa->active[index >> BLOCK_SHIFT] &= ~((uint32_t) 1 << (index & BLOCK_MASK));
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Find the first expired timer at or after the index.
+ *
+ * @param[in]  soa           Timer table.
+ * @param[in]  from          Index to start the search.
+ * @param[in]  current_time  Current system tick.
+ * @param[out] index         Index of the expired timer.
+ *
+ * @retval true   Found.
+ * @retval false  No more expired timer.
+ */
+/* ********************************************************************** */
+bool
+esm_ts_FindExpired(const ESM_TIMER_SOA * const soa,
+                   const size_t from,
+                   const ESM_SYS_TICK current_time,
+                   size_t * const index)
+{
+    size_t block;
+    uint32_t skip;
+
+    assert((soa != NULL) && (index != NULL));
+
+    block = from >> BLOCK_SHIFT;
+    skip = ~(~(uint32_t) 0 << (from & BLOCK_MASK));
+
+    for (; block < soa->num_blocks; block++, skip = 0) {
+        uint32_t bits;
+
+        bits = soa->active[block] & ~skip;
+        if (bits == 0) {
+            continue;
+        }
+
+        bits &= ~scan_block(&soa->expire_times[block << BLOCK_SHIFT], current_time);
+        if (bits != 0) {
+            *index = (block << BLOCK_SHIFT) + count_trailing_zeros(bits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the earliest expiration time of the running timers.
+ *
+ * @param[in]  soa          Timer table.
+ * @param[out] expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No timer is running.
+ */
+/* ********************************************************************** */
+bool
+esm_ts_GetNextExpireTime(const ESM_TIMER_SOA * const soa,
+                         ESM_SYS_TICK * const expire_time)
+{
+    bool found;
+    size_t block;
+
+    assert((soa != NULL) && (expire_time != NULL));
+
+    found = false;
+    for (block = 0; block < soa->num_blocks; block++) {
+        const ESM_SYS_TICK *times;
+        uint32_t bits;
+
+        times = &soa->expire_times[block << BLOCK_SHIFT];
+        for (bits = soa->active[block]; bits != 0; bits &= bits - 1) {
+            ESM_SYS_TICK t;
+
+            t = times[count_trailing_zeros(bits)];
+            if (!found || ((t - *expire_time) < 0)) {
+                *expire_time = t;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
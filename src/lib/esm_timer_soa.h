@@ -0,0 +1,153 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: structure-of-arrays timer table interfaces.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_TIMER_SOA_H_INCLUDED
+#define ESM_TIMER_SOA_H_INCLUDED
+
+#include "esm_private.h"
+
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of timers per block (i.e. bit width of the active bitmap word). */
+#define ESM_TS_BLOCK_SIZE 32
+
+/* ---------------------------------------------------------------------- */
+/* Function-like macros */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Return the number of blocks for the timers.
+ *
+ * @param[in] n  Number of timers.
+ *
+ * @return  Number of blocks.
+ */
+/* ********************************************************************** */
+#define ESM_TS_NUM_BLOCKS(n) (((n) + ESM_TS_BLOCK_SIZE - 1) / ESM_TS_BLOCK_SIZE)
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * Timer table type.
+ * The expiration times are stored contiguously (apart from the other
+ * members of the timer cells), so the expiry check touches hot data only.
+ */
+typedef struct {
+    /* Expiration times (ESM_TS_NUM_BLOCKS(n) * ESM_TS_BLOCK_SIZE elements). */
+    ESM_SYS_TICK *expire_times;
+
+    /* Bitmap of the running timers (ESM_TS_NUM_BLOCKS(n) elements). */
+    uint32_t *active;
+
+    size_t num_blocks;
+} ESM_TIMER_SOA;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timer table.
+ *
+ * @param[out] soa           Timer table.
+ * @param[out] expire_times  Storage of the expiration times.
+ * @param[out] active        Storage of the active bitmap.
+ * @param[in]  num_blocks    Number of blocks (see ESM_TS_NUM_BLOCKS()).
+ */
+/* ********************************************************************** */
+extern void
+esm_ts_Initialize(ESM_TIMER_SOA * const soa,
+                  ESM_SYS_TICK * const expire_times,
+                  uint32_t * const active,
+                  const size_t num_blocks);
+
+/* ********************************************************************** */
+/**
+ * @brief  Start (or reschedule) the timer.
+ *
+ * @param[in,out] soa          Timer table.
+ * @param[in]     index        Timer index.
+ * @param[in]     expire_time  Expiration time.
+ *
+ * @note  O(1).
+ */
+/* ********************************************************************** */
+extern void
+esm_ts_Start(ESM_TIMER_SOA * const soa,
+             const size_t index,
+             const ESM_SYS_TICK expire_time);
+
+/* ********************************************************************** */
+/**
+ * @brief  Stop the timer.
+ *
+ * @param[in,out] soa    Timer table.
+ * @param[in]     index  Timer index.
+ *
+ * @note  O(1). It is safe to call this function for the stopped timer.
+ */
+/* ********************************************************************** */
+extern void
+esm_ts_Stop(ESM_TIMER_SOA * const soa, const size_t index);
+
+/* ********************************************************************** */
+/**
+ * @brief  Find the first expired timer at or after the index.
+ *
+ * @param[in]  soa           Timer table.
+ * @param[in]  from          Index to start the search.
+ * @param[in]  current_time  Current system tick.
+ * @param[out] index         Index of the expired timer.
+ *
+ * @retval true   Found.
+ * @retval false  No more expired timer.
+ *
+ * @note  The expiration times are compared a block at a time (with SSE2 or
+ *        AVX2 if available), and blocks without running timers are skipped.
+ *        The block is scanned again at every call, so the changes made by
+ *        the timer handlers are always taken into account.
+ */
+/* ********************************************************************** */
+extern bool
+esm_ts_FindExpired(const ESM_TIMER_SOA * const soa,
+                   const size_t from,
+                   const ESM_SYS_TICK current_time,
+                   size_t * const index);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the earliest expiration time of the running timers.
+ *
+ * @param[in]  soa          Timer table.
+ * @param[out] expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No timer is running.
+ */
+/* ********************************************************************** */
+extern bool
+esm_ts_GetNextExpireTime(const ESM_TIMER_SOA * const soa,
+                         ESM_SYS_TICK * const expire_time);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_TIMER_SOA_H_INCLUDED */
@@ -0,0 +1,683 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: hierarchical timing wheel implementation.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * A classic cascading timing wheel (Varghese & Lauck). Each level has
+ * ESM_TW_SLOTS slots, and level N covers (ESM_TW_SLOTS ^ (N + 1)) ticks.
+ * Nodes in the higher level are cascaded into the lower level when the
+ * current tick reaches the slot boundary.
+ *
+ * The wheel works on the unsigned representation of the system tick, so
+ * the wrap-around of the (signed) system tick is handled naturally.
+ */
+/* ********************************************************************** */
+
+#include "esm_timer_wheel.h"
+#include "esm_private.h"
+
+#ifdef ESM_CFG_USE_ASSERT_H
+#include <assert.h>
+#else
+#define assert(cond)
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Bit width of the system tick. */
+#define TICK_BITS (sizeof(ESM_SYS_TICK) * 8)
+
+/** Bit mask of the system tick (unsigned representation). */
+#define TICK_MASK ((((uintmax_t) 1 << (TICK_BITS - 1)) << 1) - 1)
+
+/** Maximum positive distance between two ticks. */
+#define TICK_HALF (TICK_MASK >> 1)
+
+/** Bit mask of the slot index. */
+#define SLOT_MASK ((uint32_t) ESM_TW_SLOTS - 1)
+
+/** Bit mask of the occupied slot bitmap. */
+#define OCCUPIED_MASK (((uint32_t) 1 << ESM_TW_SLOTS) - 1)
+
+/* ---------------------------------------------------------------------- */
+/* Function-like macros */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Convert the system tick to the unsigned representation.
+ *
+ * @param[in] tick  System tick.
+ *
+ * @return  Unsigned representation of the system tick.
+ */
+/* ====================================================================== */
+#define to_utick(tick) ((uintmax_t) (tick) & TICK_MASK)
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: doubly linked list */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Initialize the list head.
+ *
+ * @param[out] head  List head (sentinel node).
+ */
+/* ====================================================================== */
+static void
+list_Initialize(ESM_TW_NODE * const head)
+{
+    assert(head != NULL);
+
+    head->next = head;
+    head->prev = head;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the list is empty.
+ *
+ * @param[in] head  List head (sentinel node).
+ *
+ * @retval true   Empty.
+ * @retval false  Not empty.
+ */
+/* ====================================================================== */
+static bool
+list_IsEmpty(const ESM_TW_NODE * const head)
+{
+    assert(head != NULL);
+
+    return head->next == head;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Append the node to the tail of the list.
+ *
+ * @param[in,out] head  List head (sentinel node).
+ * @param[in,out] node  Node.
+ */
+/* ====================================================================== */
+static void
+list_Append(ESM_TW_NODE * const head, ESM_TW_NODE * const node)
+{
+    assert((head != NULL) && (node != NULL));
+
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Move all nodes of the list to the tail of another list.
+ *
+ * @param[in,out] dst  Destination list head.
+ * @param[in,out] src  Source list head (will be empty).
+ */
+/* ====================================================================== */
+static void
+list_Splice(ESM_TW_NODE * const dst, ESM_TW_NODE * const src)
+{
+    assert((dst != NULL) && (src != NULL));
+
+    if (list_IsEmpty(src)) {
+        return;
+    }
+
+    src->next->prev = dst->prev;
+    dst->prev->next = src->next;
+    src->prev->next = dst;
+    dst->prev = src->prev;
+
+    list_Initialize(src);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: timing wheel */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Count trailing zero bits.
+ *
+ * @param[in] bits  Bits (must not be 0).
+ *
+ * @return  Number of trailing zero bits.
+ */
+/* ====================================================================== */
+static unsigned
+count_trailing_zeros(uint32_t bits)
+{
+    unsigned n;
+
+    assert(bits != 0);
+
+    n = 0;
+    if ((bits & 0xFFFFU) == 0) {
+        n += 16;
+        bits >>= 16;
+    }
+    if ((bits & 0xFFU) == 0) {
+        n += 8;
+        bits >>= 8;
+    }
+    if ((bits & 0xFU) == 0) {
+        n += 4;
+        bits >>= 4;
+    }
+    if ((bits & 0x3U) == 0) {
+        n += 2;
+        bits >>= 2;
+    }
+    if ((bits & 0x1U) == 0) {
+        n += 1;
+    }
+
+    return n;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Link the node to the suitable slot.
+ *
+ * @param[in,out] wheel  Timing wheel.
+ * @param[in,out] node   Timing wheel node.
+ */
+/* ====================================================================== */
+static void
+insert_node(ESM_TIMER_WHEEL * const wheel, ESM_TW_NODE * const node)
+{
+    uintmax_t expire, delta;
+    size_t level;
+    unsigned index;
+
+    assert((wheel != NULL) && (node != NULL));
+
+    expire = to_utick(node->expire_time);
+    delta = (expire - wheel->current_tick) & TICK_MASK;
+
+    if (delta > TICK_HALF) {
+        /* Already expired: collect at the next esm_tw_Advance() call. */
+        list_Append(&wheel->overdue, node);
+        return;
+    }
+
+    for (level = 0; level < ESM_TW_LEVELS - 1; level++) {
+        if ((delta >> ((level + 1) * ESM_TW_LEVEL_BITS)) == 0) {
+            break;
+        }
+    }
+    index = (unsigned) ((expire >> (level * ESM_TW_LEVEL_BITS)) & SLOT_MASK);
+
+    list_Append(&wheel->slots[level][index], node);
+    wheel->occupied[level] |= (uint32_t) 1 << index;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Find the first non-empty slot of the level.
+ *
+ * @param[in,out] wheel     Timing wheel.
+ * @param[in]     level     Level of the wheel.
+ * @param[out]    distance  Ticks until the slot is processed.
+ *
+ * @retval !=NULL  Slot (list head).
+ * @retval   NULL  All slots of the level are empty.
+ */
+/* ====================================================================== */
+static ESM_TW_NODE *
+find_next_slot(ESM_TIMER_WHEEL * const wheel,
+               const size_t level,
+               uintmax_t * const distance)
+{
+    const unsigned shift = (unsigned) (level * ESM_TW_LEVEL_BITS);
+    uintmax_t base;
+    unsigned start;
+
+    assert((wheel != NULL) && (level < ESM_TW_LEVELS) && (distance != NULL));
+
+    /* The first slot boundary at or after the current tick. */
+    base = wheel->current_tick >> shift;
+    if ((wheel->current_tick & (((uintmax_t) 1 << shift) - 1)) != 0) {
+        base++;
+    }
+    start = (unsigned) (base & SLOT_MASK);
+
+    for (;;) {
+        uint32_t bits, rotated;
+        unsigned k, index;
+        ESM_TW_NODE *head;
+
+        bits = wheel->occupied[level];
+        if (bits == 0) {
+            return NULL;
+        }
+
+        rotated = ((bits >> start) | (bits << (ESM_TW_SLOTS - start))) & OCCUPIED_MASK;
+        k = count_trailing_zeros(rotated);
+        index = (start + k) & SLOT_MASK;
+
+        head = &wheel->slots[level][index];
+        if (list_IsEmpty(head)) {
+            /* Nodes were removed: clear the bit lazily. */
+            wheel->occupied[level] &= ~((uint32_t) 1 << index);
+            continue;
+        }
+
+        *distance = (((base + k) << shift) - wheel->current_tick) & TICK_MASK;
+        return head;
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Cascade the higher level slots at the current tick.
+ *
+ * @param[in,out] wheel  Timing wheel.
+ */
+/* ====================================================================== */
+static void
+cascade(ESM_TIMER_WHEEL * const wheel)
+{
+    size_t level;
+
+    assert(wheel != NULL);
+
+    for (level = 1; level < ESM_TW_LEVELS; level++) {
+        const unsigned shift = (unsigned) (level * ESM_TW_LEVEL_BITS);
+        unsigned index;
+        ESM_TW_NODE *head, *node, *next_node;
+
+        if ((wheel->current_tick & (((uintmax_t) 1 << shift) - 1)) != 0) {
+            break;
+        }
+
+        index = (unsigned) ((wheel->current_tick >> shift) & SLOT_MASK);
+        head = &wheel->slots[level][index];
+        wheel->occupied[level] &= ~((uint32_t) 1 << index);
+
+        if (list_IsEmpty(head)) {
+            continue;
+        }
+
+        node = head->next;
+        head->prev->next = NULL;
+        list_Initialize(head);
+
+        for (; node != NULL; node = next_node) {
+            next_node = node->next;
+            insert_node(wheel, node);
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Sort the expired list in ascending order of the address.
+ *
+ * @param[in,out] wheel  Timing wheel.
+ *
+ * @note  Bottom-up merge sort for the linked list (stable, no extra memory).
+ */
+/* ====================================================================== */
+static void
+sort_expired(ESM_TIMER_WHEEL * const wheel)
+{
+    ESM_TW_NODE * const head = &wheel->expired;
+    ESM_TW_NODE *list, *p, *q, *e, *tail;
+    size_t insize, nmerges, psize, qsize, i;
+
+    assert(wheel != NULL);
+
+    for (p = head->next; p->next != head; p = p->next) {
+        if (p > p->next) {
+            break;
+        }
+    }
+    if (p->next == head) {
+        /* Already sorted (or less than 2 nodes). */
+        return;
+    }
+
+    head->prev->next = NULL;
+    list = head->next;
+
+    for (insize = 1; ; insize *= 2) {
+        p = list;
+        list = NULL;
+        tail = NULL;
+        nmerges = 0;
+
+        while (p != NULL) {
+            nmerges++;
+            q = p;
+            psize = 0;
+            for (i = 0; i < insize; i++) {
+                psize++;
+                q = q->next;
+                if (q == NULL) {
+                    break;
+                }
+            }
+            qsize = insize;
+
+            while ((psize > 0) || ((qsize > 0) && (q != NULL))) {
+                if ((psize > 0) &&
+                    ((qsize == 0) || (q == NULL) || (p < q)))
+                {
+                    e = p;
+                    p = p->next;
+                    psize--;
+                } else {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                }
+
+                if (tail == NULL) {
+                    list = e;
+                } else {
+                    tail->next = e;
+                }
+                tail = e;
+            }
+
+            p = q;
+        }
+        tail->next = NULL;
+
+        if (nmerges <= 1) {
+            break;
+        }
+    }
+
+    list_Initialize(head);
+    for (e = list; e != NULL; e = p) {
+        p = e->next;
+        list_Append(head, e);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timing wheel.
+ *
+ * @param[out] wheel         Timing wheel.
+ * @param[in]  current_time  Current system tick.
+ */
+/* ********************************************************************** */
+void
+esm_tw_Initialize(ESM_TIMER_WHEEL * const wheel,
+                  const ESM_SYS_TICK current_time)
+{
+    size_t level, index;
+
+    assert(wheel != NULL);
+
+    wheel->current_tick = to_utick(current_time);
+
+    for (level = 0; level < ESM_TW_LEVELS; level++) {
+        wheel->occupied[level] = 0;
+        for (index = 0; index < ESM_TW_SLOTS; index++) {
+            list_Initialize(&wheel->slots[level][index]);
+        }
+    }
+
+    list_Initialize(&wheel->overdue);
+    list_Initialize(&wheel->expired);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timing wheel node.
+ *
+ * @param[out] node  Timing wheel node.
+ */
+/* ********************************************************************** */
+void
+esm_tw_InitializeNode(ESM_TW_NODE * const node)
+{
+    assert(node != NULL);
+
+    node->next = NULL;
+    node->prev = NULL;
+    node->expire_time = 0;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if the node is linked to the timing wheel.
+ *
+ * @param[in] node  Timing wheel node.
+ *
+ * @retval true   Linked (armed or expired but not popped yet).
+ * @retval false  Not linked.
+ */
+/* ********************************************************************** */
+bool
+esm_tw_IsLinked(const ESM_TW_NODE * const node)
+{
+    assert(node != NULL);
+
+    return node->next != NULL;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Link the node to the timing wheel.
+ *
+ * @param[in,out] wheel        Timing wheel.
+ * @param[in,out] node         Timing wheel node (must not be linked).
+ * @param[in]     expire_time  Expiration time.
+ *
+ * @note  O(1).
+ */
+/* ********************************************************************** */
+void
+esm_tw_Insert(ESM_TIMER_WHEEL * const wheel,
+              ESM_TW_NODE * const node,
+              const ESM_SYS_TICK expire_time)
+{
+    assert((wheel != NULL) && (node != NULL) && !esm_tw_IsLinked(node));
+
+    node->expire_time = expire_time;
+    insert_node(wheel, node);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Unlink the node from the timing wheel.
+ *
+ * @param[in,out] node  Timing wheel node.
+ *
+ * @note  O(1). It is safe to call this function for the unlinked node.
+ */
+/* ********************************************************************** */
+void
+esm_tw_Remove(ESM_TW_NODE * const node)
+{
+    assert(node != NULL);
+
+    if (!esm_tw_IsLinked(node)) {
+        return;
+    }
+
+    /* The bit of the slot will be cleared lazily. */
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Advance the timing wheel and collect expired nodes.
+ *
+ * @param[in,out] wheel         Timing wheel.
+ * @param[in]     current_time  Current system tick.
+ *
+ * @note  Empty slots are skipped, so the cost depends on the number of
+ *        expired (and cascaded) nodes, not on the elapsed time.
+ */
+/* ********************************************************************** */
+void
+esm_tw_Advance(ESM_TIMER_WHEEL * const wheel,
+               const ESM_SYS_TICK current_time)
+{
+    const uintmax_t target = to_utick(current_time);
+
+    assert(wheel != NULL);
+
+    list_Splice(&wheel->expired, &wheel->overdue);
+
+    for (;;) {
+        uintmax_t remain, distance, next_distance;
+        bool found;
+        size_t level;
+        unsigned index;
+
+        remain = (target - wheel->current_tick) & TICK_MASK;
+        if (remain > TICK_HALF) {
+            /* All ticks until the current time have been processed. */
+            break;
+        }
+
+        found = false;
+        next_distance = 0;
+        for (level = 0; level < ESM_TW_LEVELS; level++) {
+            if (find_next_slot(wheel, level, &distance) == NULL) {
+                continue;
+            }
+            if (!found || (distance < next_distance)) {
+                next_distance = distance;
+                found = true;
+            }
+        }
+
+        if (!found || (next_distance > remain)) {
+            wheel->current_tick = (target + 1) & TICK_MASK;
+            break;
+        }
+
+        wheel->current_tick = (wheel->current_tick + next_distance) & TICK_MASK;
+        cascade(wheel);
+
+        index = (unsigned) (wheel->current_tick & SLOT_MASK);
+        list_Splice(&wheel->expired, &wheel->slots[0][index]);
+        wheel->occupied[0] &= ~((uint32_t) 1 << index);
+
+        wheel->current_tick = (wheel->current_tick + 1) & TICK_MASK;
+    }
+
+    sort_expired(wheel);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the earliest expiration time of the linked nodes.
+ *
+ * @param[in,out] wheel        Timing wheel.
+ * @param[out]    expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No node is linked.
+ *
+ * @note  Only the first non-empty slot of each level is scanned.
+ */
+/* ********************************************************************** */
+bool
+esm_tw_GetNextExpireTime(ESM_TIMER_WHEEL * const wheel,
+                         ESM_SYS_TICK * const expire_time)
+{
+    const ESM_TW_NODE *earliest;
+    uintmax_t earliest_delta, distance;
+    size_t level;
+
+    assert((wheel != NULL) && (expire_time != NULL));
+
+    /* Nodes already expired: they will be collected immediately. */
+    if (!list_IsEmpty(&wheel->expired)) {
+        *expire_time = wheel->expired.next->expire_time;
+        return true;
+    }
+    if (!list_IsEmpty(&wheel->overdue)) {
+        *expire_time = wheel->overdue.next->expire_time;
+        return true;
+    }
+
+    earliest = NULL;
+    earliest_delta = 0;
+
+    /*
+     * The node of the higher level may expire earlier than the node of the
+     * lower level, so check the first non-empty slot of all levels.
+     */
+    for (level = 0; level < ESM_TW_LEVELS; level++) {
+        const ESM_TW_NODE *head, *node;
+
+        head = find_next_slot(wheel, level, &distance);
+        if (head == NULL) {
+            continue;
+        }
+        if ((earliest != NULL) && (distance >= earliest_delta)) {
+            /* All nodes in the slot expire at or after the slot boundary. */
+            continue;
+        }
+
+        for (node = head->next; node != head; node = node->next) {
+            uintmax_t delta;
+
+            delta = (to_utick(node->expire_time) - wheel->current_tick) & TICK_MASK;
+            if ((earliest == NULL) || (delta < earliest_delta)) {
+                earliest = node;
+                earliest_delta = delta;
+            }
+        }
+    }
+
+    if (earliest == NULL) {
+        return false;
+    }
+
+    *expire_time = earliest->expire_time;
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop the expired node (in ascending order of the address).
+ *
+ * @param[in,out] wheel  Timing wheel.
+ *
+ * @retval !=NULL  Expired node.
+ * @retval   NULL  No more expired node.
+ */
+/* ********************************************************************** */
+ESM_TW_NODE *
+esm_tw_PopExpired(ESM_TIMER_WHEEL * const wheel)
+{
+    ESM_TW_NODE *node;
+
+    assert(wheel != NULL);
+
+    if (list_IsEmpty(&wheel->expired)) {
+        return NULL;
+    }
+
+    node = wheel->expired.next;
+    esm_tw_Remove(node);
+
+    return node;
+}
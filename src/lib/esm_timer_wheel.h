@@ -0,0 +1,179 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: hierarchical timing wheel interfaces.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_TIMER_WHEEL_H_INCLUDED
+#define ESM_TIMER_WHEEL_H_INCLUDED
+
+#include "esm_private.h"
+
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of bits per wheel level. */
+#define ESM_TW_LEVEL_BITS 4
+
+/** Number of slots per wheel level. */
+#define ESM_TW_SLOTS (1 << ESM_TW_LEVEL_BITS)
+
+/** Number of wheel levels (covers the whole range of the system tick). */
+#define ESM_TW_LEVELS \
+    ((sizeof(ESM_SYS_TICK) * 8 + ESM_TW_LEVEL_BITS - 1) / ESM_TW_LEVEL_BITS)
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/** Timing wheel node type (embed this into the timer cell). */
+typedef struct ESM_TW_NODE ESM_TW_NODE;
+/** Timing wheel node type (embed this into the timer cell). */
+struct ESM_TW_NODE {
+    ESM_TW_NODE *next;
+    ESM_TW_NODE *prev;
+    ESM_SYS_TICK expire_time;
+};
+
+/** Timing wheel type. */
+typedef struct {
+    /* Next tick to process. */
+    uintmax_t current_tick;
+
+    /* Bitmaps of (possibly) non-empty slots, one per level. */
+    uint32_t occupied[ESM_TW_LEVELS];
+    ESM_TW_NODE slots[ESM_TW_LEVELS][ESM_TW_SLOTS];
+
+    /* Nodes already expired when they were linked. */
+    ESM_TW_NODE overdue;
+
+    /* Expired nodes, sorted by address (i.e. by timer ID). */
+    ESM_TW_NODE expired;
+} ESM_TIMER_WHEEL;
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* def __cplusplus */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timing wheel.
+ *
+ * @param[out] wheel         Timing wheel.
+ * @param[in]  current_time  Current system tick.
+ */
+/* ********************************************************************** */
+extern void
+esm_tw_Initialize(ESM_TIMER_WHEEL * const wheel,
+                  const ESM_SYS_TICK current_time);
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the timing wheel node.
+ *
+ * @param[out] node  Timing wheel node.
+ */
+/* ********************************************************************** */
+extern void
+esm_tw_InitializeNode(ESM_TW_NODE * const node);
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if the node is linked to the timing wheel.
+ *
+ * @param[in] node  Timing wheel node.
+ *
+ * @retval true   Linked (armed or expired but not popped yet).
+ * @retval false  Not linked.
+ */
+/* ********************************************************************** */
+extern bool
+esm_tw_IsLinked(const ESM_TW_NODE * const node);
+
+/* ********************************************************************** */
+/**
+ * @brief  Link the node to the timing wheel.
+ *
+ * @param[in,out] wheel        Timing wheel.
+ * @param[in,out] node         Timing wheel node (must not be linked).
+ * @param[in]     expire_time  Expiration time.
+ *
+ * @note  O(1).
+ */
+/* ********************************************************************** */
+extern void
+esm_tw_Insert(ESM_TIMER_WHEEL * const wheel,
+              ESM_TW_NODE * const node,
+              const ESM_SYS_TICK expire_time);
+
+/* ********************************************************************** */
+/**
+ * @brief  Unlink the node from the timing wheel.
+ *
+ * @param[in,out] node  Timing wheel node.
+ *
+ * @note  O(1). It is safe to call this function for the unlinked node.
+ */
+/* ********************************************************************** */
+extern void
+esm_tw_Remove(ESM_TW_NODE * const node);
+
+/* ********************************************************************** */
+/**
+ * @brief  Advance the timing wheel and collect expired nodes.
+ *
+ * @param[in,out] wheel         Timing wheel.
+ * @param[in]     current_time  Current system tick.
+ *
+ * @note  Empty slots are skipped, so the cost depends on the number of
+ *        expired (and cascaded) nodes, not on the elapsed time.
+ */
+/* ********************************************************************** */
+extern void
+esm_tw_Advance(ESM_TIMER_WHEEL * const wheel,
+               const ESM_SYS_TICK current_time);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the earliest expiration time of the linked nodes.
+ *
+ * @param[in,out] wheel        Timing wheel.
+ * @param[out]    expire_time  Earliest expiration time.
+ *
+ * @retval true   Exit success.
+ * @retval false  No node is linked.
+ *
+ * @note  Only the first non-empty slot of each level is scanned.
+ */
+/* ********************************************************************** */
+extern bool
+esm_tw_GetNextExpireTime(ESM_TIMER_WHEEL * const wheel,
+                         ESM_SYS_TICK * const expire_time);
+
+/* ********************************************************************** */
+/**
+ * @brief  Pop the expired node (in ascending order of the address).
+ *
+ * @param[in,out] wheel  Timing wheel.
+ *
+ * @retval !=NULL  Expired node.
+ * @retval   NULL  No more expired node.
+ */
+/* ********************************************************************** */
+extern ESM_TW_NODE *
+esm_tw_PopExpired(ESM_TIMER_WHEEL * const wheel);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* def __cplusplus */
+
+#endif /* ndef ESM_TIMER_WHEEL_H_INCLUDED */
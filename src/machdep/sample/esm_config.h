@@ -19,19 +19,259 @@
 /** Maximum number of global timers. */
 #define ESM_CFG_MAX_GLOBAL_TIMER 8
 
+/** Maximum number of timer handles (see esm_CreateTimer()). */
+#define ESM_CFG_MAX_TIMER_HANDLE 8
+
 #if 0
 /** Use C standard library's assert.h (for debug on hosted environment). */
 #define ESM_CFG_USE_ASSERT_H
 #endif
 
+#if 0
+/**
+ * Use hierarchical timing wheels for timers and global timers.
+ * Start/stop is O(1) and esm_ResumeAndYield() only touches expired timers,
+ * so it is suitable for large ESM_CFG_MAX_TIMER/ESM_CFG_MAX_GLOBAL_TIMER/
+ * ESM_CFG_MAX_TIMER_HANDLE.
+ * Note that the timer started in the timer handler is not dispatched
+ * until the next esm_ResumeAndYield() call.
+ */
+#define ESM_CFG_USE_TIMER_WHEEL
+#endif
+
+#if 0
+/**
+ * Use structure-of-arrays timer tables for timers and global timers.
+ * Expiration times are kept in contiguous arrays with active bitmaps and
+ * compared in bulk (SSE2/AVX2 if the compiler targets them), so it is
+ * suitable for large flat timer arrays.
+ * Cannot be used with ESM_CFG_USE_TIMER_WHEEL.
+ */
+#define ESM_CFG_USE_TIMER_SOA
+#endif
+
+#if 0
+/** Use the portable scalar kernel for ESM_CFG_USE_TIMER_SOA. */
+#define ESM_CFG_TIMER_SOA_NO_SIMD
+#endif
+
+#if 0
+/**
+ * Read the system tick only once per esm_ResumeAndYield() call, and share
+ * it between the timer processing and the timer APIs called from the
+ * handlers. Timers started in the handlers are measured from the
+ * beginning of the iteration.
+ */
+#define ESM_CFG_USE_LOOP_TIME
+#endif
+
+#if 0
+/**
+ * Record the lateness of the expired timers (current time minus expiration
+ * time) in log-scale histograms (see esm_GetTimerLateness()).
+ */
+#define ESM_CFG_USE_TIMER_LATENESS
+#endif
+
+#if 0
+/**
+ * Use the lock-free multi-producer/single-consumer message queue.
+ * The main loop takes and releases the messages without
+ * esm_md_LockForAPI(). The machdep library must provide the atomic
+ * operations (esm_md_LoadMessageCell(), etc.), and
+ * esm_md_DeallocMessageCell() must be thread-safe.
+ */
+#define ESM_CFG_USE_MPSC_QUEUE
+#endif
+
+#if 0
+/**
+ * Size of the inline message payload in bytes (see esm_PostMessageData()).
+ * Each message cell has a payload area of this size, so the small data
+ * can be posted without the allocation of user_data.
+ */
+#define ESM_CFG_MESSAGE_PAYLOAD_SIZE 48
+#endif
+
+#if 0
+/**
+ * Number of the message producers (see esm_CreateProducer()).
+ * Each producer has its own lock-free single-producer/single-consumer
+ * message queue, and the main loop drains the queues in round-robin.
+ * The machdep library must provide esm_md_LoadSize() and
+ * esm_md_StoreSize().
+ */
+#define ESM_CFG_MESSAGE_SHARDS 8
+
+/** Number of messages per producer's queue (power of two, default: 64). */
+#define ESM_CFG_MESSAGE_SHARD_SIZE 64
+
+/** Number of messages processed from one producer in a row (default: 8). */
+#define ESM_CFG_MESSAGE_SHARD_BUDGET 8
+#endif
+
+#if 0
+/**
+ * Number of the message priorities (1 to 32, see esm_PostPriorityMessage()).
+ * The main loop selects the highest non-empty priority with a bitmap.
+ * The sample machdep library also has an event queue (of
+ * ESM_CFG_EVENT_QUEUE_SIZE) per priority (see esm_md_PostPriorityEvent()).
+ * Exclusive with ESM_CFG_USE_MPSC_QUEUE.
+ */
+#define ESM_CFG_PRIORITIES 4
+
+/**
+ * Anti-starvation aging: every N-th selection serves the non-empty
+ * priorities in round-robin, so the low priorities still drain
+ * (default: undefined, strict priority).
+ */
+#define ESM_CFG_PRIORITY_AGING 8
+#endif
+
+#if 0
+/**
+ * Use the backpressure of the message queue (see
+ * esm_SetMessageQueuePolicy()): the high/low water mark callbacks, the
+ * overflow policies and the statistics. The machdep library must provide
+ * esm_md_WaitForSpace() and esm_md_NotifySpace() for ESM_OVERFLOW_BLOCK.
+ * With ESM_CFG_USE_MPSC_QUEUE, the main loop takes esm_md_LockForAPI() once
+ * per message to count it.
+ */
+#define ESM_CFG_USE_BACKPRESSURE
+#endif
+
+#if 0
+/**
+ * Use esm_Invoke() (post the message and wait until the main loop processes
+ * it). The machdep library must provide esm_md_WaitForCompletion() and
+ * esm_md_NotifyCompletion(). With ESM_CFG_USE_MPSC_QUEUE, the main loop
+ * takes esm_md_LockForAPI() once per message to complete it.
+ */
+#define ESM_CFG_USE_INVOKE
+#endif
+
+#if 0
+/**
+ * Maximum number of events processed per esm_ResumeAndYield() call
+ * (default: 1, or unlimited if ESM_CFG_EVENT_TIME_BUDGET_USEC is defined).
+ * The event handler is switched between the events.
+ */
+#define ESM_CFG_EVENT_BUDGET 16
+#endif
+
+#if 0
+/**
+ * Time budget of the events per esm_ResumeAndYield() call (in
+ * microseconds). The remaining events wait for the next call even if
+ * ESM_CFG_EVENT_BUDGET is not used up. In millisecond tick mode the budget
+ * is measured in whole ticks, and may be exceeded by up to one tick.
+ */
+#define ESM_CFG_EVENT_TIME_BUDGET_USEC 1000
+#endif
+
+#if 0
+/**
+ * Use the event records (event ID with the payload, see ESM_EVENT_RECORD)
+ * instead of the event IDs: the library gets the events with
+ * esm_md_PeekEventRecord(), and calls ESM_EVENT_HANDLER::on_event_record
+ * if it is set. The machdep library must provide esm_md_PeekEventRecord().
+ */
+#define ESM_CFG_USE_EVENT_RECORD
+#endif
+
+#if 0
+/**
+ * Peek the events in batches with esm_md_PeekEvents() (up to
+ * ESM_CFG_EVENT_BUDGET per esm_ResumeAndYield() call), and pass each run
+ * to ESM_EVENT_HANDLER::on_events if it is set. The machdep library must
+ * provide esm_md_PeekEvents(). Exclusive with ESM_CFG_USE_EVENT_RECORD.
+ */
+#define ESM_CFG_USE_EVENT_BATCH
+#endif
+
+#if 0
+/** Maximum number of events peeked at once (default: 16). */
+#define ESM_CFG_EVENT_BATCH_SIZE 16
+#endif
+
+#if 0
+/**
+ * Maximum number of the deferred events (see esm_DeferEvent()). The ring
+ * is allocated in the module context.
+ */
+#define ESM_CFG_MAX_DEFERRED_EVENTS 16
+#endif
+
+#if 0
+/**
+ * Use the microsecond system tick (esm_md_GetTickUsec()) as the time base
+ * of the timers. Timers of sub-millisecond resolution are available via
+ * esm_XxxUsec() APIs, and the millisecond APIs still work.
+ * With 64 bit ESM_SYS_TICK_USEC, the system tick never wraps around
+ * in practice.
+ */
+#define ESM_CFG_USE_TICK_USEC
+#endif
+
 /* ---------------------------------------------------------------------- */
 /* Configurations for the machdep library (for sample code only) */
 /* ---------------------------------------------------------------------- */
 
-/** Maximum number of messages. */
+/** Maximum number of messages (initial number if ESM_CFG_MESSAGE_SLAB_SIZE is defined). */
 #define ESM_CFG_MAX_MESSAGE 16
 
-/** Maximum size of event queue. */
+#if 0
+/**
+ * Grow the message cell pool by slabs of this number of cells when the
+ * cells run out, and release the free slabs when the main loop becomes
+ * idle (for sample/console only).
+ */
+#define ESM_CFG_MESSAGE_SLAB_SIZE 16
+#endif
+
+#if 0
+/** Maximum number of slabs of ESM_CFG_MESSAGE_SLAB_SIZE (unlimited if not defined). */
+#define ESM_CFG_MAX_MESSAGE_SLAB 64
+#endif
+
+#if 0
+/**
+ * Minimum interval of the release of the free slabs (in milliseconds,
+ * default: 1000). The slabs are also kept for this time after the growth.
+ */
+#define ESM_CFG_MESSAGE_SLAB_SHRINK_MSEC 1000
+#endif
+
+/** Maximum size of event queue (power of two). */
 #define ESM_CFG_EVENT_QUEUE_SIZE 32
 
+#if 0
+/**
+ * Coalesce the events at enqueue time (sample machdep only): the event IDs
+ * 0 to N-1 can be made coalescable with esm_md_SetEventCoalescing(), and a
+ * coalescable event is queued at most once per priority while pending.
+ */
+#define ESM_CFG_COALESCE_EVENTS 64
+#endif
+
+/*
+ * Clock source of esm_md_GetTick() and esm_md_GetTickUsec() (for
+ * sample/console only). Define one of them, or std::chrono::steady_clock
+ * is used.
+ */
+#if 0
+/** POSIX clock_gettime(CLOCK_MONOTONIC). */
+#define ESM_CFG_CLOCK_MONOTONIC
+#endif
+
+#if 0
+/** Linux clock_gettime(CLOCK_MONOTONIC_COARSE) (fast, but jiffy resolution). */
+#define ESM_CFG_CLOCK_MONOTONIC_COARSE
+#endif
+
+#if 0
+/** x86 TSC calibrated against steady_clock (requires invariant TSC). */
+#define ESM_CFG_CLOCK_TSC
+#endif
+
 #endif /* ndef ESM_CONFIG_H_INCLUDED */
@@ -3,13 +3,32 @@
  * @brief   ESM: machdep implementation (sample code).
  * @author  eel3
  * @date    2017-10-18
+ *
+ * The event queue is a power-of-two SPSC ring. The producer (e.g. an ISR)
+ * writes the slots and then publishes the tail (release), and the main loop
+ * reads the tail (acquire), copies the slots and then publishes the head
+ * (release). C11 atomics are used if available, otherwise esm_md_LoadSize()
+ * and esm_md_StoreSize() (implement them for the target).
+ *
+ * The other shared states are derived from the indices, or split into the
+ * counters written by only one side, so no read-modify-write is shared.
  */
 /* ********************************************************************** */
 
 #include "esm_md.h"
 #include "esm_md_eq.h"
+#include "esm_message_pool.h"
+#ifdef ESM_CFG_PRIORITIES
+#include "esm_priority.h"
+#endif
 
 #include <stddef.h>
+#include <stdint.h>
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#define EQ_USE_STDATOMIC
+#include <stdatomic.h>
+#endif
 
 #ifdef ESM_CFG_USE_ASSERT_H
 #include <assert.h>
@@ -17,15 +36,77 @@
 #define assert(cond)
 #endif
 
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Assumed cache line size (to keep the producer and consumer sides apart). */
+#define EQ_CACHE_LINE_SIZE 64
+
+#if (ESM_CFG_EVENT_QUEUE_SIZE & (ESM_CFG_EVENT_QUEUE_SIZE - 1)) != 0
+#error "ESM_CFG_EVENT_QUEUE_SIZE must be a power of two."
+#endif
+
+/** Priority of the events posted by esm_md_PostEvent() (the lowest). */
+#ifdef ESM_CFG_PRIORITIES
+#define LOWEST_PRIORITY ((ESM_PRIORITY) (ESM_CFG_PRIORITIES - 1))
+#else
+#define LOWEST_PRIORITY ((ESM_PRIORITY) 0)
+#endif
+
+/** Number of events copied at once (by esm_md_PostEvents(), etc.). */
+#define EVENT_CHUNK_SIZE 16
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+#if ESM_CFG_COALESCE_EVENTS < 1
+#error "ESM_CFG_COALESCE_EVENTS must be 1 or more."
+#endif
+
+/** Number of words of the event flags (bitmap of ESM_CFG_COALESCE_EVENTS). */
+#define EVENT_FLAG_WORDS ((ESM_CFG_COALESCE_EVENTS + 31) / 32)
+
+/** Number of the event queues (one per priority). */
+#ifdef ESM_CFG_PRIORITIES
+#define EVENT_LANES ESM_CFG_PRIORITIES
+#else
+#define EVENT_LANES 1
+#endif
+#endif
+
 /* ---------------------------------------------------------------------- */
 /* Data structures */
 /* ---------------------------------------------------------------------- */
 
-/** Event queue type. */
+/** Event queue element type. */
+#ifdef ESM_CFG_USE_EVENT_RECORD
+typedef ESM_EVENT_RECORD EVENT_ENTRY;
+#else
+typedef ESM_EVENT_ID EVENT_ENTRY;
+#endif
+
+/** Event queue index type (free-running). */
+#ifdef EQ_USE_STDATOMIC
+typedef atomic_size_t EQ_INDEX;
+#else
+typedef size_t EQ_INDEX;
+#endif
+
+/**
+ * Event queue type (SPSC ring).
+ * The indices run freely, and are masked by ESM_CFG_EVENT_QUEUE_SIZE.
+ */
 typedef struct {
-    ESM_EVENT_ID buf[ESM_CFG_EVENT_QUEUE_SIZE + 1];
-    size_t rp;
-    size_t wp;
+    /* Next index to push (updated by the producer). */
+    EQ_INDEX tail;
+
+    char padding[EQ_CACHE_LINE_SIZE];
+
+    /* Next index to pop (updated by the consumer). */
+    EQ_INDEX head;
+
+    char padding2[EQ_CACHE_LINE_SIZE];
+
+    EVENT_ENTRY buf[ESM_CFG_EVENT_QUEUE_SIZE];
 } EVENT_QUEUE;
 
 /** Module context type. */
@@ -33,8 +114,34 @@ typedef struct {
     bool initialized;
     bool prepared;
     ESM_MESSAGE_CELL messages[ESM_CFG_MAX_MESSAGE];
+    ESM_MESSAGE_POOL pool;
 
+#ifdef ESM_CFG_PRIORITIES
+    /* Event queue per priority (the selector is owned by the consumer). */
+    EVENT_QUEUE queues[ESM_CFG_PRIORITIES];
+    ESM_PRIORITY_SET lanes;
+#else
     EVENT_QUEUE queue;
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    /* Backpressure of the event queue (see esm_md_SetEventQueuePolicy()). */
+    ESM_QUEUE_POLICY event_policy;
+    ESM_QUEUE_STATS event_stats;
+
+    /* Above the high water mark while the counts differ. */
+    EQ_INDEX high_water_signals;    /* Written by the producer. */
+    EQ_INDEX low_water_signals;     /* Written by the consumer. */
+#endif
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+    /* Event coalescing (see esm_md_SetEventCoalescing()). */
+    uint32_t coalescable[EVENT_FLAG_WORDS];
+    /* Pending while the counts differ (per priority and event ID). */
+    EQ_INDEX posted_events[EVENT_LANES][ESM_CFG_COALESCE_EVENTS];  /* Written by the producer. */
+    EQ_INDEX taken_events[EVENT_LANES][ESM_CFG_COALESCE_EVENTS];   /* Written by the consumer. */
+    uint32_t merged;
+#endif
 } MODULE_CTX;
 
 /* ---------------------------------------------------------------------- */
@@ -65,15 +172,52 @@ static MODULE_CTX module_ctx;
 
 /* ====================================================================== */
 /**
- * @brief  Return a next index.
+ * @brief  Return the slot of the index.
  *
  * @param[in] q  Event queue.
- * @param[in] i  Current index.
+ * @param[in] i  Free-running index.
+ *
+ * @return  Slot (EVENT_ENTRY).
+ */
+/* ====================================================================== */
+#define eq_Slot(q, i) ((q)->buf[(i) & (ESM_CFG_EVENT_QUEUE_SIZE - 1)])
+
+/* ====================================================================== */
+/**
+ * @brief  Atomically load the index (acquire).
+ *
+ * @param[in] index  Index.
  *
- * @return  The next index.
+ * @return  Value of the index.
  */
 /* ====================================================================== */
-#define eq_NextIndex(q, i) (((i) + 1) % NELEMS((q)->buf))
+static size_t
+eq_LoadIndex(const EQ_INDEX * const index)
+{
+#ifdef EQ_USE_STDATOMIC
+    return atomic_load_explicit(index, memory_order_acquire);
+#else
+    return esm_md_LoadSize(index);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Atomically store the index (release).
+ *
+ * @param[out] index  Index.
+ * @param[in]  value  Value to store.
+ */
+/* ====================================================================== */
+static void
+eq_StoreIndex(EQ_INDEX * const index, const size_t value)
+{
+#ifdef EQ_USE_STDATOMIC
+    atomic_store_explicit(index, value, memory_order_release);
+#else
+    esm_md_StoreSize(index, value);
+#endif
+}
 
 /* ====================================================================== */
 /**
@@ -87,261 +231,1454 @@ eq_Initialize(EVENT_QUEUE * const q)
 {
     assert(q != NULL);
 
-    q->rp = q->wp = 0;
+    eq_StoreIndex(&q->tail, 0);
+    eq_StoreIndex(&q->head, 0);
 }
 
 /* ====================================================================== */
 /**
- * @brief  Push data to the event queue.
+ * @brief  Push the data to the event queue as many as possible.
  *
- * @param[in,out] q    Event queue.
- * @param[in]     val  Data.
+ * @param[in,out] q     Event queue.
+ * @param[in]     vals  Data.
+ * @param[in]     n     Number of the data.
  *
- * @retval true   Exit success.
- * @retval false  Exit failure.
+ * @return  Number of the pushed data (the first ones).
+ *
+ * @note  Lock-free. For the producer only.
  */
 /* ====================================================================== */
-static bool
-eq_Push(EVENT_QUEUE * const q, const ESM_EVENT_ID val)
+static size_t
+eq_PushBulk(EVENT_QUEUE * const q, const EVENT_ENTRY * const vals, const size_t n)
 {
-    size_t wp_next;
+    size_t tail, space, i;
 
-    assert(q != NULL);
+    assert((q != NULL) && ((vals != NULL) || (n == 0)));
 
-    wp_next = eq_NextIndex(q, q->wp);
-    if (wp_next == q->rp) {
-        /* Queue is full. */
-        return false;
+    /* The tail is owned by the producer: the load needs no ordering. */
+    tail = eq_LoadIndex(&q->tail);
+
+    space = ESM_CFG_EVENT_QUEUE_SIZE - (tail - eq_LoadIndex(&q->head));
+    if (space > n) {
+        space = n;
     }
 
-    q->buf[q->wp] = val;
-    q->wp = wp_next;
+    for (i = 0; i < space; i++) {
+        eq_Slot(q, tail + i) = vals[i];
+    }
+    eq_StoreIndex(&q->tail, tail + space);
 
-    return true;
+    return space;
 }
 
 /* ====================================================================== */
 /**
- * @brief  Pop data from the event queue.
+ * @brief  Return true if the event queue is empty.
  *
- * @param[in,out] q    Event queue.
- * @param[out]    val  Data output place.
+ * @param[in] q  Event queue.
  *
- * @retval true   Exit success.
- * @retval false  Exit failure.
+ * @retval true   Empty.
+ * @retval false  Not empty.
  */
 /* ====================================================================== */
 static bool
-eq_Pop(EVENT_QUEUE * const q, ESM_EVENT_ID * const val)
+eq_IsEmpty(const EVENT_QUEUE * const q)
 {
-    assert((q != NULL) && (val != NULL));
+    assert(q != NULL);
 
-    if (q->rp == q->wp) {
-        /* Queue is empty. */
-        return false;
-    }
+    return eq_LoadIndex(&q->head) == eq_LoadIndex(&q->tail);
+}
 
-    *val = q->buf[q->rp];
-    q->rp = eq_NextIndex(q, q->rp);
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/* ====================================================================== */
+/**
+ * @brief  Return the number of the data in the event queue.
+ *
+ * @param[in] q  Event queue.
+ *
+ * @return  Number of the data (a snapshot while the other side runs).
+ */
+/* ====================================================================== */
+static size_t
+eq_Count(const EVENT_QUEUE * const q)
+{
+    size_t head, count;
 
-    return true;
-}
+    assert(q != NULL);
 
-/* ---------------------------------------------------------------------- */
-/* Public API Functions: for ESM library */
-/* ---------------------------------------------------------------------- */
+    /* The head first: the tail never falls behind the loaded head. */
+    head = eq_LoadIndex(&q->head);
+    count = eq_LoadIndex(&q->tail) - head;
 
-/* ********************************************************************** */
+    return (count > ESM_CFG_EVENT_QUEUE_SIZE) ? ESM_CFG_EVENT_QUEUE_SIZE : count;
+}
+#endif
+
+/* ====================================================================== */
 /**
- * @brief  Initialize the machdep library.
+ * @brief  Pop the data from the event queue as many as possible.
  *
- * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_RES     No system resources.
- * @retval ESM_E_STATUS  Internal status error.
- * @retval ESM_E_SYS     Error caused by underlying library routines.
+ * @param[in,out] q     Event queue.
+ * @param[out]    vals  Data output place.
+ * @param[in]     n     Maximum number of the data.
  *
- * @note  This function will be called in esm_Initialize().
+ * @return  Number of the popped data (oldest first).
+ *
+ * @note  Lock-free. For the consumer only.
  */
-/* ********************************************************************** */
-ESM_ERR
-esm_md_Initialize(void)
+/* ====================================================================== */
+static size_t
+eq_PopBulk(EVENT_QUEUE * const q, EVENT_ENTRY * const vals, const size_t n)
 {
-    MODULE_CTX * const mc = &module_ctx;
+    size_t head, count, i;
 
-    if (mc->initialized) {
-        return ESM_E_STATUS;
-    }
+    assert((q != NULL) && ((vals != NULL) || (n == 0)));
 
-    mc->prepared = false;
+    /* The head is owned by the consumer: the load needs no ordering. */
+    head = eq_LoadIndex(&q->head);
 
-    mc->initialized = true;
+    count = eq_LoadIndex(&q->tail) - head;
+    if (count > n) {
+        count = n;
+    }
 
-    return ESM_E_OK;
+    for (i = 0; i < count; i++) {
+        vals[i] = eq_Slot(q, head + i);
+    }
+    eq_StoreIndex(&q->head, head + count);
+
+    return count;
 }
 
-/* ********************************************************************** */
+/* ---------------------------------------------------------------------- */
+/* Private functions: event queue element */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
 /**
- * @brief  Finalize the machdep library.
+ * @brief  Make the element of the event ID (without payload).
  *
- * @note  This function will be called in esm_Finalize().
+ * @param[out] entry  Element.
+ * @param[in]  id     Event ID.
  */
-/* ********************************************************************** */
-void
-esm_md_Finalize(void)
+/* ====================================================================== */
+static void
+make_event_entry(EVENT_ENTRY * const entry, const ESM_EVENT_ID id)
 {
-    MODULE_CTX * const mc = &module_ctx;
-
-    if (!mc->initialized) {
-        return;
-    }
+    assert(entry != NULL);
 
-    mc->initialized = false;
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    entry->id = id;
+    entry->size = 0;
+    entry->data = NULL;
+    entry->release_data = NULL;
+#else
+    *entry = id;
+#endif
 }
 
-/* ********************************************************************** */
+/* ====================================================================== */
 /**
- * @brief  Prepare the machdep library before main loop.
+ * @brief  Return the event ID of the element.
  *
- * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_STATUS  Internal status error.
+ * @param[in] entry  Element.
  *
- * @note  This function will be called in esm_PrepareBeforeMainLoop().
+ * @return  Event ID.
  */
-/* ********************************************************************** */
-ESM_ERR
-esm_md_PrepareBeforeMainLoop(void)
+/* ====================================================================== */
+static ESM_EVENT_ID
+get_event_id(const EVENT_ENTRY * const entry)
 {
-    MODULE_CTX * const mc = &module_ctx;
-    size_t i;
+    assert(entry != NULL);
 
-    assert(mc->initialized);
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    return entry->id;
+#else
+    return *entry;
+#endif
+}
 
-    if (mc->prepared) {
-        return ESM_E_STATUS;
-    }
+/* ====================================================================== */
+/**
+ * @brief  Release the payload of the element (not passed to the library).
+ *
+ * @param[in] entry  Element.
+ */
+/* ====================================================================== */
+static void
+release_event_entry(const EVENT_ENTRY * const entry)
+{
+    assert(entry != NULL);
 
-    for (i = 0; i < NELEMS(mc->messages); i++) {
-        mc->messages[i].empty = true;
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    if (entry->release_data != NULL) {
+        entry->release_data(entry->data);
     }
+#else
+    (void) entry;
+#endif
+}
 
-    eq_Initialize(&mc->queue);
+#ifdef ESM_CFG_PRIORITIES
+/* ---------------------------------------------------------------------- */
+/* Private functions: event priority lanes */
+/* ---------------------------------------------------------------------- */
 
-    mc->prepared = true;
+/* ====================================================================== */
+/**
+ * @brief  Initialize the event queues of all priorities.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_event_lanes(MODULE_CTX * const mc)
+{
+    size_t i;
 
-    return ESM_E_OK;
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->queues); i++) {
+        eq_Initialize(&mc->queues[i]);
+    }
+    esm_pr_Initialize(&mc->lanes);
 }
 
-/* ********************************************************************** */
+/* ====================================================================== */
 /**
- * @brief  Cleanup the machdep library after main loop.
+ * @brief  Refresh the priority lane selector from the event queues.
  *
- * @retval ESM_E_OK      Exit success.
- * @retval ESM_E_STATUS  Internal status error.
+ * Only the consumer uses the selector: the producer just publishes the
+ * tail, so a lane is never left unmarked with the events in its queue.
  *
- * @note  This function will be called in esm_CleanupAfterMainLoop().
+ * @param[in,out] mc  Module context.
  */
-/* ********************************************************************** */
-ESM_ERR
-esm_md_CleanupAfterMainLoop(void)
+/* ====================================================================== */
+static void
+refresh_event_lanes(MODULE_CTX * const mc)
 {
-    MODULE_CTX * const mc = &module_ctx;
+    size_t i;
 
-    assert(mc->initialized);
+    assert(mc != NULL);
 
-    if (!mc->prepared) {
-        return ESM_E_STATUS;
+    for (i = 0; i < NELEMS(mc->queues); i++) {
+        if (eq_IsEmpty(&mc->queues[i])) {
+            esm_pr_Unmark(&mc->lanes, (ESM_PRIORITY) i);
+        } else {
+            esm_pr_Mark(&mc->lanes, (ESM_PRIORITY) i);
+        }
     }
-
-    mc->prepared = false;
-
-    return ESM_E_OK;
 }
 
-/* ********************************************************************** */
+/* ====================================================================== */
 /**
- * @brief  Allocate memory space for ESM_MESSAGE_CELL type.
+ * @brief  Return true if the event queue of any priority is not empty.
  *
- * @retval !=NULL  Exit success.
- * @retval   NULL  Exit failure.
+ * @param[in] mc  Module context.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
  */
-/* ********************************************************************** */
-ESM_MESSAGE_CELL *
-esm_md_AllocMessageCell(void)
+/* ====================================================================== */
+static bool
+has_lane_events(const MODULE_CTX * const mc)
 {
-    MODULE_CTX * const mc = &module_ctx;
     size_t i;
 
-    assert(mc->initialized);
-
-    for (i = 0; i < NELEMS(mc->messages); i++) {
-        ESM_MESSAGE_CELL *cell;
+    assert(mc != NULL);
 
-        cell = &mc->messages[i];
-        if (cell->empty) {
-            cell->empty = false;
-            return cell;
+    for (i = 0; i < NELEMS(mc->queues); i++) {
+        if (!eq_IsEmpty(&mc->queues[i])) {
+            return true;
         }
     }
 
-    return NULL;
+    return false;
 }
 
-/* ********************************************************************** */
+/* ====================================================================== */
 /**
- * @brief  Deallocate memory space for ESM_MESSAGE_CELL type.
+ * @brief  Pop the events of the highest priority.
  *
- * @param[in,out] cell  Memory space to deallocate.
+ * @param[in,out] mc        Module context.
+ * @param[out]    entries   Events output place.
+ * @param[in]     n         Maximum number of the events.
+ * @param[out]    priority  Priority of the popped events.
+ *
+ * @return  Number of the popped events (0: no event).
  */
-/* ********************************************************************** */
-void
-esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell)
+/* ====================================================================== */
+static size_t
+pop_events(MODULE_CTX * const mc,
+           EVENT_ENTRY * const entries,
+           const size_t n,
+           ESM_PRIORITY * const priority)
 {
-    assert(module_ctx.initialized);
+    assert((mc != NULL) && (priority != NULL));
+
+    refresh_event_lanes(mc);
+    if (esm_pr_IsEmpty(&mc->lanes)) {
+        return 0;
+    }
+
+    *priority = esm_pr_Select(&mc->lanes);
 
-    cell->empty = true;
+    return eq_PopBulk(&mc->queues[*priority], entries, n);
 }
+#endif
 
-/* ********************************************************************** */
+#ifdef ESM_CFG_COALESCE_EVENTS
+/* ---------------------------------------------------------------------- */
+/* Private functions: event coalescing */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
 /**
- * @brief  Get system tick value.
+ * @brief  Return true if the event ID can be coalescable.
  *
- * @return  System tick in milliseconds.
+ * @param[in] id  Event ID.
+ *
+ * @retval true   In the range of the event flags.
+ * @retval false  Out of the range.
  */
-/* ********************************************************************** */
-ESM_SYS_TICK_MSEC
-esm_md_GetTick(void)
+/* ====================================================================== */
+static bool
+in_event_flag_range(const ESM_EVENT_ID id)
 {
-    assert(module_ctx.initialized);
-
-    /* TODO: Need to implement this function. */
-
-    return 0;
+    return (id >= 0) && (id < ESM_CFG_COALESCE_EVENTS);
 }
 
-/* ********************************************************************** */
+/* ====================================================================== */
 /**
- * @brief  Peek event.
+ * @brief  Return true if the event flag of the event ID is set.
  *
- * @return  Event ID.
+ * @param[in] flags  Event flags (bitmap).
+ * @param[in] id     Event ID.
+ *
+ * @retval true   Set.
+ * @retval false  Not set (or out of the range).
+ */
+/* ====================================================================== */
+static bool
+test_event_flag(const uint32_t * const flags, const ESM_EVENT_ID id)
+{
+    assert(flags != NULL);
+
+    if (!in_event_flag_range(id)) {
+        return false;
+    }
+
+    return (flags[(uint32_t) id / 32] & (UINT32_C(1) << ((uint32_t) id % 32))) != 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Set or clear the event flag of the event ID.
+ *
+ * @param[in,out] flags  Event flags (bitmap).
+ * @param[in]     id     Event ID (in the range).
+ * @param[in]     on     true: set, false: clear.
+ */
+/* ====================================================================== */
+static void
+change_event_flag(uint32_t * const flags, const ESM_EVENT_ID id, const bool on)
+{
+    const uint32_t bit = UINT32_C(1) << ((uint32_t) id % 32);
+
+    assert((flags != NULL) && in_event_flag_range(id));
+
+    if (on) {
+        flags[(uint32_t) id / 32] |= bit;
+    } else {
+        flags[(uint32_t) id / 32] &= ~bit;
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Clear the event flags and the counters of the event coalescing.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_event_coalescing(MODULE_CTX * const mc)
+{
+    size_t i, j;
+
+    assert(mc != NULL);
+
+    for (i = 0; i < NELEMS(mc->coalescable); i++) {
+        mc->coalescable[i] = 0;
+    }
+    for (i = 0; i < EVENT_LANES; i++) {
+        for (j = 0; j < ESM_CFG_COALESCE_EVENTS; j++) {
+            eq_StoreIndex(&mc->posted_events[i][j], 0);
+            eq_StoreIndex(&mc->taken_events[i][j], 0);
+        }
+    }
+    mc->merged = 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return the event queue index of the priority.
+ *
+ * @param[in] priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @return  Index (0 to EVENT_LANES - 1).
+ */
+/* ====================================================================== */
+static size_t
+get_event_lane(const ESM_PRIORITY priority)
+{
+#ifdef ESM_CFG_PRIORITIES
+    assert(priority < ESM_CFG_PRIORITIES);
+
+    return (size_t) priority;
+#else
+    (void) priority;
+
+    return 0;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Merge the event into the pending one if it is coalescable.
+ *
+ * Only the pending event of the same priority is merged into, so a post
+ * never waits behind the one of a lower priority.
+ *
+ * The payload of the merged event is released.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entry     Event (element of the event queue).
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @retval true   Merged (no need to enqueue).
+ * @retval false  Not merged.
+ *
+ * @note  For the producer only.
+ */
+/* ====================================================================== */
+static bool
+merge_event(MODULE_CTX * const mc,
+            const EVENT_ENTRY * const entry,
+            const ESM_PRIORITY priority)
+{
+    const ESM_EVENT_ID id = get_event_id(entry);
+    const size_t lane = get_event_lane(priority);
+
+    assert(mc != NULL);
+
+    if (!test_event_flag(mc->coalescable, id)) {
+        return false;
+    }
+    if (eq_LoadIndex(&mc->posted_events[lane][id]) == eq_LoadIndex(&mc->taken_events[lane][id])) {
+        return false;
+    }
+
+    release_event_entry(entry);
+    mc->merged++;
+
+    return true;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Count the event to be enqueued (or cancel the count).
+ *
+ * Every event in the range is counted (coalescable or not), so the counts
+ * stay balanced when esm_md_SetEventCoalescing() is called on the way.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entry     Event (element of the event queue).
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ * @param[in]     enqueued  true: count, false: cancel (not enqueued).
+ *
+ * @note  For the producer only.
+ */
+/* ====================================================================== */
+static void
+count_pending_event(MODULE_CTX * const mc,
+                    const EVENT_ENTRY * const entry,
+                    const ESM_PRIORITY priority,
+                    const bool enqueued)
+{
+    const ESM_EVENT_ID id = get_event_id(entry);
+    EQ_INDEX *posted;
+
+    assert(mc != NULL);
+
+    if (!in_event_flag_range(id)) {
+        return;
+    }
+
+    posted = &mc->posted_events[get_event_lane(priority)][id];
+    eq_StoreIndex(posted, enqueued ? (eq_LoadIndex(posted) + 1) : (eq_LoadIndex(posted) - 1));
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Count the events taken from the event queue.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entries   Events (elements of the event queue).
+ * @param[in]     n         Number of the events.
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @note  For the consumer only.
+ */
+/* ====================================================================== */
+static void
+count_taken_events(MODULE_CTX * const mc,
+                   const EVENT_ENTRY * const entries,
+                   const size_t n,
+                   const ESM_PRIORITY priority)
+{
+    const size_t lane = get_event_lane(priority);
+    ESM_EVENT_ID id;
+    EQ_INDEX *taken;
+    size_t i;
+
+    assert((mc != NULL) && ((entries != NULL) || (n == 0)));
+
+    for (i = 0; i < n; i++) {
+        id = get_event_id(&entries[i]);
+        if (in_event_flag_range(id)) {
+            taken = &mc->taken_events[lane][id];
+            eq_StoreIndex(taken, eq_LoadIndex(taken) + 1);
+        }
+    }
+}
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/* ---------------------------------------------------------------------- */
+/* Private functions: event queue backpressure */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Reset the backpressure policy and statistics of the event queue.
+ *
+ * @param[out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+initialize_event_backpressure(MODULE_CTX * const mc)
+{
+    ESM_QUEUE_POLICY * const policy = &mc->event_policy;
+    ESM_QUEUE_STATS * const stats = &mc->event_stats;
+
+    assert(mc != NULL);
+
+    policy->capacity = 0;
+    policy->high_water = 0;
+    policy->low_water = 0;
+    policy->on_high_water = NULL;
+    policy->on_low_water = NULL;
+    policy->user_data = NULL;
+    policy->overflow = ESM_OVERFLOW_REJECT;
+    policy->timeout_msec = 0;
+
+    stats->depth = 0;
+    stats->max_depth = 0;
+    stats->rejected = 0;
+    stats->dropped = 0;
+    stats->blocked = 0;
+
+    eq_StoreIndex(&mc->high_water_signals, 0);
+    eq_StoreIndex(&mc->low_water_signals, 0);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return the number of the events in the event queue.
+ *
+ * @param[in] mc  Module context.
+ *
+ * @return  Number of the events (of all priorities).
+ */
+/* ====================================================================== */
+static size_t
+get_event_queue_depth(const MODULE_CTX * const mc)
+{
+#ifdef ESM_CFG_PRIORITIES
+    size_t depth, i;
+
+    assert(mc != NULL);
+
+    depth = 0;
+    for (i = 0; i < NELEMS(mc->queues); i++) {
+        depth += eq_Count(&mc->queues[i]);
+    }
+
+    return depth;
+#else
+    assert(mc != NULL);
+
+    return eq_Count(&mc->queue);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the event queue is above the high water mark.
+ *
+ * @param[in] mc  Module context.
+ *
+ * @retval true   Above the high water mark (not yet below the low one).
+ * @retval false  Not.
+ */
+/* ====================================================================== */
+static bool
+is_above_high_water(const MODULE_CTX * const mc)
+{
+    assert(mc != NULL);
+
+    return eq_LoadIndex(&mc->high_water_signals) != eq_LoadIndex(&mc->low_water_signals);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Count the posted event (and signal the high water mark).
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @note  For the producer only.
+ */
+/* ====================================================================== */
+static void
+count_posted_event(MODULE_CTX * const mc)
+{
+    const ESM_QUEUE_POLICY * const policy = &mc->event_policy;
+    ESM_QUEUE_STATS * const stats = &mc->event_stats;
+    size_t depth;
+
+    assert(mc != NULL);
+
+    depth = get_event_queue_depth(mc);
+    if (stats->max_depth < depth) {
+        stats->max_depth = depth;
+    }
+
+    if ((policy->high_water == 0) || is_above_high_water(mc)) {
+        return;
+    }
+    if (depth >= policy->high_water) {
+        eq_StoreIndex(&mc->high_water_signals, eq_LoadIndex(&mc->high_water_signals) + 1);
+        if (policy->on_high_water != NULL) {
+            policy->on_high_water(policy->user_data);
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Signal the low water mark after the events are taken.
+ *
+ * @param[in,out] mc  Module context.
+ *
+ * @note  For the consumer only.
+ */
+/* ====================================================================== */
+static void
+check_low_water(MODULE_CTX * const mc)
+{
+    const ESM_QUEUE_POLICY * const policy = &mc->event_policy;
+
+    assert(mc != NULL);
+
+    if (!is_above_high_water(mc)) {
+        return;
+    }
+    if (get_event_queue_depth(mc) <= policy->low_water) {
+        eq_StoreIndex(&mc->low_water_signals, eq_LoadIndex(&mc->low_water_signals) + 1);
+        if (policy->on_low_water != NULL) {
+            policy->on_low_water(policy->user_data);
+        }
+    }
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions: event queue */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Push the events to the event queue (of the priority).
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entries   Events (elements of the event queue).
+ * @param[in]     n         Number of the events.
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @return  Number of the pushed events (the first ones).
+ */
+/* ====================================================================== */
+static size_t
+enqueue_events(MODULE_CTX * const mc,
+               const EVENT_ENTRY * const entries,
+               const size_t n,
+               const ESM_PRIORITY priority)
+{
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_PRIORITIES
+    assert(priority < ESM_CFG_PRIORITIES);
+
+    return eq_PushBulk(&mc->queues[priority], entries, n);
+#else
+    (void) priority;
+
+    return eq_PushBulk(&mc->queue, entries, n);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the new (not merged) event to the event queue.
+ *
+ * If ESM_CFG_USE_BACKPRESSURE is defined, apply the capacity of the policy.
+ * Every overflow policy rejects the event: the queued events belong to the
+ * consumer, so the producer cannot drop them, and no other thread makes a
+ * space while the producer waits.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entry     Event (element of the event queue).
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure (the event queue is full).
+ */
+/* ====================================================================== */
+static bool
+post_new_event(MODULE_CTX * const mc,
+               const EVENT_ENTRY * const entry,
+               const ESM_PRIORITY priority)
+{
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    const ESM_QUEUE_POLICY * const policy = &mc->event_policy;
+    ESM_QUEUE_STATS * const stats = &mc->event_stats;
+
+    assert(mc != NULL);
+
+    if ((policy->capacity == 0) || (get_event_queue_depth(mc) < policy->capacity)) {
+        if (enqueue_events(mc, entry, 1, priority) == 1) {
+            count_posted_event(mc);
+            return true;
+        }
+    }
+
+    stats->rejected++;
+
+    return false;
+#else
+    assert(mc != NULL);
+
+    return enqueue_events(mc, entry, 1, priority) == 1;
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the event to the event queue.
+ *
+ * If ESM_CFG_COALESCE_EVENTS is defined, the coalescable event is merged
+ * into the pending one of the same event ID and priority.
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entry     Event (element of the event queue).
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @retval true   Exit success (posted or merged).
+ * @retval false  Exit failure (the event queue is full).
+ */
+/* ====================================================================== */
+static bool
+post_event(MODULE_CTX * const mc,
+           const EVENT_ENTRY * const entry,
+           const ESM_PRIORITY priority)
+{
+    assert((mc != NULL) && (entry != NULL));
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+    if (merge_event(mc, entry, priority)) {
+        return true;
+    }
+
+    /* Before the tail is published: the consumer may take it at once. */
+    count_pending_event(mc, entry, priority, true);
+    if (!post_new_event(mc, entry, priority)) {
+        count_pending_event(mc, entry, priority, false);
+        return false;
+    }
+
+    return true;
+#else
+    return post_new_event(mc, entry, priority);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the events to the event queue as many as possible.
+ *
+ * If ESM_CFG_USE_BACKPRESSURE or ESM_CFG_COALESCE_EVENTS is defined, the
+ * events are posted one by one (to apply the policy to each).
+ *
+ * @param[in,out] mc        Module context.
+ * @param[in]     entries   Events (elements of the event queue).
+ * @param[in]     n         Number of the events.
+ * @param[in]     priority  Priority (ignored without ESM_CFG_PRIORITIES).
+ *
+ * @return  Number of the posted events (the first ones).
+ */
+/* ====================================================================== */
+static size_t
+post_events(MODULE_CTX * const mc,
+            const EVENT_ENTRY * const entries,
+            const size_t n,
+            const ESM_PRIORITY priority)
+{
+#if defined(ESM_CFG_USE_BACKPRESSURE) || defined(ESM_CFG_COALESCE_EVENTS)
+    size_t i;
+
+    assert((mc != NULL) && ((entries != NULL) || (n == 0)));
+
+    for (i = 0; i < n; i++) {
+        if (!post_event(mc, &entries[i], priority)) {
+            break;
+        }
+    }
+
+    return i;
+#else
+    assert(mc != NULL);
+
+    return enqueue_events(mc, entries, n, priority);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take the events from the event queue (of one priority).
+ *
+ * @param[in,out] mc       Module context.
+ * @param[out]    entries  Events output place.
+ * @param[in]     n        Maximum number of the events.
+ *
+ * @return  Number of the taken events (0: no event).
+ */
+/* ====================================================================== */
+static size_t
+take_events(MODULE_CTX * const mc, EVENT_ENTRY * const entries, const size_t n)
+{
+    ESM_PRIORITY priority;
+    size_t count;
+
+    assert(mc != NULL);
+
+#ifdef ESM_CFG_PRIORITIES
+    count = pop_events(mc, entries, n, &priority);
+#else
+    priority = 0;
+    count = eq_PopBulk(&mc->queue, entries, n);
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    if (count > 0) {
+        check_low_water(mc);
+    }
+#endif
+#ifdef ESM_CFG_COALESCE_EVENTS
+    /* Before the dispatch: a new post is not merged into the taken one. */
+    if (count > 0) {
+        count_taken_events(mc, entries, count, priority);
+    }
+#else
+    (void) priority;
+#endif
+
+    return count;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take the event from the event queue.
+ *
+ * @param[in,out] mc     Module context.
+ * @param[out]    entry  Event output place.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure (no event).
+ */
+/* ====================================================================== */
+static bool
+take_event(MODULE_CTX * const mc, EVENT_ENTRY * const entry)
+{
+    assert((mc != NULL) && (entry != NULL));
+
+    return take_events(mc, entry, 1) == 1;
+}
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+/* ====================================================================== */
+/**
+ * @brief  Return true if the event record can be posted.
+ *
+ * @param[in] record  Event record.
+ *
+ * @retval true   Valid.
+ * @retval false  Invalid.
+ */
+/* ====================================================================== */
+static bool
+valid_event_record(const ESM_EVENT_RECORD * const record)
+{
+    assert(record != NULL);
+
+    if (record->data != NULL) {
+        return true;
+    }
+
+    /* The inline payload needs no release. */
+    if (record->release_data != NULL) {
+        return false;
+    }
+
+    return record->size <= sizeof(record->bytes);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take all the events, and release their payloads.
+ *
+ * @param[in,out] mc  Module context.
+ */
+/* ====================================================================== */
+static void
+release_pending_events(MODULE_CTX * const mc)
+{
+    EVENT_ENTRY entries[EVENT_CHUNK_SIZE];
+    size_t count, i;
+
+    assert(mc != NULL);
+
+    while ((count = take_events(mc, entries, NELEMS(entries))) > 0) {
+        for (i = 0; i < count; i++) {
+            release_event_entry(&entries[i]);
+        }
+    }
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Public API Functions: for ESM library */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Initialize the machdep library.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_RES     No system resources.
+ * @retval ESM_E_STATUS  Internal status error.
+ * @retval ESM_E_SYS     Error caused by underlying library routines.
+ *
+ * @note  This function will be called in esm_Initialize().
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_md_Initialize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (mc->initialized) {
+        return ESM_E_STATUS;
+    }
+
+    mc->prepared = false;
+
+    mc->initialized = true;
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Finalize the machdep library.
+ *
+ * @note  This function will be called in esm_Finalize().
+ */
+/* ********************************************************************** */
+void
+esm_md_Finalize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (!mc->initialized) {
+        return;
+    }
+
+    mc->initialized = false;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Prepare the machdep library before main loop.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  This function will be called in esm_PrepareBeforeMainLoop().
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_md_PrepareBeforeMainLoop(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if (mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+    esm_mp_Initialize(&mc->pool, mc->messages, NELEMS(mc->messages));
+
+#ifdef ESM_CFG_PRIORITIES
+    initialize_event_lanes(mc);
+#else
+    eq_Initialize(&mc->queue);
+#endif
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    initialize_event_backpressure(mc);
+#endif
+#ifdef ESM_CFG_COALESCE_EVENTS
+    initialize_event_coalescing(mc);
+#endif
+
+    mc->prepared = true;
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Cleanup the machdep library after main loop.
+ *
+ * @retval ESM_E_OK      Exit success.
+ * @retval ESM_E_STATUS  Internal status error.
+ *
+ * @note  This function will be called in esm_CleanupAfterMainLoop().
+ */
+/* ********************************************************************** */
+ESM_ERR
+esm_md_CleanupAfterMainLoop(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if (!mc->prepared) {
+        return ESM_E_STATUS;
+    }
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    release_pending_events(mc);
+#endif
+
+    mc->prepared = false;
+
+    return ESM_E_OK;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Allocate memory space for ESM_MESSAGE_CELL type.
+ *
+ * @retval !=NULL  Exit success.
+ * @retval   NULL  Exit failure.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_md_AllocMessageCell(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    return esm_mp_Alloc(&mc->pool);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Deallocate memory space for ESM_MESSAGE_CELL type.
+ *
+ * @param[in,out] cell  Memory space to deallocate.
+ */
+/* ********************************************************************** */
+void
+esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    esm_mp_Free(&mc->pool, cell);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the pointer of ESM_MESSAGE_CELL type (acquire).
+ *
+ * @param[in] ptr  Pointer variable.
+ *
+ * @return  Value of the pointer variable.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_md_LoadMessageCell(ESM_MESSAGE_CELL * const * const ptr)
+{
+    assert(ptr != NULL);
+
+    /* TODO: Need to implement this function (e.g. C11 atomic_load_explicit()). */
+
+    return *ptr;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the pointer of ESM_MESSAGE_CELL type (release).
+ *
+ * @param[out] ptr   Pointer variable.
+ * @param[in]  cell  Value to store.
+ */
+/* ********************************************************************** */
+void
+esm_md_StoreMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                        ESM_MESSAGE_CELL * const cell)
+{
+    assert(ptr != NULL);
+
+    /* TODO: Need to implement this function (e.g. C11 atomic_store_explicit()). */
+
+    *ptr = cell;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically exchange the pointer of ESM_MESSAGE_CELL type
+ *         (acquire and release).
+ *
+ * @param[in,out] ptr   Pointer variable.
+ * @param[in]     cell  Value to store.
+ *
+ * @return  Previous value of the pointer variable.
+ */
+/* ********************************************************************** */
+ESM_MESSAGE_CELL *
+esm_md_ExchangeMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                           ESM_MESSAGE_CELL * const cell)
+{
+    ESM_MESSAGE_CELL *prev;
+
+    assert(ptr != NULL);
+
+    /* TODO: Need to implement this function (e.g. C11 atomic_exchange_explicit()). */
+
+    prev = *ptr;
+    *ptr = cell;
+
+    return prev;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically load the variable of size_t type (acquire).
+ *
+ * @param[in] ptr  Pointer of the variable.
+ *
+ * @return  Value of the variable.
+ */
+/* ********************************************************************** */
+size_t
+esm_md_LoadSize(const size_t * const ptr)
+{
+    assert(ptr != NULL);
+
+    /* TODO: Need to implement this function (e.g. C11 atomic_load_explicit()). */
+
+    return *ptr;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Atomically store the variable of size_t type (release).
+ *
+ * @param[out] ptr    Pointer of the variable.
+ * @param[in]  value  Value to store.
+ */
+/* ********************************************************************** */
+void
+esm_md_StoreSize(size_t * const ptr, const size_t value)
+{
+    assert(ptr != NULL);
+
+    /* TODO: Need to implement this function (e.g. C11 atomic_store_explicit()). */
+
+    *ptr = value;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get system tick value.
+ *
+ * @return  System tick in milliseconds.
+ */
+/* ********************************************************************** */
+ESM_SYS_TICK_MSEC
+esm_md_GetTick(void)
+{
+    assert(module_ctx.initialized);
+
+    /* TODO: Need to implement this function. */
+
+    return 0;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get high-resolution system tick value.
+ *
+ * @return  System tick in microseconds.
+ */
+/* ********************************************************************** */
+ESM_SYS_TICK_USEC
+esm_md_GetTickUsec(void)
+{
+    assert(module_ctx.initialized);
+
+    /* TODO: Need to implement this function. */
+
+    return 0;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek event.
+ *
+ * @return  Event ID.
+ */
+/* ********************************************************************** */
+ESM_EVENT_ID
+esm_md_PeekEvent(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    EVENT_ENTRY entry;
+
+    assert(mc->initialized);
+
+    if (!mc->prepared) {
+        return ESM_EVENT_ID_NONE;
+    }
+
+    if (!take_event(mc, &entry)) {
+        return ESM_EVENT_ID_NONE;
+    }
+
+    /* The payload is not passed. */
+    release_event_entry(&entry);
+
+    return get_event_id(&entry);
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Return true if there is any event to peek.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ *
+ * @note  This function will be called in esm_GetNextDeadline().
+ */
+/* ********************************************************************** */
+bool
+esm_md_HasEvent(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if (!mc->prepared) {
+        return false;
+    }
+
+#ifdef ESM_CFG_PRIORITIES
+    return has_lane_events(mc);
+#else
+    return !eq_IsEmpty(&mc->queue);
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the event record.
+ *
+ * @param[out] record  Event record.
+ *
+ * @retval true   Event exists.
+ * @retval false  No event.
+ */
+/* ********************************************************************** */
+bool
+esm_md_PeekEventRecord(ESM_EVENT_RECORD * const record)
+{
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized && (record != NULL));
+
+    if (!mc->prepared) {
+        return false;
+    }
+
+    return take_event(mc, record);
+#else
+    (void) record;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Peek the events at once.
+ *
+ * @param[out] ids  Event IDs output place.
+ * @param[in]  n    Maximum number of the events.
+ *
+ * @return  Number of the events (0: no event).
+ */
+/* ********************************************************************** */
+size_t
+esm_md_PeekEvents(ESM_EVENT_ID * const ids, const size_t n)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    EVENT_ENTRY entries[EVENT_CHUNK_SIZE];
+    size_t count, i;
+
+    assert(mc->initialized && ((ids != NULL) || (n == 0)));
+
+    if (!mc->prepared) {
+        return 0;
+    }
+
+    count = take_events(mc, entries, (n < NELEMS(entries)) ? n : NELEMS(entries));
+    for (i = 0; i < count; i++) {
+        /* The payload is not passed. */
+        release_event_entry(&entries[i]);
+        ids[i] = get_event_id(&entries[i]);
+    }
+
+    return count;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the work (event, message, etc.).
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForWork(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    assert(module_ctx.initialized);
+
+    (void) timeout_msec;
+
+    /* TODO: Need to implement this function (e.g. sleep until interrupt). */
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up esm_md_WaitForWork().
+ */
+/* ********************************************************************** */
+void
+esm_md_NotifyWork(void)
+{
+    assert(module_ctx.initialized);
+
+    /* TODO: Need to implement this function. */
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wait for a space in the message queue.
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForSpace(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    assert(module_ctx.initialized);
+
+    (void) timeout_msec;
+
+    /* TODO: Need to implement this function (e.g. condition variable). */
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForSpace().
  */
 /* ********************************************************************** */
-ESM_EVENT_ID
-esm_md_PeekEvent(void)
+void
+esm_md_NotifySpace(void)
 {
-    MODULE_CTX * const mc = &module_ctx;
-    ESM_EVENT_ID id;
+    assert(module_ctx.initialized);
 
-    assert(mc->initialized);
+    /* TODO: Need to implement this function. */
+}
 
-    if (!mc->prepared) {
-        return ESM_EVENT_ID_NONE;
-    }
+/* ********************************************************************** */
+/**
+ * @brief  Wait for the completion of the message posted by esm_Invoke().
+ *
+ * @param[in] timeout_msec  Timeout value (in milliseconds, positive value).
+ *                          ESM_WAIT_FOREVER: no timeout.
+ */
+/* ********************************************************************** */
+void
+esm_md_WaitForCompletion(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    assert(module_ctx.initialized);
 
-    if (!eq_Pop(&mc->queue, &id)) {
-        return ESM_EVENT_ID_NONE;
-    }
+    (void) timeout_msec;
+
+    /* TODO: Need to implement this function (e.g. condition variable). */
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Wake up all esm_md_WaitForCompletion().
+ */
+/* ********************************************************************** */
+void
+esm_md_NotifyCompletion(void)
+{
+    assert(module_ctx.initialized);
 
-    return id;
+    /* TODO: Need to implement this function. */
 }
 
 /* ********************************************************************** */
@@ -388,12 +1725,338 @@ bool
 esm_md_PostEvent(const ESM_EVENT_ID id)
 {
     MODULE_CTX * const mc = &module_ctx;
+    EVENT_ENTRY entry;
+
+    assert(mc->initialized);
+
+    if (!mc->prepared) {
+        return false;
+    }
+
+    make_event_entry(&entry, id);
+    if (!post_event(mc, &entry, LOWEST_PRIORITY)) {
+        return false;
+    }
+
+    esm_md_NotifyWork();
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the event IDs to the event queue at once.
+ *
+ * @param[in]  ids     Event IDs.
+ * @param[in]  n       Number of the event IDs.
+ * @param[out] posted  Number of the posted event IDs (may be NULL).
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure (the rest of the event IDs are not posted).
+ */
+/* ********************************************************************** */
+bool
+esm_md_PostEvents(const ESM_EVENT_ID * const ids,
+                  const size_t n,
+                  size_t * const posted)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    EVENT_ENTRY entries[EVENT_CHUNK_SIZE];
+    size_t done, count, chunk, i;
+
+    assert(mc->initialized);
+
+    if (posted != NULL) {
+        *posted = 0;
+    }
+    if ((ids == NULL) && (n > 0)) {
+        return false;
+    }
+    if (!mc->prepared) {
+        return false;
+    }
+
+    done = 0;
+    while (done < n) {
+        chunk = n - done;
+        if (chunk > NELEMS(entries)) {
+            chunk = NELEMS(entries);
+        }
+        for (i = 0; i < chunk; i++) {
+            make_event_entry(&entries[i], ids[done + i]);
+        }
+
+        count = post_events(mc, entries, chunk, LOWEST_PRIORITY);
+        done += count;
+        if (count < chunk) {
+            break;
+        }
+    }
+
+    if (posted != NULL) {
+        *posted = done;
+    }
+    if (done > 0) {
+        esm_md_NotifyWork();
+    }
+
+    return done == n;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the event record to the event queue.
+ *
+ * @param[in] record  Event record.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_PostEventRecord(const ESM_EVENT_RECORD * const record)
+{
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if (record == NULL) {
+        return false;
+    }
+    if (!mc->prepared) {
+        return false;
+    }
+    if (!valid_event_record(record)) {
+        return false;
+    }
+
+    if (!post_event(mc, record, LOWEST_PRIORITY)) {
+        return false;
+    }
+
+    esm_md_NotifyWork();
+
+    return true;
+#else
+    (void) record;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post event ID to the event queue with the priority.
+ *
+ * @param[in] id        Event ID.
+ * @param[in] priority  Priority (0 to ESM_CFG_PRIORITIES - 1).
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_PostPriorityEvent(const ESM_EVENT_ID id, const ESM_PRIORITY priority)
+{
+#ifdef ESM_CFG_PRIORITIES
+    MODULE_CTX * const mc = &module_ctx;
+    EVENT_ENTRY entry;
+
+    assert(mc->initialized);
+
+    if (!mc->prepared) {
+        return false;
+    }
+    if (priority >= ESM_CFG_PRIORITIES) {
+        return false;
+    }
+
+    make_event_entry(&entry, id);
+    if (!post_event(mc, &entry, priority)) {
+        return false;
+    }
+
+    esm_md_NotifyWork();
+
+    return true;
+#else
+    (void) id;
+    (void) priority;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the message cell pool.
+ *
+ * @param[out] stats  Statistics.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_GetMessagePoolStats(ESM_MESSAGE_POOL_STATS * const stats)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if ((stats == NULL) || !mc->prepared) {
+        return false;
+    }
+
+    /* Serialized with esm_md_AllocMessageCell() (called in the lock). */
+    esm_md_LockForAPI();
+    esm_mp_GetStats(&mc->pool, stats);
+    esm_md_UnlockForAPI();
+
+    return true;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the backpressure policy of the event queue.
+ *
+ * @param[in] policy  Backpressure policy.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_SetEventQueuePolicy(const ESM_QUEUE_POLICY * const policy)
+{
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if ((policy == NULL) || !mc->prepared) {
+        return false;
+    }
+    if ((policy->high_water > 0) && (policy->low_water >= policy->high_water)) {
+        return false;
+    }
+    if (policy->overflow > ESM_OVERFLOW_BLOCK) {
+        return false;
+    }
+
+    mc->event_policy = *policy;
+    eq_StoreIndex(&mc->low_water_signals, eq_LoadIndex(&mc->high_water_signals));
+
+    return true;
+#else
+    (void) policy;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the event queue.
+ *
+ * @param[out] stats  Statistics.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_GetEventQueueStats(ESM_QUEUE_STATS * const stats)
+{
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if ((stats == NULL) || !mc->prepared) {
+        return false;
+    }
+
+    *stats = mc->event_stats;
+    stats->depth = get_event_queue_depth(mc);
+
+    return true;
+#else
+    (void) stats;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Make the event ID coalescable (or not).
+ *
+ * @param[in] id           Event ID (0 to ESM_CFG_COALESCE_EVENTS - 1).
+ * @param[in] coalescable  true: coalescable, false: not.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ *
+ * @note  The flags are read by the producer without a lock: call this
+ *        function from the main loop.
+ */
+/* ********************************************************************** */
+bool
+esm_md_SetEventCoalescing(const ESM_EVENT_ID id, const bool coalescable)
+{
+#ifdef ESM_CFG_COALESCE_EVENTS
+    MODULE_CTX * const mc = &module_ctx;
 
     assert(mc->initialized);
 
     if (!mc->prepared) {
         return false;
     }
+    if (!in_event_flag_range(id)) {
+        return false;
+    }
+
+    change_event_flag(mc->coalescable, id, coalescable);
+
+    return true;
+#else
+    (void) id;
+    (void) coalescable;
+
+    return false;
+#endif
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the number of the merged events.
+ *
+ * @param[out] count  Number of the merged events.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ********************************************************************** */
+bool
+esm_md_GetMergedEventCount(uint32_t * const count)
+{
+#ifdef ESM_CFG_COALESCE_EVENTS
+    MODULE_CTX * const mc = &module_ctx;
+
+    assert(mc->initialized);
+
+    if ((count == NULL) || !mc->prepared) {
+        return false;
+    }
+
+    *count = mc->merged;
 
-    return eq_Push(&mc->queue, id);
+    return true;
+#else
+    (void) count;
+
+    return false;
+#endif
 }
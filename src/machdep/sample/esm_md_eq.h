@@ -10,6 +10,7 @@
 #define ESM_MD_EQ_H_INCLUDED
 
 #include "esm.h"
+#include "esm_message_pool.h"
 
 /* ---------------------------------------------------------------------- */
 /* Public API Functions */
@@ -23,9 +24,150 @@
  *
  * @retval true  Exit success.
  * @retval false Exit failure.
+ *
+ * @note  Lock-free for one producer (e.g. an ISR) with the main loop.
  */
 /* ********************************************************************** */
 extern bool
 esm_md_PostEvent(const ESM_EVENT_ID id);
 
+/* ********************************************************************** */
+/**
+ * @brief  Post the event IDs to the event queue at once.
+ *
+ * The event IDs are pushed to the ring in bulk (one publish per chunk). If
+ * the event queue becomes full, the first *posted event IDs are posted and
+ * the rest are not.
+ *
+ * @param[in]  ids     Event IDs.
+ * @param[in]  n       Number of the event IDs.
+ * @param[out] posted  Number of the posted event IDs (may be NULL).
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or some of the event IDs are not posted).
+ *
+ * @note  Lock-free for one producer (e.g. an ISR) with the main loop.
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_PostEvents(const ESM_EVENT_ID * const ids,
+                  const size_t n,
+                  size_t * const posted);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the event record (event ID with the payload) to the event
+ *         queue.
+ *
+ * The record is queued as is: the payload pointed by data is not copied,
+ * and released by the library after the event is processed (or by this
+ * library if the event is dropped or left at the cleanup). If data is NULL,
+ * the payload is the inline bytes (release_data must be NULL).
+ *
+ * @param[in] record  Event record.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_USE_EVENT_RECORD is not defined).
+ *               The payload is not released.
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_PostEventRecord(const ESM_EVENT_RECORD * const record);
+
+/* ********************************************************************** */
+/**
+ * @brief  Post event ID to the event queue with the priority.
+ *
+ * esm_md_PeekEvent() returns the events of the higher priority (numerically
+ * lower) first. esm_md_PostEvent() uses the lowest priority.
+ *
+ * @param[in] id        Event ID.
+ * @param[in] priority  Priority (0 to ESM_CFG_PRIORITIES - 1).
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_PRIORITIES is not defined).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_PostPriorityEvent(const ESM_EVENT_ID id, const ESM_PRIORITY priority);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the message cell pool.
+ *
+ * @param[out] stats  Statistics.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure.
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_GetMessagePoolStats(ESM_MESSAGE_POOL_STATS * const stats);
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the backpressure policy of the event queue.
+ *
+ * Same as esm_SetMessageQueuePolicy(), but the depth is also limited by
+ * ESM_CFG_EVENT_QUEUE_SIZE (per priority), and ESM_OVERFLOW_DROP_OLDEST and
+ * ESM_OVERFLOW_BLOCK work as ESM_OVERFLOW_REJECT in this sample (the queued
+ * events belong to the main loop, and no other thread takes the events).
+ *
+ * @param[in] policy  Backpressure policy.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_USE_BACKPRESSURE is not defined).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_SetEventQueuePolicy(const ESM_QUEUE_POLICY * const policy);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the statistics of the event queue.
+ *
+ * @param[out] stats  Statistics.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_USE_BACKPRESSURE is not defined).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_GetEventQueueStats(ESM_QUEUE_STATS * const stats);
+
+/* ********************************************************************** */
+/**
+ * @brief  Make the event ID coalescable (or not).
+ *
+ * While a coalescable event is in the event queue (not yet peeked), the
+ * posts of the same event ID and priority are merged into it: they succeed
+ * without enqueueing (the payload of the event record is released at once).
+ * The flags are cleared by esm_PrepareBeforeMainLoop().
+ *
+ * @param[in] id           Event ID (0 to ESM_CFG_COALESCE_EVENTS - 1).
+ * @param[in] coalescable  true: coalescable, false: not.
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_COALESCE_EVENTS is not defined).
+ *
+ * @note  Call this function from the main loop (not from the producer).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_SetEventCoalescing(const ESM_EVENT_ID id, const bool coalescable);
+
+/* ********************************************************************** */
+/**
+ * @brief  Get the number of the merged events.
+ *
+ * @param[out] count  Number of the merged events (since
+ *                    esm_PrepareBeforeMainLoop()).
+ *
+ * @retval true  Exit success.
+ * @retval false Exit failure (or ESM_CFG_COALESCE_EVENTS is not defined).
+ */
+/* ********************************************************************** */
+extern bool
+esm_md_GetMergedEventCount(uint32_t * const count);
+
 #endif /* ndef ESM_MD_EQ_H_INCLUDED */
@@ -25,4 +25,10 @@ typedef int32_t ESM_EVENT_ID;
  */
 typedef int32_t ESM_SYS_TICK_MSEC;
 
+/**
+ * System tick type (microseconds, for ESM_CFG_USE_TICK_USEC).
+ * You must select a signed integer types (64 bit width is recommended).
+ */
+typedef int64_t ESM_SYS_TICK_USEC;
+
 #endif /* ndef ESM_TYPES_H_INCLUDED */
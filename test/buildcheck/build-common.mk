@@ -19,7 +19,7 @@ include-dirs   := $(addprefix -I , \
                   $(include-dir) \
                   $(VPATH))
 
-object-files   := esm.o esm_md.o
+object-files   := esm.o esm_timer_wheel.o esm_timer_soa.o esm_mpsc_queue.o esm_spsc_queue.o esm_message_pool.o esm_priority.o esm_md.o
 depend-files   := $(subst .o,.d,$(object-files))
 
 #----------------------------------------------------------------------
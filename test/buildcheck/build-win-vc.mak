@@ -18,7 +18,7 @@ vpath           = $(lib_dir) $(md_sample_dir)
 include_dirs    = $(include_dir)\
                   $(vpath)
 
-object_files    = esm.obj esm_md.obj
+object_files    = esm.obj esm_timer_wheel.obj esm_timer_soa.obj esm_mpsc_queue.obj esm_spsc_queue.obj esm_message_pool.obj esm_priority.obj esm_md.obj
 
 # ----------------------------------------------------------
 
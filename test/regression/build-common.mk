@@ -0,0 +1,156 @@
+# @brief   ESM: Makefile for the regression tests (Unix environment)
+# @author  eel3
+# @date    2026-10-17
+#
+# make -f build-<target-arch>.mk check [SANITIZE=address|thread|...]
+# (SANITIZE=thread for the data races of the multi-producer tests)
+
+# ---------------------------------------------------------------------
+
+root-dir       := ../../src
+
+include-dir    := $(root-dir)/include
+lib-dir        := $(root-dir)/lib
+machdep-dir    := $(root-dir)/machdep
+md-sample-dir  := $(machdep-dir)/sample
+
+#----------------------------------------------------------------------
+
+# The test directory first (for esm_config.h).
+include-dirs   := $(addprefix -I , \
+                  . \
+                  $(include-dir) \
+                  $(lib-dir) \
+                  $(md-sample-dir))
+
+lib-files      := $(wildcard $(lib-dir)/*.c) $(wildcard $(lib-dir)/*.h) \
+                  $(wildcard $(include-dir)/*.h) esm_config.h
+test-md-files  := test_md.c test_md.h $(lib-files)
+test-check-files := test_check.c test_check.h
+md-sample-files := $(md-sample-dir)/esm_md.c $(wildcard $(md-sample-dir)/*.h) $(lib-files)
+
+trace-programs := trace_timer_scan trace_timer_wheel trace_timer_soa
+stress-programs := stress_message_lock stress_message_mpsc stress_message_shards
+unit-programs  := test_message_pool test_message_pool_mpsc test_spsc_queue \
+                  test_event_queue test_event_queue_priorities \
+                  test_event_queue_coalesce \
+                  test_defer_event test_defer_event_batch \
+                  test_defer_event_record \
+                  test_message_queue test_message_queue_priorities \
+                  test_message_queue_mpsc
+programs       := $(trace-programs) $(stress-programs) $(unit-programs)
+
+# Randomized trace parameters (the second start tick wraps around).
+trace-seeds    := 1 2 3 4 5 6
+trace-steps    := 3000
+trace-ticks    := 0 0x7fff0000
+
+#----------------------------------------------------------------------
+
+CCDEFS     += -DDEBUG -D_POSIX_C_SOURCE=200112L
+OPTIM      ?= -O1 -g
+c-std      := -std=c99
+WARN       ?= -Wall $(c-std) -pedantic \
+              -Wextra \
+              -Wunused-result \
+              -Wno-unused-function -Wbad-function-cast -Wcast-align \
+                  -Wmissing-include-dirs -Wundef \
+                  -Werror-implicit-function-declaration
+
+# The tick arithmetic of the library relies on the wraparound.
+CFLAGS     += $(OPTIM) -fwrapv $(WARN) $(WARNADD)
+CPPFLAGS   += $(CCDEFS) $(variant) $(include-dirs)
+LDFLAGS    += $(OPTIM)
+
+ifneq "$(SANITIZE)" ""
+CFLAGS     += -fsanitize=$(SANITIZE)
+LDFLAGS    += -fsanitize=$(SANITIZE)
+endif
+
+#----------------------------------------------------------------------
+
+phony-targets  := all check clean usage
+
+.PHONY: $(phony-targets)
+
+usage:
+	# $(MAKE) -f build-<target-arch>.mk $(patsubst %,[%],$(phony-targets))
+
+all: $(programs)
+
+check: $(programs)
+	@for tick in $(trace-ticks); do \
+	  for seed in $(trace-seeds); do \
+	    for p in $(trace-programs); do \
+	      ./$$p $$seed $(trace-steps) $$tick > $$p.txt || exit 1; \
+	    done; \
+	    cmp trace_timer_scan.txt trace_timer_wheel.txt || exit 1; \
+	    cmp trace_timer_scan.txt trace_timer_soa.txt || exit 1; \
+	  done; \
+	done
+	@echo "trace_timer: OK"
+	@for p in $(stress-programs) $(unit-programs); do \
+	  ./$$p || exit 1; \
+	done
+
+clean:
+	$(RM) $(programs) $(addsuffix .txt,$(trace-programs))
+
+#----------------------------------------------------------------------
+
+# $(call link-program,source-files)
+link-program = $(LINK.c) $(filter %.c,$1) $(LDLIBS) $(OUTPUT_OPTION)
+
+trace_timer_wheel: variant := -DESM_CFG_USE_TIMER_WHEEL
+trace_timer_soa: variant := -DESM_CFG_USE_TIMER_SOA
+
+$(trace-programs): trace_timer.c $(test-md-files)
+	$(call link-program,$^)
+
+stress_message_mpsc: variant := -DESM_CFG_USE_MPSC_QUEUE
+stress_message_shards: variant := -DESM_CFG_MESSAGE_SHARDS=4 -DESM_CFG_MESSAGE_SHARD_SIZE=16
+
+$(stress-programs): stress_message.c $(test-md-files)
+	$(call link-program,$^)
+
+test_message_pool_mpsc: variant := -DESM_CFG_USE_MPSC_QUEUE
+
+test_message_pool test_message_pool_mpsc: test_message_pool.c $(test-check-files) $(test-md-files)
+	$(call link-program,$^)
+
+test_spsc_queue: test_spsc_queue.c $(test-check-files) $(test-md-files)
+	$(call link-program,$^)
+
+message-queue-programs := test_message_queue test_message_queue_priorities \
+                          test_message_queue_mpsc
+
+test_message_queue: variant := -DESM_CFG_USE_BACKPRESSURE
+test_message_queue_priorities: variant := -DESM_CFG_USE_BACKPRESSURE -DESM_CFG_PRIORITIES=4
+test_message_queue_mpsc: variant := -DESM_CFG_USE_BACKPRESSURE -DESM_CFG_USE_MPSC_QUEUE
+
+$(message-queue-programs): test_message_queue.c $(test-check-files) $(test-md-files)
+	$(call link-program,$^)
+
+# The sample machdep uses the C11 atomics if available.
+event-queue-programs := test_event_queue test_event_queue_priorities \
+                        test_event_queue_coalesce
+
+$(event-queue-programs): c-std := -std=c11
+test_event_queue_priorities: variant := -DESM_CFG_PRIORITIES=4 -DESM_CFG_USE_BACKPRESSURE
+test_event_queue_coalesce: variant := -DESM_CFG_PRIORITIES=4 -DESM_CFG_COALESCE_EVENTS=16
+
+$(event-queue-programs): test_event_queue.c $(test-check-files) $(md-sample-files)
+	$(call link-program,$^)
+
+defer-event-programs := test_defer_event test_defer_event_batch \
+                        test_defer_event_record
+
+$(defer-event-programs): c-std := -std=c11
+test_defer_event: variant := -DESM_CFG_MAX_DEFERRED_EVENTS=4
+test_defer_event_batch: variant := -DESM_CFG_MAX_DEFERRED_EVENTS=4 \
+                                   -DESM_CFG_USE_EVENT_BATCH -DESM_CFG_EVENT_BATCH_SIZE=8 \
+                                   -DESM_CFG_EVENT_BUDGET=8
+test_defer_event_record: variant := -DESM_CFG_MAX_DEFERRED_EVENTS=4 -DESM_CFG_USE_EVENT_RECORD
+
+$(defer-event-programs): test_defer_event.c $(test-check-files) $(md-sample-files)
+	$(call link-program,$^)
@@ -0,0 +1,20 @@
+# @brief   ESM: Makefile for the regression tests (Unix GCC)
+# @author  eel3
+# @date    2026-10-17
+
+# ---------------------------------------------------------------------
+
+PREFIX         :=
+CC             := $(PREFIX)$(CC)
+
+CFLAGS          =
+LDFLAGS         =
+LDLIBS         := -lpthread
+
+CCDEFS          =
+WARNADD        :=
+SANITIZE       :=
+
+# ---------------------------------------------------------------------
+
+include ./build-common.mk
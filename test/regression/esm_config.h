@@ -0,0 +1,38 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: configurations (for the regression tests).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The other options are given by the Makefile (see build-common.mk).
+ */
+/* ********************************************************************** */
+
+#ifndef ESM_CONFIG_H_INCLUDED
+#define ESM_CONFIG_H_INCLUDED
+
+/* ---------------------------------------------------------------------- */
+/* Configurations for the library */
+/* ---------------------------------------------------------------------- */
+
+/** Maximum number of timers (odd sizes on purpose). */
+#define ESM_CFG_MAX_TIMER 37
+
+/** Maximum number of global timers. */
+#define ESM_CFG_MAX_GLOBAL_TIMER 23
+
+/** Maximum number of timer handles. */
+#define ESM_CFG_MAX_TIMER_HANDLE 50
+
+#define ESM_CFG_USE_ASSERT_H
+
+/** Maximum number of messages. */
+#define ESM_CFG_MAX_MESSAGE 64
+
+/* ---------------------------------------------------------------------- */
+/* Configurations for the sample machdep library */
+/* ---------------------------------------------------------------------- */
+
+#define ESM_CFG_EVENT_QUEUE_SIZE 32
+
+#endif /* ndef ESM_CONFIG_H_INCLUDED */
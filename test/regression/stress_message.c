@@ -0,0 +1,228 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: multi-producer message stress test (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * NUM_PRODUCERS threads post the numbered messages while the main thread
+ * runs esm_ResumeAndYield(), and every message must arrive once, in order
+ * per producer. Build with ESM_CFG_USE_MPSC_QUEUE, ESM_CFG_MESSAGE_SHARDS
+ * or ESM_CFG_PRIORITIES to test the other message queues, and with
+ * -fsanitize=thread to check the data races.
+ *
+ * Usage: stress_message [<messages per producer>]
+ */
+/* ********************************************************************** */
+
+#include "esm.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the producer threads. */
+#define NUM_PRODUCERS 4
+
+/** Bits of the sequence number in the message. */
+#define SEQ_BITS 24
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/** Producer context type. */
+typedef struct {
+    pthread_t thread;
+    size_t index;
+#ifdef ESM_CFG_MESSAGE_SHARDS
+    ESM_PRODUCER_ID id;
+#endif
+} PRODUCER_CTX;
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the messages per producer. */
+static size_t num_messages = 100000;
+
+/** Next sequence number expected per producer (main loop only). */
+static size_t expected[NUM_PRODUCERS];
+
+/** Number of the received and the out-of-order messages (main loop only). */
+static size_t received;
+static size_t errors;
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Check the order of the message (called by the main loop).
+ *
+ * @param[in] user_data  Producer index and sequence number.
+ */
+/* ====================================================================== */
+static void
+on_message(void * const user_data)
+{
+    const size_t value = (size_t) user_data;
+    const size_t producer = value >> SEQ_BITS;
+    const size_t seq = value & ((1U << SEQ_BITS) - 1);
+
+    if ((producer >= NUM_PRODUCERS) || (seq != expected[producer])) {
+        if (errors++ == 0) {
+            (void) fprintf(stderr, "producer %lu: got %lu, expected %lu\n",
+                           (unsigned long) producer,
+                           (unsigned long) seq,
+                           (unsigned long) ((producer < NUM_PRODUCERS) ? expected[producer] : 0));
+        }
+    } else {
+        expected[producer]++;
+    }
+    received++;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the message (retry while the queue is full).
+ *
+ * @param[in] ctx  Producer context.
+ * @param[in] msg  Message.
+ *
+ * @retval true   Exit success.
+ * @retval false  Exit failure.
+ */
+/* ====================================================================== */
+static bool
+post_message(const PRODUCER_CTX * const ctx, const ESM_MESSAGE * const msg)
+{
+    ESM_ERR err;
+
+    for (;;) {
+#if defined(ESM_CFG_MESSAGE_SHARDS)
+        err = esm_PostProducerMessage(ctx->id, msg);
+#elif defined(ESM_CFG_PRIORITIES)
+        err = esm_PostPriorityMessage(msg, (ESM_PRIORITY) (ctx->index % ESM_CFG_PRIORITIES));
+#else
+        (void) ctx;
+        err = esm_PostMessage(msg);
+#endif
+        if (err != ESM_E_RES) {
+            return err == ESM_E_OK;
+        }
+        (void) sched_yield();
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Producer thread.
+ *
+ * @param[in] arg  Producer context.
+ *
+ * @return  NULL: Exit success, otherwise: Exit failure.
+ */
+/* ====================================================================== */
+static void *
+producer_thread(void *arg)
+{
+    const PRODUCER_CTX * const ctx = (const PRODUCER_CTX *) arg;
+    ESM_MESSAGE msg;
+    size_t seq;
+
+    msg.func = on_message;
+    msg.release_user_data = NULL;
+
+    for (seq = 0; seq < num_messages; seq++) {
+        msg.user_data = (void *) ((ctx->index << SEQ_BITS) | seq);
+        if (!post_message(ctx, &msg)) {
+            return arg;
+        }
+    }
+
+    return NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks (not used).
+ */
+/* ====================================================================== */
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    (void) user_data;
+    (void) id;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(int argc, char *argv[])
+{
+    static const ESM_EVENT_HANDLER handler = {
+        NULL, on_event, NULL, NULL, NULL, NULL, NULL, NULL
+    };
+    static PRODUCER_CTX producers[NUM_PRODUCERS];
+    ESM_PREPARE_PARAMS params;
+    size_t i;
+    bool failed;
+
+    if (argc > 1) {
+        num_messages = (size_t) strtoul(argv[1], NULL, 10);
+    }
+    if (num_messages >= ((size_t) 1 << SEQ_BITS)) {
+        (void) fprintf(stderr, "too many messages\n");
+        return EXIT_FAILURE;
+    }
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+    params.default_handler = &handler;
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < NUM_PRODUCERS; i++) {
+        producers[i].index = i;
+#ifdef ESM_CFG_MESSAGE_SHARDS
+        if (esm_CreateProducer(&producers[i].id) != ESM_E_OK) {
+            return EXIT_FAILURE;
+        }
+#endif
+        if (pthread_create(&producers[i].thread, NULL, producer_thread, &producers[i]) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    while (received < (num_messages * NUM_PRODUCERS)) {
+        esm_ResumeAndYield();
+    }
+
+    failed = false;
+    for (i = 0; i < NUM_PRODUCERS; i++) {
+        void *result;
+
+        if ((pthread_join(producers[i].thread, &result) != 0) || (result != NULL)) {
+            failed = true;
+        }
+    }
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    printf("stress_message: %lu messages, %lu errors\n",
+           (unsigned long) received, (unsigned long) errors);
+
+    return (failed || (errors > 0)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
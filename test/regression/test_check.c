@@ -0,0 +1,64 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: condition checks for the regression tests.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The failures are counted in the main thread only (not thread-safe).
+ */
+/* ********************************************************************** */
+
+#include "test_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the failures. */
+static int failures;
+
+/* ---------------------------------------------------------------------- */
+/* Public functions */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Report the failure of the condition (see CHECK()).
+ *
+ * @param[in] cond  Condition.
+ * @param[in] expr  Expression of the condition.
+ * @param[in] file  File name.
+ * @param[in] line  Line number.
+ */
+/* ********************************************************************** */
+void
+test_Check(const bool cond,
+           const char * const expr,
+           const char * const file,
+           const int line)
+{
+    if (!cond) {
+        (void) fprintf(stderr, "%s:%d: %s\n", file, line, expr);
+        failures++;
+    }
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Print the number of the failures.
+ *
+ * @param[in] name  Test name.
+ *
+ * @return  Exit status of the test (EXIT_SUCCESS: no failure).
+ */
+/* ********************************************************************** */
+int
+test_Report(const char * const name)
+{
+    printf("%s: %d failures\n", name, failures);
+
+    return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: condition checks for the regression tests.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef TEST_CHECK_H_INCLUDED
+#define TEST_CHECK_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ---------------------------------------------------------------------- */
+/* Macros */
+/* ---------------------------------------------------------------------- */
+
+/** Number of elements of the array. */
+#define NELEMS(array) (sizeof(array) / sizeof((array)[0]))
+
+/** Count the failure of the condition. */
+#define CHECK(cond) test_Check((cond), #cond, __FILE__, __LINE__)
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+extern void
+test_Check(const bool cond,
+           const char * const expr,
+           const char * const file,
+           const int line);
+
+extern int
+test_Report(const char * const name);
+
+#endif /* ndef TEST_CHECK_H_INCLUDED */
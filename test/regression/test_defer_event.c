@@ -0,0 +1,403 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: deferred event test (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Two states defer the events of their own ranges with esm_DeferEvent(),
+ * and the handled events are checked against the expected order after
+ * each transition. Build with ESM_CFG_USE_EVENT_BATCH or
+ * ESM_CFG_USE_EVENT_RECORD to test the batch (held over events) and the
+ * event record (payloads) paths.
+ */
+/* ********************************************************************** */
+
+#include "esm.h"
+#include "esm_md.h"
+#include "esm_md_eq.h"
+#include "test_check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Event ID to request the transition to the other state. */
+#define EV_SWITCH 0
+
+/** Number of the states. */
+#define NUM_STATES 2
+
+/** Size of the log of the handled events. */
+#define LOG_SIZE 64
+
+/** Number of the main loop iterations to process all posted events. */
+#define NUM_ITERATIONS 64
+
+/* ---------------------------------------------------------------------- */
+/* Macros */
+/* ---------------------------------------------------------------------- */
+
+/** Log entry of the handled event. */
+#define LOG_ENTRY(state, id) (((int) (state) * 100) + (int) (id))
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/** State type. */
+typedef struct {
+    size_t index;
+    ESM_EVENT_ID defer_min;     /**< Deferred events (defer_min to defer_max - 1). */
+    ESM_EVENT_ID defer_max;
+} STATE;
+
+/* ---------------------------------------------------------------------- */
+/* Function prototypes */
+/* ---------------------------------------------------------------------- */
+
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id);
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+static void
+on_event_record(void * const user_data, ESM_EVENT_RECORD * const record);
+#define RECORD_HANDLER on_event_record
+#else
+#define RECORD_HANDLER NULL
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** States and their event handlers. */
+static STATE states[NUM_STATES] = {
+    { 0, 0, 0 },
+    { 1, 0, 0 },
+};
+static const ESM_EVENT_HANDLER handlers[NUM_STATES] = {
+    { NULL, on_event, NULL, NULL, NULL, &states[0], RECORD_HANDLER, NULL },
+    { NULL, on_event, NULL, NULL, NULL, &states[1], RECORD_HANDLER, NULL },
+};
+
+/** Log of the handled events (LOG_ENTRY()). */
+static int log_entries[LOG_SIZE];
+static size_t num_log_entries;
+
+/** Number of esm_DeferEvent() failed with ESM_E_RES. */
+static size_t defer_failures;
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+/** Payloads (the event ID itself). */
+static unsigned char payloads[LOG_SIZE];
+
+/** Number of the posted payloads and the released ones. */
+static size_t posts;
+static size_t releases;
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Defer or handle the event in the state.
+ *
+ * @param[in] state  State.
+ * @param[in] id     Event ID.
+ */
+/* ====================================================================== */
+static void
+handle_event(const STATE * const state, const ESM_EVENT_ID id)
+{
+    ESM_ERR err;
+
+    if ((id >= state->defer_min) && (id < state->defer_max)) {
+        err = esm_DeferEvent();
+        if (err == ESM_E_OK) {
+            /* Deferred at most once per dispatch. */
+            CHECK(esm_DeferEvent() == ESM_E_STATUS);
+            return;
+        }
+        CHECK(err == ESM_E_RES);
+        defer_failures++;
+    }
+
+    if (num_log_entries < LOG_SIZE) {
+        log_entries[num_log_entries] = LOG_ENTRY(state->index, id);
+    }
+    num_log_entries++;
+
+    if (id == EV_SWITCH) {
+        CHECK(esm_SetNextEventHandler(&handlers[(state->index + 1) % NUM_STATES]) == ESM_E_OK);
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks.
+ */
+/* ====================================================================== */
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    handle_event((const STATE *) user_data, id);
+}
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks (with the payload).
+ */
+/* ====================================================================== */
+static void
+on_event_record(void * const user_data, ESM_EVENT_RECORD * const record)
+{
+    /* The payload is carried over to the recalled event. */
+    CHECK((record->size == 1) && (record->data != NULL));
+    CHECK(*(const unsigned char *) record->data == (unsigned char) record->id);
+
+    handle_event((const STATE *) user_data, record->id);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Release the payload of the event record.
+ */
+/* ====================================================================== */
+static void
+release_payload(void * const data)
+{
+    CHECK((data >= (void *) payloads) && (data < (void *) &payloads[LOG_SIZE]));
+
+    releases++;
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Post the events.
+ *
+ * @param[in] ids  Event IDs.
+ * @param[in] n    Number of the events.
+ */
+/* ====================================================================== */
+static void
+post_events(const ESM_EVENT_ID * const ids, const size_t n)
+{
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    ESM_EVENT_RECORD record;
+#endif
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+#ifdef ESM_CFG_USE_EVENT_RECORD
+        /* The odd events point to the payload, and the even ones inline. */
+        (void) memset(&record, 0, sizeof(record));
+        record.id = ids[i];
+        record.size = 1;
+        if ((ids[i] % 2) != 0) {
+            record.data = &payloads[ids[i]];
+            record.release_data = release_payload;
+            posts++;
+        } else {
+            record.bytes[0] = (unsigned char) ids[i];
+        }
+        CHECK(esm_md_PostEventRecord(&record));
+#else
+        CHECK(esm_md_PostEvent(ids[i]));
+#endif
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Run the main loop and check the handled events.
+ *
+ * @param[in] expected  Expected log entries.
+ * @param[in] n         Number of the entries.
+ * @param[in] line      Line number of the caller.
+ */
+/* ====================================================================== */
+static void
+run_and_check(const int * const expected, const size_t n, const int line)
+{
+    size_t i;
+
+    num_log_entries = 0;
+    for (i = 0; i < NUM_ITERATIONS; i++) {
+        CHECK(esm_ResumeAndYield() == ESM_E_OK);
+    }
+
+    test_Check(num_log_entries == n, "num_log_entries == n", __FILE__, line);
+    for (i = 0; (i < n) && (i < num_log_entries); i++) {
+        test_Check(log_entries[i] == expected[i], "log_entries[i] == expected[i]", __FILE__, line);
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Set the deferred events of the state.
+ */
+/* ====================================================================== */
+static void
+set_defer_range(const size_t state, const ESM_EVENT_ID min, const ESM_EVENT_ID max)
+{
+    states[state].defer_min = min;
+    states[state].defer_max = max;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the recall order of the deferred events.
+ */
+/* ====================================================================== */
+static void
+test_recall(void)
+{
+    static const ESM_EVENT_ID ids1[] = { 10, 1, 11, EV_SWITCH, 12 };
+    static const int log1[] = {
+        LOG_ENTRY(0, 1), LOG_ENTRY(0, EV_SWITCH),
+        LOG_ENTRY(1, 10), LOG_ENTRY(1, 11), LOG_ENTRY(1, 12)
+    };
+    static const ESM_EVENT_ID ids2[] = { EV_SWITCH, 2 };
+    static const int log2[] = {
+        LOG_ENTRY(1, EV_SWITCH), LOG_ENTRY(0, 2)
+    };
+
+    /* Recalled before the event still in the queue. */
+    set_defer_range(0, 10, 20);
+    post_events(ids1, NELEMS(ids1));
+    run_and_check(log1, NELEMS(log1), __LINE__);
+
+    /* Nothing to recall. */
+    post_events(ids2, NELEMS(ids2));
+    run_and_check(log2, NELEMS(log2), __LINE__);
+
+    set_defer_range(0, 0, 0);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the recalled event deferred again.
+ */
+/* ====================================================================== */
+static void
+test_defer_again(void)
+{
+    static const ESM_EVENT_ID ids1[] = { 10, 20, 11, EV_SWITCH };
+    static const int log1[] = {
+        LOG_ENTRY(0, EV_SWITCH), LOG_ENTRY(1, 10), LOG_ENTRY(1, 11)
+    };
+    static const ESM_EVENT_ID ids2[] = { 21, EV_SWITCH };
+    static const int log2[] = {
+        LOG_ENTRY(1, EV_SWITCH), LOG_ENTRY(0, 20), LOG_ENTRY(0, 21)
+    };
+
+    /* 20 is recalled and deferred again, and stays before 21. */
+    set_defer_range(0, 10, 30);
+    set_defer_range(1, 20, 30);
+    post_events(ids1, NELEMS(ids1));
+    run_and_check(log1, NELEMS(log1), __LINE__);
+
+    set_defer_range(0, 0, 0);
+    post_events(ids2, NELEMS(ids2));
+    run_and_check(log2, NELEMS(log2), __LINE__);
+
+    set_defer_range(1, 0, 0);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the full deferred ring.
+ */
+/* ====================================================================== */
+static void
+test_ring_full(void)
+{
+    ESM_EVENT_ID ids[ESM_CFG_MAX_DEFERRED_EVENTS + 2];
+    int log[ESM_CFG_MAX_DEFERRED_EVENTS + 2];
+    size_t i, n;
+
+    /* The overflowed event is handled at once. */
+    for (i = 0; i <= ESM_CFG_MAX_DEFERRED_EVENTS; i++) {
+        ids[i] = (ESM_EVENT_ID) (10 + i);
+    }
+    ids[i] = EV_SWITCH;
+
+    n = 0;
+    log[n++] = LOG_ENTRY(0, 10 + ESM_CFG_MAX_DEFERRED_EVENTS);
+    log[n++] = LOG_ENTRY(0, EV_SWITCH);
+    for (i = 0; i < ESM_CFG_MAX_DEFERRED_EVENTS; i++) {
+        log[n++] = LOG_ENTRY(1, 10 + i);
+    }
+
+    set_defer_range(0, 10, 10 + ESM_CFG_MAX_DEFERRED_EVENTS + 1);
+    defer_failures = 0;
+    post_events(ids, NELEMS(ids));
+    run_and_check(log, n, __LINE__);
+    CHECK(defer_failures == 1);
+
+    /* Back to the first state. */
+    ids[0] = EV_SWITCH;
+    log[0] = LOG_ENTRY(1, EV_SWITCH);
+    set_defer_range(0, 0, 0);
+    post_events(ids, 1);
+    run_and_check(log, 1, __LINE__);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(void)
+{
+    static const ESM_EVENT_ID left[] = { 10, 11 };
+    ESM_PREPARE_PARAMS params;
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    size_t i;
+#endif
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+    CHECK(esm_DeferEvent() == ESM_E_STATUS);
+
+    params.default_handler = &handlers[0];
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    for (i = 0; i < NELEMS(payloads); i++) {
+        payloads[i] = (unsigned char) i;
+    }
+#endif
+
+    /* Not in the dispatch. */
+    CHECK(esm_DeferEvent() == ESM_E_STATUS);
+
+    test_recall();
+    test_defer_again();
+    test_ring_full();
+
+    /* The deferred events left are discarded (and released) by the cleanup. */
+    set_defer_range(0, 10, 20);
+    post_events(left, NELEMS(left));
+    run_and_check(NULL, 0, __LINE__);
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+#ifdef ESM_CFG_USE_EVENT_RECORD
+    /* Every payload is released once, handled or discarded. */
+    CHECK(releases == posts);
+#endif
+
+    return test_Report("test_defer_event");
+}
@@ -0,0 +1,559 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: event queue test of the sample machdep (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Check the full/empty states and the order of the event queue, and then
+ * post the numbered events from a producer thread while the main thread
+ * takes them. Build with ESM_CFG_PRIORITIES, ESM_CFG_USE_BACKPRESSURE and
+ * ESM_CFG_COALESCE_EVENTS to test the priority lanes, the water marks and
+ * the event coalescing.
+ */
+/* ********************************************************************** */
+
+#include "esm.h"
+#include "esm_md.h"
+#include "esm_md_eq.h"
+#include "test_check.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the events posted by the producer thread. */
+#define NUM_EVENTS 200000
+
+/** Number of the priority lanes used. */
+#ifdef ESM_CFG_PRIORITIES
+#define NUM_LANES ESM_CFG_PRIORITIES
+#else
+#define NUM_LANES 1
+#endif
+
+/** Bits of the sequence number in the event ID (the lane is above). */
+#define SEQ_BITS 20
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+/** Number of the coalescable event IDs posted by the producer thread. */
+#define NUM_COALESCABLE 8
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/** Backpressure policy of the threaded test. */
+#define CAPACITY 24
+#define HIGH_WATER 20
+#define LOW_WATER 4
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/** Number of the water mark callbacks (called by the producer thread). */
+static unsigned long high_water_calls;
+static unsigned long low_water_calls;
+#endif
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+/** true after the producer thread posted all events. */
+static pthread_mutex_t producer_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool producer_done;
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Post the event ID to the lane.
+ */
+/* ====================================================================== */
+static bool
+post_event(const ESM_EVENT_ID id, const size_t lane)
+{
+#ifdef ESM_CFG_PRIORITIES
+    return esm_md_PostPriorityEvent(id, (ESM_PRIORITY) lane);
+#else
+    (void) lane;
+
+    return esm_md_PostEvent(id);
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Take all events (and return the number of them).
+ */
+/* ====================================================================== */
+static size_t
+drain_events(void)
+{
+    size_t n;
+
+    for (n = 0; esm_md_PeekEvent() != ESM_EVENT_ID_NONE; n++) {
+        continue;
+    }
+
+    return n;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the full/empty states and the order.
+ */
+/* ====================================================================== */
+static void
+test_fifo(void)
+{
+    ESM_EVENT_ID ids[ESM_CFG_EVENT_QUEUE_SIZE + 1];
+    size_t i, posted;
+
+    CHECK(!esm_md_HasEvent());
+    CHECK(esm_md_PeekEvent() == ESM_EVENT_ID_NONE);
+
+    for (i = 0; i < ESM_CFG_EVENT_QUEUE_SIZE; i++) {
+        CHECK(esm_md_PostEvent((ESM_EVENT_ID) i));
+    }
+    CHECK(!esm_md_PostEvent(99));
+    CHECK(esm_md_HasEvent());
+
+    for (i = 0; i < ESM_CFG_EVENT_QUEUE_SIZE; i++) {
+        CHECK(esm_md_PeekEvent() == (ESM_EVENT_ID) i);
+    }
+    CHECK(!esm_md_HasEvent());
+
+    /* Bulk post: the first ones are posted. */
+    for (i = 0; i < NELEMS(ids); i++) {
+        ids[i] = (ESM_EVENT_ID) (100 + i);
+    }
+    CHECK(esm_md_PostEvent(1));
+    CHECK(!esm_md_PostEvents(ids, NELEMS(ids), &posted));
+    CHECK(posted == (ESM_CFG_EVENT_QUEUE_SIZE - 1));
+    CHECK(esm_md_PeekEvent() == 1);
+    for (i = 0; i < posted; i++) {
+        CHECK(esm_md_PeekEvent() == ids[i]);
+    }
+    CHECK(esm_md_PeekEvent() == ESM_EVENT_ID_NONE);
+}
+
+#ifdef ESM_CFG_PRIORITIES
+/* ====================================================================== */
+/**
+ * @brief  Test the order of the priority lanes.
+ */
+/* ====================================================================== */
+static void
+test_priorities(void)
+{
+    size_t lane;
+
+    CHECK(!esm_md_PostPriorityEvent(1, ESM_CFG_PRIORITIES));
+
+    /* From the lowest priority, two per lane. */
+    for (lane = ESM_CFG_PRIORITIES; lane > 0; lane--) {
+        CHECK(esm_md_PostPriorityEvent((ESM_EVENT_ID) (lane * 10), (ESM_PRIORITY) (lane - 1)));
+        CHECK(esm_md_PostPriorityEvent((ESM_EVENT_ID) (lane * 10 + 1), (ESM_PRIORITY) (lane - 1)));
+    }
+    for (lane = 1; lane <= ESM_CFG_PRIORITIES; lane++) {
+        CHECK(esm_md_PeekEvent() == (ESM_EVENT_ID) (lane * 10));
+        CHECK(esm_md_PeekEvent() == (ESM_EVENT_ID) (lane * 10 + 1));
+    }
+    CHECK(!esm_md_HasEvent());
+
+    /* A lane refilled after the check is still taken. */
+    CHECK(esm_md_PostPriorityEvent(5, ESM_CFG_PRIORITIES - 1));
+    CHECK(esm_md_HasEvent());
+    CHECK(esm_md_PeekEvent() == 5);
+    CHECK(esm_md_PostPriorityEvent(6, ESM_CFG_PRIORITIES - 1));
+    CHECK(esm_md_PeekEvent() == 6);
+    CHECK(!esm_md_HasEvent());
+}
+#endif
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+/* ====================================================================== */
+/**
+ * @brief  Water mark callbacks.
+ */
+/* ====================================================================== */
+static void
+on_high_water(void * const user_data)
+{
+    (void) user_data;
+    high_water_calls++;
+}
+
+static void
+on_low_water(void * const user_data)
+{
+    (void) user_data;
+    low_water_calls++;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Set the backpressure policy.
+ */
+/* ====================================================================== */
+static void
+set_policy(const size_t capacity, const size_t high_water, const size_t low_water)
+{
+    ESM_QUEUE_POLICY policy;
+
+    policy.capacity = capacity;
+    policy.high_water = high_water;
+    policy.low_water = low_water;
+    policy.on_high_water = on_high_water;
+    policy.on_low_water = on_low_water;
+    policy.user_data = NULL;
+    policy.overflow = ESM_OVERFLOW_REJECT;
+    policy.timeout_msec = 0;
+
+    CHECK(esm_md_SetEventQueuePolicy(&policy));
+    high_water_calls = 0;
+    low_water_calls = 0;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the capacity, the water marks and the statistics.
+ */
+/* ====================================================================== */
+static void
+test_backpressure(void)
+{
+    ESM_QUEUE_STATS before, stats;
+    size_t i;
+
+    /* The statistics count from esm_PrepareBeforeMainLoop(). */
+    CHECK(esm_md_GetEventQueueStats(&before));
+    set_policy(8, 6, 2);
+
+    for (i = 0; i < 8; i++) {
+        CHECK(post_event((ESM_EVENT_ID) i, i % NUM_LANES));
+    }
+    CHECK(high_water_calls == 1);
+    CHECK(!post_event(8, 0));
+
+    CHECK(esm_md_GetEventQueueStats(&stats));
+    CHECK(stats.depth == 8);
+    CHECK(stats.max_depth >= 8);
+    CHECK(stats.rejected == (before.rejected + 1));
+
+    for (i = 0; i < 5; i++) {
+        CHECK(esm_md_PeekEvent() != ESM_EVENT_ID_NONE);
+    }
+    CHECK(low_water_calls == 0);
+    CHECK(esm_md_PeekEvent() != ESM_EVENT_ID_NONE);
+    CHECK(low_water_calls == 1);
+
+    CHECK(drain_events() == 2);
+    CHECK(esm_md_GetEventQueueStats(&stats));
+    CHECK(stats.depth == 0);
+    CHECK(high_water_calls == 1);
+    CHECK(low_water_calls == 1);
+
+    set_policy(0, 0, 0);
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Producer thread.
+ *
+ * @param[in] arg  Not used.
+ *
+ * @return  NULL.
+ */
+/* ====================================================================== */
+static void *
+producer_thread(void *arg)
+{
+    size_t seq[NUM_LANES] = { 0 };
+    size_t i, lane;
+
+    (void) arg;
+
+    for (i = 0; i < NUM_EVENTS; i++) {
+        lane = (i * 7 / 3) % NUM_LANES;
+        while (!post_event((ESM_EVENT_ID) ((lane << SEQ_BITS) | seq[lane]), lane)) {
+            (void) sched_yield();
+        }
+        seq[lane]++;
+    }
+
+    return NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the events posted from the producer thread.
+ */
+/* ====================================================================== */
+static void
+test_threads(void)
+{
+    size_t expected[NUM_LANES] = { 0 };
+    size_t received, errors, lane;
+    pthread_t thread;
+    ESM_EVENT_ID id;
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    ESM_QUEUE_STATS stats;
+
+    set_policy(CAPACITY, HIGH_WATER, LOW_WATER);
+#endif
+
+    if (pthread_create(&thread, NULL, producer_thread, NULL) != 0) {
+        CHECK(false);
+        return;
+    }
+
+    /* Take all events anyway: the producer waits for the space. */
+    received = 0;
+    errors = 0;
+    while (received < NUM_EVENTS) {
+        if ((id = esm_md_PeekEvent()) == ESM_EVENT_ID_NONE) {
+            (void) sched_yield();
+            continue;
+        }
+        lane = (size_t) id >> SEQ_BITS;
+        if ((lane >= NUM_LANES) || (((size_t) id & ((1U << SEQ_BITS) - 1)) != expected[lane])) {
+            errors++;
+        } else {
+            expected[lane]++;
+        }
+        received++;
+    }
+
+    (void) pthread_join(thread, NULL);
+    CHECK(errors == 0);
+    CHECK(!esm_md_HasEvent());
+
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    CHECK(esm_md_GetEventQueueStats(&stats));
+    CHECK(stats.depth == 0);
+    /* Each high water mark is followed by a low one. */
+    CHECK(high_water_calls == low_water_calls);
+    set_policy(0, 0, 0);
+#endif
+}
+
+#ifdef ESM_CFG_COALESCE_EVENTS
+/* ====================================================================== */
+/**
+ * @brief  Return the number of the merged events.
+ */
+/* ====================================================================== */
+static uint32_t
+get_merged(void)
+{
+    uint32_t count = 0;
+
+    CHECK(esm_md_GetMergedEventCount(&count));
+
+    return count;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the merge of the coalescable events.
+ */
+/* ====================================================================== */
+static void
+test_coalescing(void)
+{
+    const uint32_t merged = get_merged();
+
+    CHECK(!esm_md_SetEventCoalescing(ESM_CFG_COALESCE_EVENTS, true));
+    CHECK(esm_md_SetEventCoalescing(3, true));
+
+    /* Merged while pending, and queued again once taken. */
+    CHECK(post_event(3, 0));
+    CHECK(post_event(3, 0));
+    CHECK(post_event(4, 0));
+    CHECK(post_event(4, 0));
+    CHECK(get_merged() == (merged + 1));
+    CHECK(esm_md_PeekEvent() == 3);
+    CHECK(post_event(3, 0));
+    CHECK(esm_md_PeekEvent() == 4);
+    CHECK(esm_md_PeekEvent() == 4);
+    CHECK(esm_md_PeekEvent() == 3);
+    CHECK(!esm_md_HasEvent());
+
+#ifdef ESM_CFG_PRIORITIES
+    /* Not merged into the pending one of another priority. */
+    CHECK(post_event(3, NUM_LANES - 1));
+    CHECK(post_event(3, 0));
+    CHECK(post_event(3, 0));
+    CHECK(get_merged() == (merged + 2));
+    CHECK(drain_events() == 2);
+#endif
+
+    /* Made coalescable while queued: merged into the queued one. */
+    CHECK(post_event(5, 0));
+    CHECK(esm_md_SetEventCoalescing(5, true));
+    CHECK(post_event(5, 0));
+    CHECK(drain_events() == 1);
+    CHECK(post_event(5, 0));
+    CHECK(drain_events() == 1);
+
+    /* Not coalescable any more while queued. */
+    CHECK(post_event(5, 0));
+    CHECK(esm_md_SetEventCoalescing(5, false));
+    CHECK(post_event(5, 0));
+    CHECK(drain_events() == 2);
+
+    CHECK(esm_md_SetEventCoalescing(3, false));
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Producer thread of the coalescable events.
+ *
+ * @param[in] arg  Not used.
+ *
+ * @return  NULL.
+ */
+/* ====================================================================== */
+static void *
+coalescing_producer_thread(void *arg)
+{
+    size_t i;
+
+    (void) arg;
+
+    for (i = 0; i < NUM_EVENTS; i++) {
+        while (!post_event((ESM_EVENT_ID) (i % NUM_COALESCABLE), i % NUM_LANES)) {
+            (void) sched_yield();
+        }
+    }
+
+    (void) pthread_mutex_lock(&producer_lock);
+    producer_done = true;
+    (void) pthread_mutex_unlock(&producer_lock);
+
+    return NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the producer thread posted all events.
+ */
+/* ====================================================================== */
+static bool
+is_producer_done(void)
+{
+    bool done;
+
+    (void) pthread_mutex_lock(&producer_lock);
+    done = producer_done;
+    (void) pthread_mutex_unlock(&producer_lock);
+
+    return done;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the coalescable events posted from the producer thread.
+ *
+ * Every post is taken or merged, and no event ID is left pending after the
+ * queue is drained (a new post of each one is queued again).
+ */
+/* ====================================================================== */
+static void
+test_coalescing_threads(void)
+{
+    const uint32_t merged = get_merged();
+    pthread_t thread;
+    size_t i, received;
+
+    for (i = 0; i < NUM_COALESCABLE; i++) {
+        CHECK(esm_md_SetEventCoalescing((ESM_EVENT_ID) i, true));
+    }
+
+    producer_done = false;
+    if (pthread_create(&thread, NULL, coalescing_producer_thread, NULL) != 0) {
+        CHECK(false);
+        return;
+    }
+
+    received = 0;
+    while (!is_producer_done() || esm_md_HasEvent()) {
+        if (esm_md_PeekEvent() == ESM_EVENT_ID_NONE) {
+            (void) sched_yield();
+        } else {
+            received++;
+        }
+    }
+    (void) pthread_join(thread, NULL);
+
+    CHECK((received + (get_merged() - merged)) == NUM_EVENTS);
+
+    for (i = 0; i < (NUM_COALESCABLE * NUM_LANES); i++) {
+        CHECK(post_event((ESM_EVENT_ID) (i % NUM_COALESCABLE), i / NUM_COALESCABLE));
+    }
+    CHECK(drain_events() == (NUM_COALESCABLE * NUM_LANES));
+
+    for (i = 0; i < NUM_COALESCABLE; i++) {
+        CHECK(esm_md_SetEventCoalescing((ESM_EVENT_ID) i, false));
+    }
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks (not used).
+ */
+/* ====================================================================== */
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    (void) user_data;
+    (void) id;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(void)
+{
+    static const ESM_EVENT_HANDLER handler = {
+        NULL, on_event, NULL, NULL, NULL, NULL, NULL, NULL
+    };
+    ESM_PREPARE_PARAMS params;
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+    params.default_handler = &handler;
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+
+    test_fifo();
+#ifdef ESM_CFG_PRIORITIES
+    test_priorities();
+#endif
+#ifdef ESM_CFG_USE_BACKPRESSURE
+    test_backpressure();
+#endif
+    test_threads();
+#ifdef ESM_CFG_COALESCE_EVENTS
+    test_coalescing();
+    test_coalescing_threads();
+#endif
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return test_Report("test_event_queue");
+}
@@ -0,0 +1,273 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: machdep implementation for the regression tests.
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * The system tick is a variable driven by the test (test_md_SetTick()), and
+ * the event queue is a plain ring filled by test_md_PostEvent() from the
+ * main loop thread. The API lock and the cell pool are guarded by pthread
+ * mutexes, so the message APIs can be called from any thread.
+ */
+/* ********************************************************************** */
+
+#include "esm_md.h"
+#include "esm_message_pool.h"
+#include "test_md.h"
+
+#include <pthread.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Size of the event queue (power of two). */
+#define EVENT_QUEUE_SIZE 1024
+
+/* ---------------------------------------------------------------------- */
+/* Data structures */
+/* ---------------------------------------------------------------------- */
+
+/** Module context type. */
+typedef struct {
+    ESM_SYS_TICK_MSEC tick;
+
+    pthread_mutex_t api_lock;
+    pthread_mutex_t pool_lock;
+    ESM_MESSAGE_CELL cells[ESM_CFG_MAX_MESSAGE];
+    ESM_MESSAGE_POOL pool;
+
+    ESM_EVENT_ID events[EVENT_QUEUE_SIZE];
+    size_t head;
+    size_t tail;
+} MODULE_CTX;
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Module context. */
+static MODULE_CTX module_ctx;
+
+/* ---------------------------------------------------------------------- */
+/* Public functions (for the tests) */
+/* ---------------------------------------------------------------------- */
+
+/* ********************************************************************** */
+/**
+ * @brief  Set the system tick.
+ *
+ * @param[in] tick  System tick.
+ */
+/* ********************************************************************** */
+void
+test_md_SetTick(const ESM_SYS_TICK_MSEC tick)
+{
+    module_ctx.tick = tick;
+}
+
+/* ********************************************************************** */
+/**
+ * @brief  Post the event ID (from the main loop thread only).
+ *
+ * @param[in] id  Event ID.
+ *
+ * @retval true   Exit success.
+ * @retval false  The event queue is full.
+ */
+/* ********************************************************************** */
+bool
+test_md_PostEvent(const ESM_EVENT_ID id)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if ((mc->tail - mc->head) >= EVENT_QUEUE_SIZE) {
+        return false;
+    }
+
+    mc->events[mc->tail++ & (EVENT_QUEUE_SIZE - 1)] = id;
+
+    return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Public functions (machdep) */
+/* ---------------------------------------------------------------------- */
+
+ESM_ERR
+esm_md_Initialize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (pthread_mutex_init(&mc->api_lock, NULL) != 0) {
+        return ESM_E_SYS;
+    }
+    if (pthread_mutex_init(&mc->pool_lock, NULL) != 0) {
+        (void) pthread_mutex_destroy(&mc->api_lock);
+        return ESM_E_SYS;
+    }
+
+    return ESM_E_OK;
+}
+
+void
+esm_md_Finalize(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    (void) pthread_mutex_destroy(&mc->pool_lock);
+    (void) pthread_mutex_destroy(&mc->api_lock);
+}
+
+ESM_ERR
+esm_md_PrepareBeforeMainLoop(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    esm_mp_Initialize(&mc->pool, mc->cells, ESM_CFG_MAX_MESSAGE);
+    mc->head = 0;
+    mc->tail = 0;
+
+    return ESM_E_OK;
+}
+
+ESM_ERR
+esm_md_CleanupAfterMainLoop(void)
+{
+    return ESM_E_OK;
+}
+
+ESM_MESSAGE_CELL *
+esm_md_AllocMessageCell(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+    ESM_MESSAGE_CELL *cell;
+
+    (void) pthread_mutex_lock(&mc->pool_lock);
+    cell = esm_mp_Alloc(&mc->pool);
+    (void) pthread_mutex_unlock(&mc->pool_lock);
+
+    return cell;
+}
+
+void
+esm_md_DeallocMessageCell(ESM_MESSAGE_CELL * const cell)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    /* Lock-free with the MPSC queue. */
+    esm_mp_Free(&mc->pool, cell);
+#else
+    (void) pthread_mutex_lock(&mc->pool_lock);
+    esm_mp_Free(&mc->pool, cell);
+    (void) pthread_mutex_unlock(&mc->pool_lock);
+#endif
+}
+
+ESM_MESSAGE_CELL *
+esm_md_LoadMessageCell(ESM_MESSAGE_CELL * const * const ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void
+esm_md_StoreMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                        ESM_MESSAGE_CELL * const cell)
+{
+    __atomic_store_n(ptr, cell, __ATOMIC_RELEASE);
+}
+
+ESM_MESSAGE_CELL *
+esm_md_ExchangeMessageCell(ESM_MESSAGE_CELL ** const ptr,
+                           ESM_MESSAGE_CELL * const cell)
+{
+    return __atomic_exchange_n(ptr, cell, __ATOMIC_ACQ_REL);
+}
+
+size_t
+esm_md_LoadSize(const size_t * const ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void
+esm_md_StoreSize(size_t * const ptr, const size_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+ESM_SYS_TICK_MSEC
+esm_md_GetTick(void)
+{
+    return module_ctx.tick;
+}
+
+ESM_SYS_TICK_USEC
+esm_md_GetTickUsec(void)
+{
+    return (ESM_SYS_TICK_USEC) module_ctx.tick * 1000;
+}
+
+ESM_EVENT_ID
+esm_md_PeekEvent(void)
+{
+    MODULE_CTX * const mc = &module_ctx;
+
+    if (mc->head == mc->tail) {
+        return ESM_EVENT_ID_NONE;
+    }
+
+    return mc->events[mc->head++ & (EVENT_QUEUE_SIZE - 1)];
+}
+
+bool
+esm_md_HasEvent(void)
+{
+    return module_ctx.head != module_ctx.tail;
+}
+
+void
+esm_md_WaitForWork(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    (void) timeout_msec;
+}
+
+void
+esm_md_NotifyWork(void)
+{
+}
+
+void
+esm_md_WaitForSpace(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    (void) timeout_msec;
+}
+
+void
+esm_md_NotifySpace(void)
+{
+}
+
+void
+esm_md_WaitForCompletion(const ESM_SYS_TICK_MSEC timeout_msec)
+{
+    (void) timeout_msec;
+}
+
+void
+esm_md_NotifyCompletion(void)
+{
+}
+
+void
+esm_md_LockForAPI(void)
+{
+    (void) pthread_mutex_lock(&module_ctx.api_lock);
+}
+
+void
+esm_md_UnlockForAPI(void)
+{
+    (void) pthread_mutex_unlock(&module_ctx.api_lock);
+}
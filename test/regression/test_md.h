@@ -0,0 +1,24 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: machdep interfaces for the regression tests.
+ * @author  eel3
+ * @date    2026-10-17
+ */
+/* ********************************************************************** */
+
+#ifndef TEST_MD_H_INCLUDED
+#define TEST_MD_H_INCLUDED
+
+#include "esm.h"
+
+/* ---------------------------------------------------------------------- */
+/* Functions */
+/* ---------------------------------------------------------------------- */
+
+extern void
+test_md_SetTick(const ESM_SYS_TICK_MSEC tick);
+
+extern bool
+test_md_PostEvent(const ESM_EVENT_ID id);
+
+#endif /* ndef TEST_MD_H_INCLUDED */
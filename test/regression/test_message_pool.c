@@ -0,0 +1,286 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: message cell pool test (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Check the allocation, the statistics and the slab add/remove of
+ * esm_mp_*(). With ESM_CFG_USE_MPSC_QUEUE, the cells are also freed from
+ * other threads while the main thread allocates them.
+ */
+/* ********************************************************************** */
+
+#include "esm_message_pool.h"
+#include "test_check.h"
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+#include <pthread.h>
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the cells (initial ones and a slab). */
+#define NUM_CELLS 16
+#define NUM_SLAB_CELLS 8
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+/** Number of the freeing threads and the rounds. */
+#define NUM_THREADS 4
+#define NUM_ROUNDS 2000
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Pool and cells. */
+static ESM_MESSAGE_POOL pool;
+static ESM_MESSAGE_CELL cells[NUM_CELLS];
+static ESM_MESSAGE_CELL slab[NUM_SLAB_CELLS];
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Allocate all cells of the pool.
+ *
+ * @param[out] out  Allocated cells.
+ * @param[in]  max  Maximum number of the cells.
+ *
+ * @return  Number of the allocated cells.
+ */
+/* ====================================================================== */
+static size_t
+alloc_all(ESM_MESSAGE_CELL ** const out, const size_t max)
+{
+    size_t n;
+
+    for (n = 0; n < max; n++) {
+        if ((out[n] = esm_mp_Alloc(&pool)) == NULL) {
+            break;
+        }
+    }
+
+    return n;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return true if the cells are distinct.
+ */
+/* ====================================================================== */
+static bool
+are_distinct(ESM_MESSAGE_CELL * const * const p, const size_t n)
+{
+    size_t i, j;
+
+    for (i = 0; i < n; i++) {
+        for (j = i + 1; j < n; j++) {
+            if (p[i] == p[j]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the allocation and the statistics.
+ */
+/* ====================================================================== */
+static void
+test_alloc(void)
+{
+    ESM_MESSAGE_CELL *p[NUM_CELLS + 1];
+    ESM_MESSAGE_POOL_STATS stats;
+    size_t i;
+
+    esm_mp_Initialize(&pool, cells, NUM_CELLS);
+    CHECK(esm_mp_NumFree(&pool) == NUM_CELLS);
+
+    CHECK(alloc_all(p, NELEMS(p)) == NUM_CELLS);
+    CHECK(are_distinct(p, NUM_CELLS));
+    CHECK(p[0] == &cells[0]);
+    for (i = 0; i < NUM_CELLS; i++) {
+        CHECK(!p[i]->empty && (p[i]->next == NULL));
+    }
+    CHECK(esm_mp_Alloc(&pool) == NULL);
+
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.capacity == NUM_CELLS);
+    CHECK(stats.in_use == NUM_CELLS);
+    CHECK(stats.high_water == NUM_CELLS);
+    CHECK(stats.alloc_failures == 2);
+
+    for (i = 0; i < NUM_CELLS; i += 2) {
+        esm_mp_Free(&pool, p[i]);
+    }
+    CHECK(esm_mp_NumFree(&pool) == (NUM_CELLS / 2));
+
+    /* The freed cells are reused. */
+    for (i = 0; i < NUM_CELLS; i += 2) {
+        ESM_MESSAGE_CELL * const cell = esm_mp_Alloc(&pool);
+        size_t j;
+
+        CHECK(cell != NULL);
+        for (j = 1; j < NUM_CELLS; j += 2) {
+            CHECK(cell != p[j]);
+        }
+    }
+    CHECK(esm_mp_Alloc(&pool) == NULL);
+
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.in_use == NUM_CELLS);
+    CHECK(stats.high_water == NUM_CELLS);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the slab add/remove.
+ */
+/* ====================================================================== */
+static void
+test_slab(void)
+{
+    ESM_MESSAGE_CELL *p[NUM_CELLS + NUM_SLAB_CELLS];
+    ESM_MESSAGE_POOL_STATS stats;
+    size_t i, n;
+
+    esm_mp_Initialize(&pool, cells, NUM_CELLS);
+    n = alloc_all(p, NUM_CELLS);
+    CHECK(n == NUM_CELLS);
+
+    esm_mp_AddCells(&pool, slab, NUM_SLAB_CELLS);
+    CHECK(esm_mp_NumFree(&pool) == NUM_SLAB_CELLS);
+    n += alloc_all(&p[n], NUM_SLAB_CELLS);
+    CHECK(n == NELEMS(p));
+    CHECK(esm_mp_Alloc(&pool) == NULL);
+    CHECK(are_distinct(p, n));
+
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.capacity == (NUM_CELLS + NUM_SLAB_CELLS));
+    CHECK(stats.in_use == (NUM_CELLS + NUM_SLAB_CELLS));
+
+    /* Not removed while a cell of the slab is in use. */
+    for (i = 0; i < n; i++) {
+        if ((p[i] != &slab[0]) && (p[i] != &cells[0])) {
+            esm_mp_Free(&pool, p[i]);
+        }
+    }
+    CHECK(!esm_mp_RemoveCells(&pool, slab, NUM_SLAB_CELLS));
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.capacity == (NUM_CELLS + NUM_SLAB_CELLS));
+
+    esm_mp_Free(&pool, &slab[0]);
+    CHECK(esm_mp_RemoveCells(&pool, slab, NUM_SLAB_CELLS));
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.capacity == NUM_CELLS);
+    CHECK(stats.in_use == 1);
+    CHECK(esm_mp_NumFree(&pool) == (NUM_CELLS - 1));
+
+    /* No cell of the removed slab is allocated. */
+    n = alloc_all(p, NELEMS(p));
+    CHECK(n == (NUM_CELLS - 1));
+    for (i = 0; i < n; i++) {
+        CHECK((p[i] < &slab[0]) || (p[i] >= &slab[NUM_SLAB_CELLS]));
+    }
+}
+
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+/* ====================================================================== */
+/**
+ * @brief  Free the cells (from another thread).
+ *
+ * @param[in] arg  Cells to free (NUM_CELLS / NUM_THREADS).
+ *
+ * @return  NULL.
+ */
+/* ====================================================================== */
+static void *
+free_thread(void *arg)
+{
+    ESM_MESSAGE_CELL ** const p = (ESM_MESSAGE_CELL **) arg;
+    size_t i;
+
+    for (i = 0; i < (NUM_CELLS / NUM_THREADS); i++) {
+        esm_mp_Free(&pool, p[i]);
+    }
+
+    return NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the lock-free free from the other threads.
+ */
+/* ====================================================================== */
+static void
+test_concurrent_free(void)
+{
+    ESM_MESSAGE_CELL *p[NUM_CELLS];
+    pthread_t threads[NUM_THREADS];
+    ESM_MESSAGE_POOL_STATS stats;
+    size_t i, n;
+    int round;
+
+    esm_mp_Initialize(&pool, cells, NUM_CELLS);
+
+    for (round = 0; round < NUM_ROUNDS; round++) {
+        n = alloc_all(p, NUM_CELLS);
+        CHECK(n == NUM_CELLS);
+        if (n != NUM_CELLS) {
+            return;
+        }
+
+        for (i = 0; i < NUM_THREADS; i++) {
+            if (pthread_create(&threads[i], NULL, free_thread,
+                               &p[i * (NUM_CELLS / NUM_THREADS)]) != 0) {
+                CHECK(false);
+                return;
+            }
+        }
+
+        /* Allocate the cells while they are freed. */
+        for (n = 0; n < NUM_CELLS; ) {
+            ESM_MESSAGE_CELL * const cell = esm_mp_Alloc(&pool);
+
+            if (cell != NULL) {
+                esm_mp_Free(&pool, cell);
+                n++;
+            }
+        }
+
+        for (i = 0; i < NUM_THREADS; i++) {
+            (void) pthread_join(threads[i], NULL);
+        }
+    }
+
+    n = alloc_all(p, NUM_CELLS);
+    CHECK(n == NUM_CELLS);
+    CHECK(are_distinct(p, n));
+    esm_mp_GetStats(&pool, &stats);
+    CHECK(stats.in_use == NUM_CELLS);
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(void)
+{
+    test_alloc();
+    test_slab();
+#ifdef ESM_CFG_USE_MPSC_QUEUE
+    test_concurrent_free();
+#endif
+
+    return test_Report("test_message_pool");
+}
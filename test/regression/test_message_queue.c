@@ -0,0 +1,313 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: message queue backpressure test (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Check the capacity of the message queue with the single and the batch
+ * posts, for each overflow policy. Build with ESM_CFG_USE_BACKPRESSURE
+ * (and ESM_CFG_USE_MPSC_QUEUE or ESM_CFG_PRIORITIES to test the other
+ * message queues).
+ */
+/* ********************************************************************** */
+
+#include "esm.h"
+#include "test_check.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Capacity of the message queue. */
+#define CAPACITY 4
+
+/** Number of the messages posted at once (more than CAPACITY). */
+#define NUM_MESSAGES 10
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Numbers of the processed messages (in order) and the released ones. */
+static size_t processed[NUM_MESSAGES * 2];
+static size_t num_processed;
+static size_t num_released;
+
+#ifndef ESM_CFG_USE_MPSC_QUEUE
+/** true to post a message from release_user_data (once). */
+static bool post_on_release;
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Record the number of the message (called by the main loop).
+ */
+/* ====================================================================== */
+static void
+on_message(void * const user_data)
+{
+    if (num_processed < NELEMS(processed)) {
+        processed[num_processed] = (size_t) user_data;
+    }
+    num_processed++;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Count the released message.
+ */
+/* ====================================================================== */
+static void
+on_release(void * const user_data)
+{
+    (void) user_data;
+
+    num_released++;
+
+#ifndef ESM_CFG_USE_MPSC_QUEUE
+    /* Called without the API lock: the message API can be called. */
+    if (post_on_release) {
+        ESM_MESSAGE msg;
+
+        post_on_release = false;
+        msg.func = on_message;
+        msg.release_user_data = NULL;
+        msg.user_data = (void *) (size_t) NUM_MESSAGES;
+        CHECK(esm_PostMessage(&msg) == ESM_E_OK);
+    }
+#endif
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks (not used).
+ */
+/* ====================================================================== */
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    (void) user_data;
+    (void) id;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Set the policy of the message queue.
+ *
+ * @param[in] overflow  Overflow policy.
+ */
+/* ====================================================================== */
+static void
+set_policy(const ESM_OVERFLOW_POLICY overflow)
+{
+    ESM_QUEUE_POLICY policy;
+
+    (void) memset(&policy, 0, sizeof(policy));
+    policy.capacity = CAPACITY;
+    policy.overflow = overflow;
+    policy.timeout_msec = 0;
+    CHECK(esm_SetMessageQueuePolicy(&policy) == ESM_E_OK);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return the statistics of the message queue.
+ */
+/* ====================================================================== */
+static ESM_QUEUE_STATS
+get_stats(void)
+{
+    ESM_QUEUE_STATS stats;
+
+    (void) memset(&stats, 0, sizeof(stats));
+    CHECK(esm_GetMessageQueueStats(&stats) == ESM_E_OK);
+
+    return stats;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Post the numbered messages at once.
+ *
+ * @param[in]  first   Number of the first message.
+ * @param[in]  n       Number of the messages.
+ * @param[out] posted  Number of the posted messages.
+ *
+ * @return  Result of esm_PostMessages().
+ */
+/* ====================================================================== */
+static ESM_ERR
+post_messages(const size_t first, const size_t n, size_t * const posted)
+{
+    ESM_MESSAGE msgs[NUM_MESSAGES];
+    size_t i;
+
+    for (i = 0; (i < n) && (i < NELEMS(msgs)); i++) {
+        msgs[i].func = on_message;
+        msgs[i].release_user_data = on_release;
+        msgs[i].user_data = (void *) (first + i);
+    }
+
+    return esm_PostMessages(msgs, i, posted);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Process all queued messages.
+ */
+/* ====================================================================== */
+static void
+process_messages(void)
+{
+    num_processed = 0;
+    num_released = 0;
+    CHECK(esm_ResumeAndYield() == ESM_E_OK);
+    CHECK(get_stats().depth == 0);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the capacity with ESM_OVERFLOW_REJECT.
+ */
+/* ====================================================================== */
+static void
+test_reject(void)
+{
+    ESM_QUEUE_STATS before, after;
+    size_t posted, i;
+
+    set_policy(ESM_OVERFLOW_REJECT);
+
+    /* The batch is held to the capacity. */
+    before = get_stats();
+    CHECK(post_messages(0, NUM_MESSAGES, &posted) == ESM_E_RES);
+    CHECK(posted == CAPACITY);
+    after = get_stats();
+    CHECK(after.depth == CAPACITY);
+    CHECK(after.max_depth == CAPACITY);
+    CHECK(after.rejected == (before.rejected + 1));
+
+    process_messages();
+    CHECK(num_processed == CAPACITY);
+    for (i = 0; i < CAPACITY; i++) {
+        CHECK(processed[i] == i);
+    }
+
+    /* The queued messages count. */
+    CHECK(post_messages(0, 1, &posted) == ESM_E_OK);
+    CHECK(post_messages(1, CAPACITY, &posted) == ESM_E_RES);
+    CHECK(posted == (CAPACITY - 1));
+    CHECK(get_stats().depth == CAPACITY);
+    process_messages();
+    CHECK(num_processed == CAPACITY);
+}
+
+#ifndef ESM_CFG_USE_MPSC_QUEUE
+/* ====================================================================== */
+/**
+ * @brief  Test the capacity with ESM_OVERFLOW_DROP_OLDEST.
+ */
+/* ====================================================================== */
+static void
+test_drop_oldest(void)
+{
+    ESM_QUEUE_STATS before, after;
+    size_t posted, i;
+
+    set_policy(ESM_OVERFLOW_DROP_OLDEST);
+
+    /* The oldest ones of the batch are dropped (and released). */
+    before = get_stats();
+    num_released = 0;
+    CHECK(post_messages(0, NUM_MESSAGES, &posted) == ESM_E_OK);
+    CHECK(posted == NUM_MESSAGES);
+    after = get_stats();
+    CHECK(after.depth == CAPACITY);
+    CHECK(after.dropped == (before.dropped + (NUM_MESSAGES - CAPACITY)));
+    CHECK(num_released == (NUM_MESSAGES - CAPACITY));
+
+    process_messages();
+    CHECK(num_processed == CAPACITY);
+    for (i = 0; i < CAPACITY; i++) {
+        CHECK(processed[i] == (NUM_MESSAGES - CAPACITY + i));
+    }
+
+    /* release_user_data of the dropped message can post a message. */
+    CHECK(post_messages(0, CAPACITY, &posted) == ESM_E_OK);
+    post_on_release = true;
+    CHECK(post_messages(CAPACITY, 1, &posted) == ESM_E_OK);
+    CHECK(!post_on_release);
+    CHECK(get_stats().depth == CAPACITY);
+
+    /* Posted in the space of the dropped one, before the new one. */
+    process_messages();
+    CHECK(num_processed == CAPACITY);
+    CHECK(processed[CAPACITY - 2] == NUM_MESSAGES);
+    CHECK(processed[CAPACITY - 1] == CAPACITY);
+}
+#endif
+
+/* ====================================================================== */
+/**
+ * @brief  Test the capacity with ESM_OVERFLOW_BLOCK (no wait).
+ */
+/* ====================================================================== */
+static void
+test_block(void)
+{
+    ESM_QUEUE_STATS before, after;
+    size_t posted;
+
+    set_policy(ESM_OVERFLOW_BLOCK);
+
+    /* The posted ones are queued (and counted) before the wait. */
+    before = get_stats();
+    CHECK(post_messages(0, NUM_MESSAGES, &posted) == ESM_E_RES);
+    CHECK(posted == CAPACITY);
+    after = get_stats();
+    CHECK(after.depth == CAPACITY);
+    CHECK(after.blocked == (before.blocked + 1));
+    CHECK(after.rejected == (before.rejected + 1));
+
+    process_messages();
+    CHECK(num_processed == CAPACITY);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(void)
+{
+    static const ESM_EVENT_HANDLER handler = {
+        NULL, on_event, NULL, NULL, NULL, NULL, NULL, NULL
+    };
+    ESM_PREPARE_PARAMS params;
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+    params.default_handler = &handler;
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+
+    test_reject();
+#ifndef ESM_CFG_USE_MPSC_QUEUE
+    test_drop_oldest();
+#endif
+    test_block();
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return test_Report("test_message_queue");
+}
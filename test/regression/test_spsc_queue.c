@@ -0,0 +1,179 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: SPSC message queue test (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Check the full/empty states, the order and the wraparound of esm_sq_*(),
+ * and then pass the numbered messages from a producer thread.
+ */
+/* ********************************************************************** */
+
+#include "esm_spsc_queue.h"
+#include "test_check.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the messages passed between the threads. */
+#define NUM_MESSAGES 200000
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Queue. */
+static ESM_SPSC_QUEUE queue;
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Return the message of the number.
+ */
+/* ====================================================================== */
+static ESM_MESSAGE
+numbered_message(const size_t number)
+{
+    ESM_MESSAGE msg;
+
+    msg.func = NULL;
+    msg.release_user_data = NULL;
+    msg.user_data = (void *) number;
+
+    return msg;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the full/empty states, the order and the wraparound.
+ */
+/* ====================================================================== */
+static void
+test_push_pop(void)
+{
+    ESM_MESSAGE msg;
+    size_t i, round, next_push, next_pop;
+
+    esm_sq_Initialize(&queue);
+    CHECK(esm_sq_Count(&queue) == 0);
+    CHECK(!esm_sq_Pop(&queue, &msg));
+
+    for (i = 0; i < ESM_CFG_MESSAGE_SHARD_SIZE; i++) {
+        msg = numbered_message(i);
+        CHECK(esm_sq_Push(&queue, &msg));
+    }
+    CHECK(esm_sq_Count(&queue) == ESM_CFG_MESSAGE_SHARD_SIZE);
+    msg = numbered_message(i);
+    CHECK(!esm_sq_Push(&queue, &msg));
+
+    for (i = 0; i < ESM_CFG_MESSAGE_SHARD_SIZE; i++) {
+        CHECK(esm_sq_Pop(&queue, &msg) && (msg.user_data == (void *) i));
+    }
+    CHECK(esm_sq_Count(&queue) == 0);
+    CHECK(!esm_sq_Pop(&queue, &msg));
+
+    /* Wrap around the ring many times with an odd fill level. */
+    next_push = 0;
+    next_pop = 0;
+    for (round = 0; round < (ESM_CFG_MESSAGE_SHARD_SIZE * 4); round++) {
+        for (i = 0; i < 3; i++) {
+            msg = numbered_message(next_push++);
+            CHECK(esm_sq_Push(&queue, &msg));
+        }
+        for (i = 0; i < 2; i++) {
+            CHECK(esm_sq_Pop(&queue, &msg) && (msg.user_data == (void *) next_pop));
+            next_pop++;
+        }
+        if (esm_sq_Count(&queue) >= (ESM_CFG_MESSAGE_SHARD_SIZE - 3)) {
+            while (esm_sq_Pop(&queue, &msg)) {
+                CHECK(msg.user_data == (void *) next_pop);
+                next_pop++;
+            }
+        }
+        CHECK(esm_sq_Count(&queue) == (next_push - next_pop));
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Producer thread.
+ *
+ * @param[in] arg  Not used.
+ *
+ * @return  NULL.
+ */
+/* ====================================================================== */
+static void *
+producer_thread(void *arg)
+{
+    ESM_MESSAGE msg;
+    size_t i;
+
+    (void) arg;
+
+    for (i = 0; i < NUM_MESSAGES; i++) {
+        msg = numbered_message(i);
+        while (!esm_sq_Push(&queue, &msg)) {
+            (void) sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Test the messages passed from the producer thread.
+ */
+/* ====================================================================== */
+static void
+test_threads(void)
+{
+    pthread_t thread;
+    ESM_MESSAGE msg;
+    size_t next, errors;
+
+    esm_sq_Initialize(&queue);
+
+    if (pthread_create(&thread, NULL, producer_thread, NULL) != 0) {
+        CHECK(false);
+        return;
+    }
+
+    /* Take all messages anyway: the producer waits for the space. */
+    errors = 0;
+    for (next = 0; next < NUM_MESSAGES; ) {
+        if (!esm_sq_Pop(&queue, &msg)) {
+            (void) sched_yield();
+            continue;
+        }
+        if (msg.user_data != (void *) next) {
+            errors++;
+        }
+        next++;
+    }
+
+    (void) pthread_join(thread, NULL);
+    CHECK(errors == 0);
+    CHECK(esm_sq_Count(&queue) == 0);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(void)
+{
+    test_push_pop();
+    test_threads();
+
+    return test_Report("test_spsc_queue");
+}
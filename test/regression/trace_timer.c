@@ -0,0 +1,428 @@
+/* ********************************************************************** */
+/**
+ * @brief   ESM: randomized trace of the timers (regression test).
+ * @author  eel3
+ * @date    2026-10-17
+ *
+ * Drive the timers, global timers, timer handles, events and handler
+ * transitions with a seeded pseudo-random sequence, and print every
+ * dispatch. The trace must not depend on the timer storage, so the
+ * Makefile builds this file with the linear scan, ESM_CFG_USE_TIMER_WHEEL
+ * and ESM_CFG_USE_TIMER_SOA, and compares the outputs. Before the trace,
+ * check that a one-shot global timer is not restarted in its own handler
+ * (its user data is released after the call).
+ *
+ * Usage: trace_timer <seed> <steps> [<start tick>]
+ */
+/* ********************************************************************** */
+
+#include "esm.h"
+#include "esm_config.h"
+#include "test_md.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------- */
+/* Constants */
+/* ---------------------------------------------------------------------- */
+
+/** Number of the timer handles used. */
+#define NUM_HANDLES 64
+
+/* ---------------------------------------------------------------------- */
+/* File scope variables */
+/* ---------------------------------------------------------------------- */
+
+/** Random number state. */
+static unsigned long long random_state;
+
+/** Current tick. */
+static ESM_SYS_TICK_MSEC tick;
+
+/** Event handlers, and the index of the current one. */
+static const ESM_EVENT_HANDLER *states[2];
+static int current_state;
+
+/** Timer handles (0: not created). */
+static ESM_TIMER_HANDLE handles[NUM_HANDLES];
+static long handle_seq;
+
+/** true while in a timer callback. */
+static int in_callback;
+
+/** Restart (or kill) in the handler of the one-shot global timer. */
+static bool kill_in_handler;
+static ESM_ERR restart_err;
+static int restart_releases;
+
+/* ---------------------------------------------------------------------- */
+/* Private functions */
+/* ---------------------------------------------------------------------- */
+
+/* ====================================================================== */
+/**
+ * @brief  Return a pseudo-random number (0 to n - 1).
+ */
+/* ====================================================================== */
+static unsigned
+rnd(const unsigned n)
+{
+    random_state = (random_state * 6364136223846793005ULL) + 1442695040888963407ULL;
+
+    return (unsigned) ((random_state >> 33) % n);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Return a pseudo-random timeout (short ones are more likely).
+ */
+/* ====================================================================== */
+static ESM_SYS_TICK_MSEC
+random_timeout(void)
+{
+    if (rnd(5) == 0) {
+        return 0;
+    }
+
+    return (ESM_SYS_TICK_MSEC) rnd((rnd(3) == 0) ? 5000 : 60);
+}
+
+static void random_callback_action(void);
+
+/* ====================================================================== */
+/**
+ * @brief  Timer handle callbacks.
+ */
+/* ====================================================================== */
+static void
+on_handle_timer(void * const user_data)
+{
+    printf("H %ld @%ld\n", (long) (size_t) user_data, (long) tick);
+    random_callback_action();
+}
+
+static void
+release_handle_timer(void * const user_data)
+{
+    printf("hrel %ld\n", (long) (size_t) user_data);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Create, arm, cancel or destroy a random timer handle.
+ */
+/* ====================================================================== */
+static void
+random_handle_action(void)
+{
+    const unsigned k = rnd(NUM_HANDLES);
+    const unsigned r = rnd(10);
+    ESM_ERR err;
+
+    if (r < 3) {
+        if (handles[k] == ESM_TIMER_HANDLE_INVALID) {
+            ESM_TIMER_HANDLER handler = { on_handle_timer, release_handle_timer, NULL };
+
+            handler.user_data = (void *) (size_t) ++handle_seq;
+            err = esm_CreateTimer(&handler, &handles[k]);
+            if (err != ESM_E_OK) {
+                handles[k] = ESM_TIMER_HANDLE_INVALID;
+            }
+            printf("hc %u %d\n", k, (int) err);
+        }
+    } else if (r < 7) {
+        const ESM_SYS_TICK_MSEC timeout = (rnd(4) == 0)
+                                        ? in_callback
+                                        : in_callback + (ESM_SYS_TICK_MSEC) rnd((rnd(3) == 0) ? 3000 : 50);
+        const bool repeat = (rnd(3) == 0);
+
+        err = esm_ArmTimer(handles[k], timeout, repeat);
+        printf("ha %u %d\n", k, (int) err);
+    } else if (r < 8) {
+        err = esm_CancelTimer(handles[k]);
+        printf("hx %u %d\n", k, (int) err);
+    } else {
+        err = esm_DestroyTimer(handles[k]);
+        printf("hd %u %d\n", k, (int) err);
+        if (rnd(2) != 0) {
+            handles[k] = ESM_TIMER_HANDLE_INVALID;
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do a random action in a callback.
+ */
+/* ====================================================================== */
+static void
+random_callback_action(void)
+{
+    unsigned r;
+
+    if (rnd(3) == 0) {
+        in_callback = 1;
+        random_handle_action();
+        in_callback = 0;
+    }
+
+    r = rnd(10);
+    if (r == 0) {
+        const ESM_TIMER_ID id = (ESM_TIMER_ID) rnd(ESM_CFG_MAX_TIMER);
+        const ESM_SYS_TICK_MSEC timeout = 1 + (ESM_SYS_TICK_MSEC) rnd(40);
+        const bool repeat = (rnd(2) != 0);
+        const ESM_ERR err = esm_SetTimer(id, timeout, repeat);
+
+        printf(" cb set %d\n", (int) err);
+    } else if (r == 1) {
+        (void) esm_KillTimer((ESM_TIMER_ID) rnd(ESM_CFG_MAX_TIMER));
+    } else if (r == 2) {
+        current_state ^= 1;
+        (void) esm_SetNextEventHandler(states[current_state]);
+        printf(" cb trans\n");
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Global timer callbacks.
+ */
+/* ====================================================================== */
+static void
+release_global_timer(void * const user_data)
+{
+    printf("grel %ld\n", (long) (size_t) user_data);
+}
+
+static void
+on_global_timer(void * const user_data)
+{
+    printf("G %ld @%ld\n", (long) (size_t) user_data, (long) tick);
+
+    if (rnd(10) == 0) {
+        ESM_TIMER_HANDLER handler = { on_global_timer, release_global_timer, NULL };
+        const unsigned id = rnd(ESM_CFG_MAX_GLOBAL_TIMER);
+        const ESM_SYS_TICK_MSEC timeout = 1 + (ESM_SYS_TICK_MSEC) rnd(50);
+        const bool repeat = (rnd(2) != 0);
+        ESM_ERR err;
+
+        /* It may be the timer in the dispatch (then ESM_E_STATUS). */
+        handler.user_data = (void *) (size_t) (1000 + rnd(100));
+        err = esm_SetGlobalTimer((ESM_TIMER_ID) id, timeout, repeat, &handler);
+        printf(" gcb set %d\n", (int) err);
+    } else {
+        random_callback_action();
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Callbacks of the one-shot global timer restarted in its handler.
+ */
+/* ====================================================================== */
+static void
+release_restart_timer(void * const user_data)
+{
+    (void) user_data;
+
+    restart_releases++;
+}
+
+static void
+on_restart_timer(void * const user_data)
+{
+    ESM_TIMER_HANDLER handler = { on_restart_timer, release_restart_timer, NULL };
+
+    if (kill_in_handler) {
+        restart_err = esm_KillGlobalTimer(0);
+    } else {
+        handler.user_data = user_data;
+        restart_err = esm_SetGlobalTimer(0, 10, false, &handler);
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Check the restart and the kill of the one-shot global timer in
+ *         its handler.
+ *
+ * @retval true   As expected.
+ * @retval false  Restarted, or the user data is released twice.
+ */
+/* ====================================================================== */
+static bool
+check_restart_in_handler(void)
+{
+    const ESM_TIMER_HANDLER handler = { on_restart_timer, release_restart_timer, NULL };
+
+    kill_in_handler = false;
+    restart_releases = 0;
+    if (esm_SetGlobalTimer(0, 0, false, &handler) != ESM_E_OK) {
+        return false;
+    }
+    (void) esm_ResumeAndYield();
+    if ((restart_err != ESM_E_STATUS) || (restart_releases != 1)) {
+        return false;
+    }
+
+    kill_in_handler = true;
+    if (esm_SetGlobalTimer(0, 0, false, &handler) != ESM_E_OK) {
+        return false;
+    }
+    (void) esm_ResumeAndYield();
+
+    return (restart_err == ESM_E_OK) && (restart_releases == 2);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Event handler callbacks.
+ */
+/* ====================================================================== */
+static void
+on_init(void * const user_data)
+{
+    printf("init %s\n", (const char *) user_data);
+}
+
+static void
+on_event(void * const user_data, const ESM_EVENT_ID id)
+{
+    printf("E %s %ld\n", (const char *) user_data, (long) id);
+
+    if (id == 1) {
+        current_state ^= 1;
+        (void) esm_SetNextEventHandler(states[current_state]);
+    }
+}
+
+static void
+on_timer(void * const user_data, const ESM_TIMER_ID id)
+{
+    printf("T %s %u @%ld\n", (const char *) user_data, (unsigned) id, (long) tick);
+    random_callback_action();
+}
+
+static void
+on_destroy(void * const user_data)
+{
+    printf("destroy %s\n", (const char *) user_data);
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Do the random actions of one step.
+ */
+/* ====================================================================== */
+static void
+random_step_actions(void)
+{
+    const unsigned n = rnd(4);
+    unsigned i, r, id;
+    ESM_SYS_TICK_MSEC timeout;
+    bool repeat;
+    ESM_ERR err;
+
+    for (i = 0; i < n; i++) {
+        r = rnd(12);
+        if (rnd(2) != 0) {
+            random_handle_action();
+        }
+
+        if (r < 4) {
+            id = rnd(ESM_CFG_MAX_TIMER);
+            timeout = random_timeout();
+            repeat = (rnd(3) == 0);
+            err = esm_SetTimer((ESM_TIMER_ID) id, timeout, repeat);
+            printf("set %d\n", (int) err);
+        } else if (r < 5) {
+            (void) esm_KillTimer((ESM_TIMER_ID) rnd(ESM_CFG_MAX_TIMER));
+        } else if (r < 8) {
+            ESM_TIMER_HANDLER handler = { on_global_timer, release_global_timer, NULL };
+
+            id = rnd(ESM_CFG_MAX_GLOBAL_TIMER);
+            handler.user_data = (void *) (size_t) id;
+            timeout = random_timeout();
+            repeat = (rnd(3) == 0);
+            err = esm_SetGlobalTimer((ESM_TIMER_ID) id, timeout, repeat, &handler);
+            printf("gset %d\n", (int) err);
+        } else if (r < 9) {
+            (void) esm_KillGlobalTimer((ESM_TIMER_ID) rnd(ESM_CFG_MAX_GLOBAL_TIMER));
+        } else if (r < 10) {
+            (void) test_md_PostEvent(1);
+        } else {
+            (void) test_md_PostEvent(2);
+        }
+    }
+}
+
+/* ====================================================================== */
+/**
+ * @brief  Advance the tick (mostly a little, sometimes a lot).
+ */
+/* ====================================================================== */
+static void
+advance_tick(void)
+{
+    const unsigned r = rnd(20);
+
+    tick += (ESM_SYS_TICK_MSEC) ((r < 10) ? rnd(3) : (r < 18) ? rnd(40) : rnd(20000));
+    test_md_SetTick(tick);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Main routine */
+/* ---------------------------------------------------------------------- */
+
+int
+main(int argc, char *argv[])
+{
+    static char name_a[] = "A";
+    static char name_b[] = "B";
+    static const ESM_EVENT_HANDLER state_a = {
+        on_init, on_event, on_timer, on_destroy, NULL, name_a, NULL, NULL
+    };
+    static const ESM_EVENT_HANDLER state_b = {
+        on_init, on_event, on_timer, on_destroy, NULL, name_b, NULL, NULL
+    };
+    ESM_PREPARE_PARAMS params;
+    long step, steps;
+
+    if ((argc < 3) || (argc > 4)) {
+        (void) fprintf(stderr, "usage: %s <seed> <steps> [<start tick>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    random_state = strtoull(argv[1], NULL, 10);
+    steps = strtol(argv[2], NULL, 10);
+    tick = (argc > 3) ? (ESM_SYS_TICK_MSEC) strtol(argv[3], NULL, 0) : 0;
+    test_md_SetTick(tick);
+
+    states[0] = &state_a;
+    states[1] = &state_b;
+
+    if (esm_Initialize() != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+    params.default_handler = &state_a;
+    if (esm_PrepareBeforeMainLoop(&params) != ESM_E_OK) {
+        return EXIT_FAILURE;
+    }
+
+    if (!check_restart_in_handler()) {
+        (void) fprintf(stderr, "trace_timer: global timer restarted in its handler\n");
+        return EXIT_FAILURE;
+    }
+
+    for (step = 0; step < steps; step++) {
+        random_step_actions();
+        advance_tick();
+        esm_ResumeAndYield();
+    }
+
+    (void) esm_CleanupAfterMainLoop();
+    esm_Finalize();
+
+    return EXIT_SUCCESS;
+}